@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cstring>
+
+#include "applications.h"
+
+static inline uint64_t hash_string(const char *string, size_t length) noexcept {
+    //FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<uint8_t>(string[i]);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+rmaslr::application_list::application_list() noexcept : slots_(64, 0) {
+    //offset 0 is always the empty string
+    arena_.push_back('\0');
+}
+
+const std::vector<uint32_t>& rmaslr::application_list::column(field field) const noexcept {
+    switch (field) {
+        case field::bundle_identifier:
+            return bundle_identifiers_;
+        case field::container_name:
+            return container_names_;
+        case field::display_name:
+            return display_names_;
+        case field::executable_name:
+            return executable_names_;
+        case field::executable_path:
+            return executable_paths_;
+    }
+
+    return bundle_identifiers_;
+}
+
+bool rmaslr::application_list::lookup(const char *string, size_t length, uint32_t *offset) const noexcept {
+    if (!length) {
+        *offset = 0;
+        return true;
+    }
+
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = hash_string(string, length) & mask;; slot = (slot + 1) & mask) {
+        uint32_t offset_ = slots_[slot];
+        if (!offset_) {
+            return false;
+        }
+
+        if (strncmp(&arena_[offset_], string, length) == 0 && arena_[offset_ + length] == '\0') {
+            *offset = offset_;
+            return true;
+        }
+    }
+}
+
+uint32_t rmaslr::application_list::intern(const char *string, size_t length) noexcept {
+    uint32_t offset = 0;
+    if (lookup(string, length, &offset)) {
+        return offset;
+    }
+
+    //keep the table at most half full
+    if ((interned_ + 1) * 2 > slots_.size()) {
+        auto slots = std::vector<uint32_t>(slots_.size() * 2, 0);
+        size_t mask = slots.size() - 1;
+
+        for (uint32_t offset_ : slots_) {
+            if (!offset_) {
+                continue;
+            }
+
+            size_t slot = hash_string(&arena_[offset_], strlen(&arena_[offset_])) & mask;
+            while (slots[slot]) {
+                slot = (slot + 1) & mask;
+            }
+
+            slots[slot] = offset_;
+        }
+
+        slots_.swap(slots);
+    }
+
+    offset = static_cast<uint32_t>(arena_.size());
+    arena_.insert(arena_.end(), string, string + length);
+    arena_.push_back('\0');
+
+    size_t mask = slots_.size() - 1;
+    size_t slot = hash_string(string, length) & mask;
+
+    while (slots_[slot]) {
+        slot = (slot + 1) & mask;
+    }
+
+    slots_[slot] = offset;
+    interned_++;
+
+    return offset;
+}
+
+void rmaslr::application_list::add(const rmaslr::application& application) noexcept {
+    uint32_t index = static_cast<uint32_t>(size());
+
+    uint32_t bundle_identifier = intern(application.bundle_identifier.data(), application.bundle_identifier.length());
+    uint32_t container_name = intern(application.container_name.data(), application.container_name.length());
+    uint32_t display_name = intern(application.display_name.data(), application.display_name.length());
+    uint32_t executable_name = intern(application.executable_name.data(), application.executable_name.length());
+
+    bundle_identifiers_.push_back(bundle_identifier);
+    container_names_.push_back(container_name);
+    display_names_.push_back(display_name);
+    executable_names_.push_back(executable_name);
+    executable_paths_.push_back(intern(application.executable_path.data(), application.executable_path.length()));
+
+    //an application is indexed once per distinct name
+    uint32_t names[] = { container_name, display_name, bundle_identifier, executable_name };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (!names[i] || std::find(names, &names[i], names[i]) != &names[i]) {
+            continue;
+        }
+
+        names_.emplace(names[i], index);
+    }
+
+    std::string key = name(index);
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    sort_keys_.push_back(intern(key.data(), key.length()));
+}
+
+rmaslr::application rmaslr::application_list::at(size_t index) const noexcept {
+    return {
+        get(index, field::bundle_identifier),
+        get(index, field::container_name),
+        get(index, field::display_name),
+        get(index, field::executable_name),
+        get(index, field::executable_path)
+    };
+}
+
+size_t rmaslr::application_list::count(uint32_t offset) const noexcept {
+    return names_.count(offset);
+}
+
+const char *rmaslr::application_list::name(size_t index, bool unique) const noexcept {
+    for (uint32_t offset : { container_names_[index], display_names_[index], executable_names_[index] }) {
+        if (!offset) {
+            continue;
+        }
+
+        if (unique && count(offset) > 1) {
+            continue;
+        }
+
+        return &arena_[offset];
+    }
+
+    //every name is shared with another application, fall back to the first one set
+    if (unique) {
+        return name(index);
+    }
+
+    return &arena_[0];
+}
+
+std::vector<size_t> rmaslr::application_list::find(const char *name) const noexcept {
+    auto indexes = std::vector<size_t>();
+
+    uint32_t offset = 0;
+    if (!lookup(name, strlen(name), &offset) || !offset) {
+        return indexes;
+    }
+
+    auto range = names_.equal_range(offset);
+    for (auto it = range.first; it != range.second; it++) {
+        indexes.push_back(it->second);
+    }
+
+    std::sort(indexes.begin(), indexes.end());
+    return indexes;
+}
+
+std::vector<size_t> rmaslr::application_list::sorted() const noexcept {
+    auto indexes = std::vector<size_t>(size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+        indexes[i] = i;
+    }
+
+    std::stable_sort(indexes.begin(), indexes.end(), [this](size_t first, size_t second) {
+        return strcmp(&arena_[sort_keys_[first]], &arena_[sort_keys_[second]]) < 0;
+    });
+
+    return indexes;
+}
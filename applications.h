@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rmaslr {
+    struct application {
+        std::string bundle_identifier;
+        std::string container_name;
+        std::string display_name;
+        std::string executable_name;
+        std::string executable_path;
+    };
+
+    //applications stored as one array per field, every string is interned once into a shared arena
+    //and the container, display, bundle and executable names are indexed by a hash table
+    class application_list {
+    public:
+        enum class field {
+            bundle_identifier,
+            container_name,
+            display_name,
+            executable_name,
+            executable_path
+        };
+
+        application_list() noexcept;
+
+        void add(const application& application) noexcept;
+
+        inline size_t size() const noexcept {
+            return bundle_identifiers_.size();
+        }
+
+        inline bool empty() const noexcept {
+            return bundle_identifiers_.empty();
+        }
+
+        inline const char *get(size_t index, field field) const noexcept {
+            return &arena_[column(field)[index]];
+        }
+
+        application at(size_t index) const noexcept;
+
+        //container, display or executable name, whichever is set first (and unique when unique is true)
+        const char *name(size_t index, bool unique = false) const noexcept;
+
+        //indexes of every application with a container, display, bundle or executable name equal to name
+        std::vector<size_t> find(const char *name) const noexcept;
+
+        //indexes ordered case-insensitively by name(), compared with keys folded once when the application was added
+        std::vector<size_t> sorted() const noexcept;
+    private:
+        std::vector<char> arena_;
+
+        std::vector<uint32_t> slots_;
+        size_t interned_ = 0;
+
+        std::vector<uint32_t> bundle_identifiers_;
+        std::vector<uint32_t> container_names_;
+        std::vector<uint32_t> display_names_;
+        std::vector<uint32_t> executable_names_;
+        std::vector<uint32_t> executable_paths_;
+
+        std::vector<uint32_t> sort_keys_;
+
+        //interned string offset -> application index
+        std::unordered_multimap<uint32_t, uint32_t> names_;
+
+        const std::vector<uint32_t>& column(field field) const noexcept;
+
+        uint32_t intern(const char *string, size_t length) noexcept;
+        bool lookup(const char *string, size_t length, uint32_t *offset) const noexcept;
+
+        size_t count(uint32_t offset) const noexcept;
+    };
+}
@@ -0,0 +1,168 @@
+#include <cstring>
+
+#include "architecture.h"
+
+//slots of each lookup table, a power of two a few times the table's size so a collision-free seed is found quickly
+#define ARCHITECTURE_SLOTS 128
+
+extern constexpr rmaslr::architecture rmaslr::architectures[] = {
+    { "ppc", CPU_TYPE_POWERPC, CPU_SUBTYPE_POWERPC_ALL },
+    { "ppc64", CPU_TYPE_POWERPC64, CPU_SUBTYPE_POWERPC_ALL },
+    { "i386", CPU_TYPE_I386, CPU_SUBTYPE_I386_ALL },
+    { "x86_64", CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL },
+    { "x86_64h", CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_H },
+    { "arm", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_ALL },
+    { "arm64", CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL },
+    { "arm64_32", CPU_TYPE_ARM64_32, CPU_SUBTYPE_ARM64_32_V8 },
+    { "ppc970", CPU_TYPE_POWERPC, CPU_SUBTYPE_POWERPC_970 },
+    { "armv4t", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V4T },
+    { "armv5", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V5TEJ },
+    { "xscale", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_XSCALE },
+    { "armv6", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V6 },
+    { "armv6m", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V6M },
+    { "armv7", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7 },
+    { "armv7f", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7F },
+    { "armv7s", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7S },
+    { "armv7k", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7K },
+    { "armv7m", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7M },
+    { "armv7em", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7EM },
+    { "armv8", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V8 },
+    { "armv8m", CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V8M },
+    { "arm64v8", CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_V8 },
+    { "arm64e", CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E }
+};
+
+static_assert(sizeof(rmaslr::architectures) / sizeof(rmaslr::architectures[0]) == rmaslr::architectures_count, "architectures_count is out of date");
+static_assert(rmaslr::architectures_count < 0xff, "slots hold an index + 1 in a byte");
+
+//fnv-1a, started from the seed
+static constexpr uint32_t hash_name(const char *name, uint32_t seed) noexcept {
+    uint32_t hash = 2166136261u ^ seed;
+    for (; *name; name++) {
+        hash ^= static_cast<uint8_t>(*name);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+//splitmix64's finalizer over the cputype and subtype, started from the seed
+static constexpr uint32_t hash_type(cpu_type_t cputype, cpu_subtype_t cpusubtype, uint32_t seed) noexcept {
+    uint64_t hash = (static_cast<uint64_t>(static_cast<uint32_t>(cputype)) << 32 | static_cast<uint32_t>(cpusubtype)) + seed * 0x9e3779b97f4a7c15ull;
+
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+
+    return static_cast<uint32_t>(hash ^ (hash >> 31));
+}
+
+struct lookup_table {
+    uint32_t seed;
+    uint8_t slots[ARCHITECTURE_SLOTS]; //index + 1 into architectures, 0 when empty
+};
+
+//the key of each table. included is false for entries the table leaves out
+struct name_key {
+    static constexpr bool included(size_t) noexcept {
+        return true;
+    }
+
+    static constexpr uint32_t hash(size_t index, uint32_t seed) noexcept {
+        return hash_name(rmaslr::architectures[index].name, seed);
+    }
+};
+
+struct type_key {
+    static constexpr bool included(size_t) noexcept {
+        return true;
+    }
+
+    static constexpr uint32_t hash(size_t index, uint32_t seed) noexcept {
+        return hash_type(rmaslr::architectures[index].cputype, rmaslr::architectures[index].cpusubtype, seed);
+    }
+};
+
+//families alone, keyed by cputype with a subtype of 0
+struct family_key {
+    static constexpr bool included(size_t index) noexcept {
+        for (size_t i = 0; i < index; i++) {
+            if (rmaslr::architectures[i].cputype == rmaslr::architectures[index].cputype) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static constexpr uint32_t hash(size_t index, uint32_t seed) noexcept {
+        return hash_type(rmaslr::architectures[index].cputype, 0, seed);
+    }
+};
+
+//tries seeds until every included entry gets a slot of its own
+template <typename key>
+static constexpr lookup_table create_table() noexcept {
+    for (uint32_t seed = 0;; seed++) {
+        auto table = lookup_table();
+        table.seed = seed;
+
+        bool collided = false;
+        for (size_t i = 0; i < rmaslr::architectures_count && !collided; i++) {
+            if (!key::included(i)) {
+                continue;
+            }
+
+            uint8_t& slot = table.slots[key::hash(i, seed) & (ARCHITECTURE_SLOTS - 1)];
+            if (slot) {
+                collided = true;
+            }
+
+            slot = static_cast<uint8_t>(i + 1);
+        }
+
+        if (!collided) {
+            return table;
+        }
+    }
+}
+
+static constexpr lookup_table name_table = create_table<name_key>();
+static constexpr lookup_table type_table = create_table<type_key>();
+static constexpr lookup_table family_table = create_table<family_key>();
+
+static const rmaslr::architecture *slot_architecture(const lookup_table& table, uint32_t hash) noexcept {
+    uint8_t slot = table.slots[hash & (ARCHITECTURE_SLOTS - 1)];
+    if (!slot) {
+        return nullptr;
+    }
+
+    return &rmaslr::architectures[slot - 1];
+}
+
+const rmaslr::architecture *rmaslr::find_architecture(const char *name) noexcept {
+    const architecture *architecture = slot_architecture(name_table, hash_name(name, name_table.seed));
+    if (!architecture || strcmp(architecture->name, name) != 0) {
+        return nullptr;
+    }
+
+    return architecture;
+}
+
+const rmaslr::architecture *rmaslr::find_architecture(cpu_type_t cputype, cpu_subtype_t cpusubtype) noexcept {
+    if (cpusubtype != CPU_SUBTYPE_MULTIPLE) {
+        //the high byte holds capabilities (arm64e's pointer authentication abi), not the subtype
+        auto subtype = static_cast<cpu_subtype_t>(cpusubtype & ~CPU_SUBTYPE_MASK);
+
+        const architecture *architecture = slot_architecture(type_table, hash_type(cputype, subtype, type_table.seed));
+        if (architecture && architecture->cputype == cputype && architecture->cpusubtype == subtype) {
+            return architecture;
+        }
+    }
+
+    const architecture *family = slot_architecture(family_table, hash_type(cputype, 0, family_table.seed));
+    if (!family || family->cputype != cputype) {
+        return nullptr;
+    }
+
+    return family;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+
+#include "macho.h"
+
+namespace rmaslr {
+    struct architecture {
+        const char *name;
+        cpu_type_t cputype;
+        cpu_subtype_t cpusubtype;
+    };
+
+    //every architecture rmaslr knows the name of, built in rather than asked of apple's libc. the first of every cputype is its family
+    constexpr size_t architectures_count = 24;
+    extern const architecture architectures[architectures_count];
+
+    //each is a single probe into a table perfect-hashed at compile time, null if unknown
+    const architecture *find_architecture(const char *name) noexcept;
+
+    //an unknown subtype of a known cputype gets its family, as NXGetArchInfoFromCpuType does
+    const architecture *find_architecture(cpu_type_t cputype, cpu_subtype_t cpusubtype) noexcept;
+
+    //architectures from the table, as a bit per entry
+    class architecture_set {
+    public:
+        void insert(const architecture *architecture) noexcept {
+            bits_.set(index(architecture));
+        }
+
+        void erase(const architecture *architecture) noexcept {
+            bits_.reset(index(architecture));
+        }
+
+        //false for null, so the result of find_architecture can be passed as is
+        bool contains(const architecture *architecture) const noexcept {
+            return architecture && bits_.test(index(architecture));
+        }
+
+        bool empty() const noexcept {
+            return bits_.none();
+        }
+
+        size_t size() const noexcept {
+            return bits_.count();
+        }
+
+        //in table order
+        template <typename F>
+        void for_each(F function) const {
+            for (size_t i = 0; i < architectures_count; i++) {
+                if (bits_.test(i)) {
+                    function(architectures[i]);
+                }
+            }
+        }
+    private:
+        static size_t index(const architecture *architecture) noexcept {
+            return static_cast<size_t>(architecture - architectures);
+        }
+
+        std::bitset<architectures_count> bits_;
+    };
+}
@@ -0,0 +1,456 @@
+#include <dirent.h>
+
+#include "batch.h"
+#include "engine.h"
+
+//files whose removals are journaled with a single sync, and so also the number of files planned but not written yet
+#define JOURNAL_GROUP_SIZE 256
+
+std::string rmaslr::describe_parse_status(parse_status status, uint32_t architectures_count, uint32_t failing_index) noexcept {
+    switch (status) {
+        case parse_status::ok:
+            return "";
+        case parse_status::not_macho:
+            return "is not a valid mach-o";
+        case parse_status::no_architectures:
+            return "cannot have 0 architectures";
+        case parse_status::too_small:
+            return formatted_string("is too small to contain %d architectures", architectures_count);
+        case parse_status::placed_before_declaration:
+            return formatted_string("architecture #%d is placed before its declaration", failing_index + 1);
+        case parse_status::placed_past_end:
+            return formatted_string("architecture #%d is placed past end of file", failing_index + 1);
+    }
+
+    return "";
+}
+
+bool rmaslr::collect_files(const std::string& path, std::vector<std::string>& paths) noexcept {
+    auto span = trace::span("enumerate", path.c_str());
+
+    struct stat sbuf;
+    if (stat(path.c_str(), &sbuf) != 0) {
+        return false;
+    }
+
+    if (S_ISREG(sbuf.st_mode)) {
+        paths.push_back(path);
+        return true;
+    }
+
+    if (!S_ISDIR(sbuf.st_mode)) {
+        return true;
+    }
+
+    auto directories = std::vector<std::string>({ path });
+    while (!directories.empty()) {
+        std::string directory = std::move(directories.back());
+        directories.pop_back();
+
+        DIR *dir = opendir(directory.c_str());
+        if (!dir) {
+            continue;
+        }
+
+        if (directory.back() != '/') {
+            directory.append(1, '/');
+        }
+
+        struct dirent *dir_entry = nullptr;
+        while ((dir_entry = readdir(dir))) {
+            if (strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) {
+                continue;
+            }
+
+            auto entry_path = directory + dir_entry->d_name;
+            auto type = dir_entry->d_type;
+
+            //not every filesystem fills in d_type
+            if (type == DT_UNKNOWN) {
+                if (lstat(entry_path.c_str(), &sbuf) != 0) {
+                    continue;
+                }
+
+                if (S_ISDIR(sbuf.st_mode)) {
+                    type = DT_DIR;
+                } else if (S_ISREG(sbuf.st_mode)) {
+                    type = DT_REG;
+                }
+            }
+
+            if (type == DT_DIR) {
+                directories.push_back(std::move(entry_path));
+            } else if (type == DT_REG) {
+                paths.push_back(std::move(entry_path));
+            }
+        }
+
+        closedir(dir);
+    }
+
+    return true;
+}
+
+//writes the flags of every slice in removals, each journaled first when options has a journal
+static void write_removals(rmaslr::file& file, const std::vector<rmaslr::slice>& removals, const rmaslr::batch_options& options, rmaslr::file_result& result) noexcept {
+    using namespace rmaslr;
+
+    if (options.journal) {
+        for (const auto& slice : removals) {
+            options.journal->append(result.path, file.stat(), slice.offset, to_file_order(slice, slice.flags), to_file_order(slice, slice.flags & ~MH_PIE));
+        }
+
+        if (!options.journal->commit()) {
+            result.status = file_status::failed;
+            result.error = formatted_string("could not be journaled, errno=%d(%s)", errno, strerror(errno));
+
+            return;
+        }
+    }
+
+    for (const auto& slice : removals) {
+        if (!file.write_flags(slice.offset, to_file_order(slice, slice.flags & ~MH_PIE))) {
+            result.status = file_status::failed;
+            result.error = formatted_string("could not be written to at offset 0x%.16llX, errno=%d(%s)", static_cast<unsigned long long>(slice.offset), errno, strerror(errno));
+
+            return;
+        }
+
+        find_slice_result(result, slice.offset)->signature = update_signature(file.descriptor(), slice);
+    }
+}
+
+std::vector<rmaslr::slice> rmaslr::plan_removals(const file& file, const batch_options& options, file_result& result) noexcept {
+    auto timer = stats::timer(stats::stage::read);
+    if (stats::enabled()) {
+        stats::add(stats::counter::files);
+    }
+
+    uint32_t magic = file.magic();
+    if (!is_macho_magic(magic) && !is_fat_magic(magic)) {
+        result.status = file_status::skipped;
+        return std::vector<slice>();
+    }
+
+    auto slices = std::vector<slice>();
+    uint32_t failing_index = 0;
+
+    auto status = parse_slices(file, slices, &failing_index);
+
+    //a java class file or universal static library only shares the fat magic
+    if (status == parse_status::not_macho && is_fat_magic(magic)) {
+        result.status = file_status::skipped;
+        return std::vector<slice>();
+    }
+
+    if (status != parse_status::ok) {
+        result.status = file_status::failed;
+        result.error = describe_parse_status(status, fat_architectures_count(file), failing_index);
+
+        return std::vector<slice>();
+    }
+
+    //the load commands directly follow the header, so they are almost always on the page already read
+    for (auto& slice : slices) {
+        inspect_load_commands(file, slice);
+    }
+
+    auto removals = std::vector<slice>();
+    for (size_t index : plan_slices(slices, options, result)) {
+        removals.push_back(slices[index]);
+        removals.back().header = nullptr;
+    }
+
+    return removals;
+}
+
+rmaslr::file_result rmaslr::process_file(const std::string& path, const rmaslr::batch_options& options, file_plan *plan) noexcept {
+    auto span = trace::span("process_file", path.c_str());
+
+    auto result = file_result();
+    result.path = path;
+
+    //always mapped read-only first, most files in a tree are not mach-o files
+    auto file = rmaslr::file(path.c_str());
+    if (!file.is_open()) {
+        result.status = file_status::failed;
+        result.error = formatted_string("could not be opened, errno=%d(%s)", file.error_number(), strerror(file.error_number()));
+
+        return result;
+    }
+
+    auto removals = plan_removals(file, options, result);
+    if (removals.empty()) {
+        return result;
+    }
+
+    if (plan) {
+        plan->sbuf = file.stat();
+        plan->removals = std::move(removals);
+
+        return result;
+    }
+
+    if (!file.make_writable(path.c_str())) {
+        result.status = file_status::failed;
+        result.error = formatted_string("could not be opened for writing, errno=%d(%s)", file.error_number(), strerror(file.error_number()));
+
+        return result;
+    }
+
+    write_removals(file, removals, options, result);
+    return result;
+}
+
+void rmaslr::process_buffer(const uint8_t *data, uint64_t size, uint8_t *writable_data, const batch_options& options, file_result& result) noexcept {
+    auto file = rmaslr::file(data, size);
+    for (const auto& slice : plan_removals(file, options, result)) {
+        uint32_t flags = to_file_order(slice, slice.flags & ~MH_PIE);
+        memcpy(&writable_data[slice.offset + offsetof(struct mach_header, flags)], &flags, sizeof(flags));
+
+        find_slice_result(result, slice.offset)->signature = update_signature(writable_data, size, slice);
+    }
+}
+
+void rmaslr::apply_plan(const file_plan& plan, const batch_options& options, file_result& result) noexcept {
+    if (result.status != file_status::ok || plan.removals.empty()) {
+        return;
+    }
+
+    auto span = trace::span("apply_plan", result.path.c_str());
+
+    auto file = rmaslr::file(result.path.c_str(), true);
+    if (!file.is_open()) {
+        result.status = file_status::failed;
+        result.error = formatted_string("could not be opened for writing, errno=%d(%s)", file.error_number(), strerror(file.error_number()));
+
+        return;
+    }
+
+    //the same check as file::make_writable, path must still refer to the file that was planned
+    struct stat sbuf = file.stat();
+    if (sbuf.st_dev != plan.sbuf.st_dev || sbuf.st_ino != plan.sbuf.st_ino) {
+        result.status = file_status::failed;
+        result.error = formatted_string("could not be opened for writing, errno=%d(%s)", ESTALE, strerror(ESTALE));
+
+        return;
+    }
+
+    write_removals(file, plan.removals, options, result);
+}
+
+std::vector<size_t> rmaslr::plan_slices(const std::vector<slice>& slices, const batch_options& options, file_result& result) noexcept {
+    auto removals = std::vector<size_t>();
+
+    result.slices.reserve(slices.size());
+    for (size_t i = 0; i < slices.size(); i++) {
+        const auto& slice = slices[i];
+        if (!options.architectures.empty() && !options.architectures.contains(find_architecture(slice.cputype, slice.cpusubtype))) {
+            continue;
+        }
+
+        auto slice_result = rmaslr::slice_result({ slice.offset, slice.cputype, slice.cpusubtype, slice.flags, slice.filetype, slice.encrypted, slice.code_signature, slice_action::none, signature_status::none });
+        bool aslr = has_aslr(slice);
+
+        if (options.remove_aslr) {
+            if (!aslr) {
+                slice_result.action = slice_action::not_present;
+            } else if (slice.encrypted) {
+                slice_result.action = slice_action::encrypted;
+            } else if (slice.cputype == CPU_TYPE_ARM64 && !options.allow_arm64) {
+                slice_result.action = slice_action::declined;
+            } else {
+                slice_result.action = slice_action::removed;
+                removals.push_back(i);
+            }
+        }
+
+        result.slices.push_back(slice_result);
+    }
+
+    return removals;
+}
+
+rmaslr::slice_result *rmaslr::find_slice_result(file_result& result, uint64_t offset) noexcept {
+    for (auto& slice : result.slices) {
+        if (slice.offset == offset) {
+            return &slice;
+        }
+    }
+
+    return nullptr;
+}
+
+struct planned_file {
+    rmaslr::file_plan plan;
+    rmaslr::file_result result;
+
+    const std::string *link_target = nullptr; //replaced with a hard link to this path instead of being written to
+};
+
+//journals the removals of count files with a single sync before any of them is written, handler is optional
+static void apply_group(planned_file *files, size_t count, size_t first, const rmaslr::batch_options& options, const rmaslr::result_handler& handler) {
+    using namespace rmaslr;
+
+    bool journaled = true;
+    int error_number = 0;
+
+    if (options.journal) {
+        for (size_t i = 0; i < count; i++) {
+            if (files[i].link_target) {
+                continue;
+            }
+
+            for (const auto& slice : files[i].plan.removals) {
+                options.journal->append(files[i].result.path, files[i].plan.sbuf, slice.offset, to_file_order(slice, slice.flags), to_file_order(slice, slice.flags & ~MH_PIE));
+            }
+        }
+
+        journaled = options.journal->commit();
+        error_number = errno;
+    }
+
+    //already journaled, so written without going through the journal again
+    auto unjournaled = options;
+    unjournaled.journal = nullptr;
+
+    parallel_for(count, options.jobs, [&](size_t index) {
+        auto& file = files[index];
+        auto& result = file.result;
+
+        if (file.link_target) {
+            if (!relink(*file.link_target, result.path)) {
+                result.status = file_status::failed;
+                result.error = formatted_string("could not be replaced with a hard link, errno=%d(%s)", errno, strerror(errno));
+                result.reclaimed = 0;
+            }
+        } else if (!file.plan.removals.empty() && !journaled) {
+            result.status = file_status::failed;
+            result.error = formatted_string("could not be journaled, errno=%d(%s)", error_number, strerror(error_number));
+        } else {
+            apply_plan(file.plan, unjournaled, result);
+        }
+
+        if (handler) {
+            handler(first + index, std::move(result));
+        }
+    });
+}
+
+//plans every distinct file once, gives identical copies the same removals (or a hard link to the file they duplicate),
+//and shares the result of a file with the other paths to it
+static void process_deduplicated(const std::vector<std::string>& paths, const rmaslr::batch_options& options, const rmaslr::result_handler& handler) {
+    using namespace rmaslr;
+
+    auto groups = find_duplicates(paths, options.jobs);
+    auto files = std::vector<planned_file>(paths.size());
+
+    auto representatives = std::vector<size_t>();
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (groups.representatives[i] == i) {
+            representatives.push_back(i);
+        }
+    }
+
+    parallel_for(representatives.size(), options.jobs, [&](size_t index) {
+        auto& file = files[representatives[index]];
+        file.result = process_file(paths[representatives[index]], options, &file.plan);
+    });
+
+    //a representative always comes before its duplicates, so its plan is complete by the time they are reached
+    for (size_t i = 0; i < paths.size(); i++) {
+        size_t representative = groups.representatives[i];
+        if (representative == i) {
+            continue;
+        }
+
+        const auto& original = files[representative];
+        auto& file = files[i];
+
+        file.result = original.result;
+        file.result.path = paths[i];
+        file.result.duplicate_of = paths[representative];
+
+        //the same file, written to through its representative
+        if (groups.hardlinks[i]) {
+            continue;
+        }
+
+        const auto& sbuf = groups.sbufs[i];
+
+        file.plan.sbuf = sbuf;
+        file.plan.removals = original.plan.removals;
+
+        //a copy with links of its own would leave them unpatched, and one with another owner or mode (setuid included) would take on
+        //the representative's. those are edited instead
+        const auto& representative_sbuf = groups.sbufs[representative];
+        bool same_metadata = sbuf.st_mode == representative_sbuf.st_mode && sbuf.st_uid == representative_sbuf.st_uid && sbuf.st_gid == representative_sbuf.st_gid;
+
+        if (options.dedup == dedup_policy::link && !file.plan.removals.empty() && sbuf.st_dev == representative_sbuf.st_dev && sbuf.st_nlink == 1 && same_metadata) {
+            file.link_target = &paths[representative];
+            file.result.reclaimed = static_cast<uint64_t>(sbuf.st_size);
+        }
+    }
+
+    for (size_t first = 0; first < files.size(); first += JOURNAL_GROUP_SIZE) {
+        apply_group(&files[first], std::min<size_t>(JOURNAL_GROUP_SIZE, files.size() - first), first, options, nullptr);
+    }
+
+    //what was written through the representative, now that it's known
+    for (size_t i = 0; i < paths.size(); i++) {
+        auto& file = files[i];
+        const auto& original = files[groups.representatives[i]].result;
+
+        if (groups.hardlinks[i]) {
+            file.result.status = original.status;
+            file.result.error = original.error;
+            file.result.slices = original.slices;
+        } else if (file.link_target && file.result.status == file_status::ok) {
+            file.result.slices = original.slices;
+        }
+    }
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        handler(i, std::move(files[i].result));
+    }
+}
+
+void rmaslr::process_files(const std::vector<std::string>& paths, const rmaslr::batch_options& options, const result_handler& handler) {
+    if (options.dedup != dedup_policy::none) {
+        process_deduplicated(paths, options, handler);
+        return;
+    }
+
+    if (options.io_uring && process_files_io_uring(paths, options, handler)) {
+        return;
+    }
+
+    if (!options.journal) {
+        parallel_for(paths.size(), options.jobs, [&](size_t index) {
+            handler(index, process_file(paths[index], options));
+        });
+
+        return;
+    }
+
+    auto files = std::vector<planned_file>();
+    for (size_t first = 0; first < paths.size(); first += JOURNAL_GROUP_SIZE) {
+        size_t count = std::min<size_t>(JOURNAL_GROUP_SIZE, paths.size() - first);
+        files.assign(count, planned_file());
+
+        parallel_for(count, options.jobs, [&](size_t index) {
+            files[index].result = process_file(paths[first + index], options, &files[index].plan);
+        });
+
+        apply_group(files.data(), count, first, options, handler);
+    }
+}
+
+std::vector<rmaslr::file_result> rmaslr::process_files(const std::vector<std::string>& paths, const rmaslr::batch_options& options) {
+    auto results = std::vector<file_result>(paths.size());
+    process_files(paths, options, [&](size_t index, file_result&& result) {
+        results[index] = std::move(result);
+    });
+
+    return results;
+}
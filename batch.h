@@ -0,0 +1,112 @@
+#pragma once
+
+#include <functional>
+
+#include "codesign.h"
+#include "dedup.h"
+#include "journal.h"
+
+namespace rmaslr {
+    enum class slice_action {
+        none,       //only checked
+        removed,
+        not_present, //did not contain ASLR
+        declined,   //64-bit arm slice, removal was not confirmed
+        encrypted   //FairPlay-encrypted, left alone as it cannot run once modified
+    };
+
+    struct slice_result {
+        uint64_t offset;
+
+        cpu_type_t cputype;
+        cpu_subtype_t cpusubtype;
+
+        uint32_t flags; //as found in the file, before any change
+        uint32_t filetype;
+
+        bool encrypted;
+        bool code_signature;
+
+        slice_action action;
+        signature_status signature; //of a removed slice's code signature, once its flags were written
+    };
+
+    enum class file_status {
+        ok,
+        skipped, //not a mach-o file
+        failed
+    };
+
+    struct file_result {
+        std::string path;
+
+        file_status status = file_status::ok;
+        std::string error;
+
+        std::vector<slice_result> slices;
+
+        //with dedup, the path of the file this one duplicates, whose result it shares without having been parsed
+        std::string duplicate_of;
+        uint64_t reclaimed = 0; //bytes freed by replacing this file with a hard link
+    };
+
+    struct batch_options {
+        bool remove_aslr = false;
+        bool allow_arm64 = false;
+
+        unsigned int jobs = 0;
+
+        //read headers and write flags through io_uring instead of jobs threads, when the kernel supports it
+        bool io_uring = false;
+        unsigned int queue_depth = 256; //files in flight at once with io_uring
+
+        //when not empty, only slices of these architectures are looked at
+        architecture_set architectures;
+
+        //when set, every flags write is recorded in it first
+        rmaslr::journal *journal = nullptr;
+
+        //when not none, hardlinks and identical copies are only parsed once, and io_uring is not used
+        dedup_policy dedup = dedup_policy::none;
+    };
+
+    //the slices process_file would have removed ASLR from, and the file they are in
+    struct file_plan {
+        struct stat sbuf;
+        std::vector<slice> removals; //headers are unset, the file is no longer mapped
+    };
+
+    //appends path to paths, or every regular file below it if it's a directory (symbolic links inside are not followed)
+    bool collect_files(const std::string& path, std::vector<std::string>& paths) noexcept;
+
+    //adds the slices of file (open, or a view of a buffer) to result and returns those to remove ASLR from, their headers unset.
+    //result's status is set to skipped or failed when file is not a valid mach-o
+    std::vector<slice> plan_removals(const file& file, const batch_options& options, file_result& result) noexcept;
+
+    //same fat/thin handling as a single file, but every failure is reported in the result instead of exiting.
+    //with a plan nothing is written, the removals are left in it for apply_plan
+    file_result process_file(const std::string& path, const batch_options& options, file_plan *plan = nullptr) noexcept;
+
+    //the same as process_file on a view of data, with removals written straight into writable_data (data itself, or a copy of it)
+    void process_buffer(const uint8_t *data, uint64_t size, uint8_t *writable_data, const batch_options& options, file_result& result) noexcept;
+
+    //reopens the file of result for writing and writes the removals of plan, unless result already failed
+    void apply_plan(const file_plan& plan, const batch_options& options, file_result& result) noexcept;
+    //called once per file with its index in paths, from whichever thread processed it
+    using result_handler = std::function<void(size_t index, file_result&& result)>;
+
+    //falls back to jobs threads of process_file when io_uring was requested but is unavailable.
+    //with a journal, files are planned a group at a time and the removals of a group made durable together before any is written.
+    //with dedup, every file is planned before any is written, and handler is called in path order once all were written
+    void process_files(const std::vector<std::string>& paths, const batch_options& options, const result_handler& handler);
+    std::vector<file_result> process_files(const std::vector<std::string>& paths, const batch_options& options);
+
+    //the error process_file reports for a parse_slices failure
+    std::string describe_parse_status(parse_status status, uint32_t architectures_count, uint32_t failing_index) noexcept;
+
+    //adds a slice_result for every slice matching options.architectures to result, returns the indexes (into slices) of those to remove ASLR from
+    std::vector<size_t> plan_slices(const std::vector<slice>& slices, const batch_options& options, file_result& result) noexcept;
+
+    //the slice_result plan_slices added for the slice at offset
+    slice_result *find_slice_result(file_result& result, uint64_t offset) noexcept;
+}
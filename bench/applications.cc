@@ -0,0 +1,125 @@
+//
+//  applications.cc
+//  rmaslr
+//
+//  Compares a serial and a parallel parse of a synthetic /Applications-like tree, the way -apps lists it,
+//  with a warm page cache and with every Info.plist evicted before each run
+//  Usage: rmaslr-bench-applications [bundle-count] [iterations]
+//
+
+#include <chrono>
+
+#include "fixtures.h"
+
+static const char *info_plist =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+    "<plist version=\"1.0\">\n"
+    "<dict>\n"
+    "    <key>CFBundleDevelopmentRegion</key>\n"
+    "    <string>en</string>\n"
+    "    <key>CFBundleExecutable</key>\n"
+    "    <string>Application%d</string>\n"
+    "    <key>CFBundleIdentifier</key>\n"
+    "    <string>com.rmaslr.bench.application%d</string>\n"
+    "    <key>CFBundleName</key>\n"
+    "    <string>Application %d</string>\n"
+    "    <key>CFBundlePackageType</key>\n"
+    "    <string>APPL</string>\n"
+    "    <key>CFBundleShortVersionString</key>\n"
+    "    <string>1.0</string>\n"
+    "    <key>LSMinimumSystemVersion</key>\n"
+    "    <string>10.9</string>\n"
+    "</dict>\n"
+    "</plist>\n";
+
+static void create_tree(const std::string& root, int count) {
+    for (int i = 0; i < count; i++) {
+        std::string bundle = rmaslr::formatted_string("%s/Application %d.app", root.c_str(), i).c_str();
+        std::string contents = bundle + "/Contents";
+
+        mkdir(bundle.c_str(), 0755);
+        mkdir(contents.c_str(), 0755);
+
+        FILE *file = fopen((contents + "/Info.plist").c_str(), "w");
+        if (!file) {
+            error("Unable to create Info.plist in bundle (%s), errno=%d(%s)", bundle.c_str(), errno, strerror(errno));
+        }
+
+        fprintf(file, info_plist, i, i, i);
+        fclose(file);
+    }
+}
+
+static void remove_tree(const std::string& root, int count) {
+    for (int i = 0; i < count; i++) {
+        std::string bundle = rmaslr::formatted_string("%s/Application %d.app", root.c_str(), i).c_str();
+
+        unlink((bundle + "/Contents/Info.plist").c_str());
+        rmdir((bundle + "/Contents").c_str());
+        rmdir(bundle.c_str());
+    }
+
+    rmdir(root.c_str());
+}
+
+static std::vector<std::string> info_plist_paths(const std::string& root, int count) {
+    auto paths = std::vector<std::string>();
+    for (int i = 0; i < count; i++) {
+        paths.push_back(rmaslr::formatted_string("%s/Application %d.app/Contents/Info.plist", root.c_str(), i));
+    }
+
+    return paths;
+}
+
+static double measure(const std::string& root, unsigned int jobs, int iterations, size_t expected, const std::vector<std::string> *evicted = nullptr) {
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        if (evicted) {
+            fixtures::evict(*evicted);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto applications = rmaslr::parse_application_containers(root, jobs);
+        auto end = std::chrono::steady_clock::now();
+
+        if (applications.size() != expected) {
+            error("Parsed %ld applications, expected %ld", applications.size(), expected);
+        }
+
+        double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        if (!i || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+int main(int argc, const char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 500;
+    int iterations = argc > 2 ? atoi(argv[2]) : 5;
+
+    auto root = fixtures::create_root("rmaslr-bench-applications");
+    create_tree(root, count);
+    sync();
+
+    double serial = measure(root, 1, iterations, count);
+    double parallel = measure(root, 0, iterations, count);
+
+    fprintf(stdout, "%d bundles, best of %d\n", count, iterations);
+    fprintf(stdout, "serial:         %8.2f ms\n", serial);
+    fprintf(stdout, "parallel:       %8.2f ms (%u threads, %.2fx)\n", parallel, std::max(std::thread::hardware_concurrency(), 1u), serial / parallel);
+
+    auto plists = info_plist_paths(root, count);
+    if (fixtures::evict(plists)) {
+        double serial_cold = measure(root, 1, iterations, count, &plists);
+        double parallel_cold = measure(root, 0, iterations, count, &plists);
+
+        fprintf(stdout, "serial, cold:   %8.2f ms\n", serial_cold);
+        fprintf(stdout, "parallel, cold: %8.2f ms (%.2fx)\n", parallel_cold, serial_cold / parallel_cold);
+    }
+
+    remove_tree(root, count);
+    return 0;
+}
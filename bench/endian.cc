@@ -0,0 +1,194 @@
+//
+//  endian.cc
+//  rmaslr
+//
+//  Compares decoding fat_arch tables and mach_header flags with the old runtime swap(magic, value)
+//  against the byte-order specialized views in macho.h, for big and little-endian inputs
+//  Usage: rmaslr-bench-endian [architecture-count] [iterations]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../macho.h"
+
+//the decoder parse_slices used before macho.h, including its 64-bit mask
+static uint32_t old_swap(uint32_t magic, uint32_t value) {
+    if (magic == MH_CIGAM || magic == MH_CIGAM_64 || magic == FAT_CIGAM || magic == FAT_CIGAM_64) {
+        value = ((value >> 8) & 0x00ff00ff) | ((value << 8) & 0xff00ff00);
+        value = ((value >> 16) & 0x0000ffff) | ((value << 16) & 0xffff0000);
+    }
+
+    return value;
+}
+
+static uint64_t old_swap(uint32_t magic, uint64_t value) {
+    if (magic == MH_CIGAM || magic == MH_CIGAM_64 || magic == FAT_CIGAM || magic == FAT_CIGAM_64) {
+        value = (value & 0x00000000ffffffff) << 32 | (value & 0xffffffff00000000) >> 32;
+        value = (value & 0x0000ffff0000ffff) << 16 | (value & 0xffff0000ffff0000) >> 16;
+        value = (value & 0x00ff00ff00ff0ff) << 8  | (value & 0xff00ff00ff00ff00) >> 8;
+    }
+
+    return value;
+}
+
+static int32_t old_swap(uint32_t magic, int32_t value) {
+    return static_cast<int32_t>(old_swap(magic, static_cast<uint32_t>(value)));
+}
+
+struct decoded {
+    uint64_t offset;
+    cpu_type_t cputype;
+    cpu_subtype_t cpusubtype;
+};
+
+struct input {
+    const char *name;
+
+    uint32_t magic;
+    std::vector<struct fat_arch_64> archs;
+    std::vector<struct mach_header> headers;
+};
+
+static struct input create_input(const char *name, bool swapped, uint32_t count) {
+    struct input input = { name, swapped ? static_cast<uint32_t>(FAT_CIGAM_64) : static_cast<uint32_t>(FAT_MAGIC_64), {}, {} };
+
+    input.archs.resize(count);
+    input.headers.resize(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        struct fat_arch_64 arch = { CPU_TYPE_ARM64, static_cast<cpu_subtype_t>(i % 3), 0x4000 + static_cast<uint64_t>(i) * 0x1234567, 0x100000, 14, 0 };
+        struct mach_header header = { swapped ? MH_CIGAM_64 : MH_MAGIC_64, CPU_TYPE_ARM64, 0, MH_EXECUTE, 0, 0, static_cast<uint32_t>(i % 2 ? MH_PIE | 0x85 : 0x85) };
+
+        if (swapped) {
+            rmaslr::swap_fat_archs_64(&arch, &arch, 1);
+
+            header.cputype = rmaslr::byte_order<true>::get(header.cputype);
+            header.filetype = rmaslr::byte_order<true>::get(header.filetype);
+            header.flags = rmaslr::byte_order<true>::get(header.flags);
+        }
+
+        input.archs[i] = arch;
+        input.headers[i] = header;
+    }
+
+    return input;
+}
+
+static uint64_t decode_old(const struct input& input, std::vector<decoded>& output) {
+    uint64_t pie = 0;
+    for (size_t i = 0; i < input.archs.size(); i++) {
+        const struct fat_arch_64& arch = input.archs[i];
+
+        output[i].offset = old_swap(input.magic, arch.offset);
+        output[i].cputype = old_swap(input.magic, arch.cputype);
+        output[i].cpusubtype = old_swap(input.magic, arch.cpusubtype);
+
+        const struct mach_header& header = input.headers[i];
+        pie += (old_swap(header.magic, header.flags) & MH_PIE) > 0;
+    }
+
+    return pie;
+}
+
+template <bool swapped>
+static uint64_t decode_table(const struct input& input, std::vector<decoded>& output) {
+    auto view = rmaslr::fat_view<swapped, true>(input.archs.data());
+    for (uint32_t i = 0; i < input.archs.size(); i++) {
+        output[i] = { view.offset(i), view.cputype(i), view.cpusubtype(i) };
+    }
+
+    uint64_t pie = 0;
+    for (const auto& header : input.headers) {
+        pie += rmaslr::with_header_view(&header, [](const auto& view) {
+            return (view.flags() & MH_PIE) > 0;
+        });
+    }
+
+    return pie;
+}
+
+static uint64_t decode_new(const struct input& input, std::vector<decoded>& output) {
+    if (input.magic == FAT_MAGIC_64) {
+        return decode_table<false>(input, output);
+    }
+
+    //same as parse_slices, swapped in bulk a chunk at a time
+    struct fat_arch_64 chunk[32];
+    for (uint32_t first = 0; first < input.archs.size(); first += 32) {
+        uint32_t count = std::min(static_cast<uint32_t>(input.archs.size()) - first, 32u);
+        rmaslr::swap_fat_archs_64(&input.archs[first], chunk, count);
+
+        auto view = rmaslr::fat_view<false, true>(chunk);
+        for (uint32_t i = 0; i < count; i++) {
+            output[first + i] = { view.offset(i), view.cputype(i), view.cpusubtype(i) };
+        }
+    }
+
+    uint64_t pie = 0;
+    for (const auto& header : input.headers) {
+        pie += (rmaslr::header_view<true>(&header).flags() & MH_PIE) > 0;
+    }
+
+    return pie;
+}
+
+template <typename F>
+static double measure(const struct input& input, int iterations, std::vector<decoded>& output, uint64_t& pie, F decode) {
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        pie = decode(input, output);
+        auto end = std::chrono::steady_clock::now();
+
+        double elapsed = std::chrono::duration<double, std::micro>(end - start).count();
+        if (!i || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+int main(int argc, const char *argv[]) {
+    uint32_t count = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 1 << 16;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    fprintf(stdout, "%u architectures, best of %d\n", count, iterations);
+    for (bool swapped : { false, true }) {
+        auto input = create_input(swapped ? "swapped" : "native", swapped, count);
+
+        auto old_output = std::vector<decoded>(count);
+        auto new_output = std::vector<decoded>(count);
+
+        uint64_t old_pie = 0;
+        uint64_t new_pie = 0;
+
+        double old_time = measure(input, iterations, old_output, old_pie, decode_old);
+        double new_time = measure(input, iterations, new_output, new_pie, decode_new);
+
+        size_t mismatches = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const auto& first = old_output[i];
+            const auto& second = new_output[i];
+
+            if (first.offset != second.offset || first.cputype != second.cputype || first.cpusubtype != second.cpusubtype) {
+                mismatches++;
+            }
+        }
+
+        fprintf(stdout, "%s:\n", input.name);
+        fprintf(stdout, "    swap(magic, value): %10.2f us\n", old_time);
+        fprintf(stdout, "    views:              %10.2f us (%.2fx)\n", new_time, old_time / new_time);
+
+        if (old_pie != new_pie || mismatches) {
+            fprintf(stdout, "    %zu entries decoded differently by the old 64-bit swap\n", mismatches);
+        }
+    }
+
+    return 0;
+}
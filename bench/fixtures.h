@@ -0,0 +1,225 @@
+//
+//  fixtures.h
+//  rmaslr
+//
+//  Synthetic thin and fat mach-o files, and trees of them, for the benchmarks. Needs nothing from apple's sdk
+//
+
+#pragma once
+
+#include "../rmaslr.h"
+
+namespace fixtures {
+    struct options {
+        uint32_t slices = 2;          //0 writes a thin file
+        uint32_t slice_size = 0x4000; //rounded up to a page
+
+        bool fat_64 = false;          //FAT_MAGIC_64 with fat_arch_64 entries
+        bool native_fat = false;      //fat header in the host's byte-order (FAT_MAGIC when read back) instead of big-endian
+        bool swapped_slices = false;  //slice headers in the opposite byte-order to the host, as ppc slices are on x86
+        bool archive_slices = false;  //slices are static libraries (!<arch>), as in a universal .a, rather than mach-o files
+
+        const char *description() const noexcept {
+            static std::string description;
+            if (!slices) {
+                description = swapped_slices ? "thin, swapped" : "thin";
+            } else {
+                description = rmaslr::formatted_string("%s%s, %u %s%s", fat_64 ? "fat64" : "fat", native_fat ? " native" : "", slices, archive_slices ? "archives" : "slices", swapped_slices ? ", swapped" : "");
+            }
+
+            return description.c_str();
+        }
+    };
+
+    struct architecture {
+        cpu_type_t cputype;
+        cpu_subtype_t cpusubtype;
+    };
+
+    //cycled through for the slices of a fat file, unknown subtypes are used once these run out
+    static const architecture architectures[] = {
+        { CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL },
+        { CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL },
+        { CPU_TYPE_I386, CPU_SUBTYPE_I386_ALL },
+        { CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7 },
+        { CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7S },
+        { CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E },
+        { CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_H },
+        { CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7K }
+    };
+
+    static const uint32_t architectures_count = sizeof(architectures) / sizeof(architectures[0]);
+
+    template <typename T>
+    inline T to_order(T value, bool swapped) noexcept {
+        if (!swapped) {
+            return value;
+        }
+
+        return sizeof(T) == 8 ? static_cast<T>(__builtin_bswap64(static_cast<uint64_t>(value))) : static_cast<T>(__builtin_bswap32(static_cast<uint32_t>(value)));
+    }
+
+    //a PIE executable with a couple of load commands (a uuid and an unencrypted LC_ENCRYPTION_INFO) in size bytes at data
+    inline void write_slice(uint8_t *data, const architecture& architecture, bool swapped) noexcept {
+        bool is_64 = (architecture.cputype & CPU_ARCH_ABI64) != 0;
+
+        auto header = reinterpret_cast<struct mach_header *>(data);
+        uint32_t header_size = is_64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+
+        auto uuid = reinterpret_cast<struct load_command *>(data + header_size);
+        uuid->cmd = to_order<uint32_t>(0x1b, swapped); //LC_UUID
+        uuid->cmdsize = to_order<uint32_t>(24, swapped);
+        memset(&uuid[1], 0xab, 16);
+
+        uint32_t encryption_size = is_64 ? sizeof(struct encryption_info_command_64) : sizeof(struct encryption_info_command);
+
+        auto encryption = reinterpret_cast<struct encryption_info_command *>(data + header_size + 24);
+        encryption->cmd = to_order<uint32_t>(is_64 ? LC_ENCRYPTION_INFO_64 : LC_ENCRYPTION_INFO, swapped);
+        encryption->cmdsize = to_order<uint32_t>(encryption_size, swapped);
+        encryption->cryptoff = to_order<uint32_t>(0x4000, swapped);
+
+        header->magic = to_order<uint32_t>(is_64 ? MH_MAGIC_64 : MH_MAGIC, swapped);
+        header->cputype = to_order(architecture.cputype, swapped);
+        header->cpusubtype = to_order(architecture.cpusubtype, swapped);
+        header->filetype = to_order<uint32_t>(MH_EXECUTE, swapped);
+        header->ncmds = to_order<uint32_t>(2, swapped);
+        header->sizeofcmds = to_order<uint32_t>(24 + encryption_size, swapped);
+        header->flags = to_order<uint32_t>(MH_PIE | MH_DYLDLINK | MH_NOUNDEFS | MH_TWOLEVEL, swapped);
+    }
+
+    //the start of a static library, its symbol table member header laid out like ar(1) writes it
+    inline void write_archive(uint8_t *data) noexcept {
+        static const char contents[] = "!<arch>\n__.SYMDEF SORTED  0           0     0     100644  8         `\n";
+        memcpy(data, contents, sizeof(contents) - 1);
+    }
+
+    inline std::vector<uint8_t> create_file(const options& options) {
+        uint32_t slice_size = (std::max<uint32_t>(options.slice_size, 0x1000) + 0xfff) & ~0xfffu;
+        if (!options.slices) {
+            auto buffer = std::vector<uint8_t>(slice_size);
+            write_slice(buffer.data(), architectures[0], options.swapped_slices);
+
+            return buffer;
+        }
+
+        //slices are aligned to 16 KiB, as arm64 slices are
+        uint64_t table_size = sizeof(struct fat_header) + options.slices * (options.fat_64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch));
+        uint64_t first_offset = (table_size + 0x3fff) & ~0x3fffull;
+        uint64_t stride = (slice_size + 0x3fffull) & ~0x3fffull;
+
+        auto buffer = std::vector<uint8_t>(first_offset + stride * (options.slices - 1) + slice_size);
+
+        bool swapped = !options.native_fat;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        swapped = !swapped;
+#endif
+
+        auto header = reinterpret_cast<struct fat_header *>(buffer.data());
+        header->magic = to_order<uint32_t>(options.fat_64 ? FAT_MAGIC_64 : FAT_MAGIC, swapped);
+        header->nfat_arch = to_order<uint32_t>(options.slices, swapped);
+
+        for (uint32_t i = 0; i < options.slices; i++) {
+            auto architecture = architectures[i % architectures_count];
+            architecture.cpusubtype += static_cast<cpu_subtype_t>(i / architectures_count * 0x20);
+
+            uint64_t offset = first_offset + i * stride;
+            if (options.fat_64) {
+                auto arch = &reinterpret_cast<struct fat_arch_64 *>(&buffer[sizeof(struct fat_header)])[i];
+
+                arch->cputype = to_order(architecture.cputype, swapped);
+                arch->cpusubtype = to_order(architecture.cpusubtype, swapped);
+                arch->offset = to_order<uint64_t>(offset, swapped);
+                arch->size = to_order<uint64_t>(slice_size, swapped);
+                arch->align = to_order<uint32_t>(14, swapped);
+            } else {
+                auto arch = &reinterpret_cast<struct fat_arch *>(&buffer[sizeof(struct fat_header)])[i];
+
+                arch->cputype = to_order(architecture.cputype, swapped);
+                arch->cpusubtype = to_order(architecture.cpusubtype, swapped);
+                arch->offset = to_order<uint32_t>(static_cast<uint32_t>(offset), swapped);
+                arch->size = to_order<uint32_t>(slice_size, swapped);
+                arch->align = to_order<uint32_t>(14, swapped);
+            }
+
+            if (options.archive_slices) {
+                write_archive(&buffer[offset]);
+            } else {
+                write_slice(&buffer[offset], architecture, options.swapped_slices);
+            }
+        }
+
+        return buffer;
+    }
+
+    inline void write_file(const std::string& path, const std::vector<uint8_t>& contents) {
+        int descriptor = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+        if (descriptor < 0 || write(descriptor, contents.data(), contents.size()) != static_cast<ssize_t>(contents.size())) {
+            error("Unable to create file (%s), errno=%d(%s)", path.c_str(), errno, strerror(errno));
+        }
+
+        close(descriptor);
+    }
+
+    //count files in directories of 100, one in four not a mach-o as in an application bundle. written back to disk before returning
+    inline std::vector<std::string> create_tree(const std::string& root, int count, const options& options) {
+        auto macho = create_file(options);
+        auto text = std::vector<uint8_t>(0x2000, 'a');
+
+        auto paths = std::vector<std::string>();
+        for (int i = 0; i < count; i++) {
+            std::string directory = rmaslr::formatted_string("%s/directory%d", root.c_str(), i / 100);
+            if (i % 100 == 0) {
+                mkdir(directory.c_str(), 0755);
+            }
+
+            std::string path = rmaslr::formatted_string("%s/file%d", directory.c_str(), i);
+            write_file(path, i % 4 == 3 ? text : macho);
+
+            paths.push_back(path);
+        }
+
+        sync();
+        return paths;
+    }
+
+    inline void remove_tree(const std::string& root, const std::vector<std::string>& paths) {
+        for (const auto& path : paths) {
+            unlink(path.c_str());
+        }
+
+        for (size_t i = 0; i < paths.size(); i += 100) {
+            rmdir(rmaslr::formatted_string("%s/directory%ld", root.c_str(), i / 100).c_str());
+        }
+
+        rmdir(root.c_str());
+    }
+
+    //drops paths from the page cache so the next read goes to disk, false where that isn't possible
+    inline bool evict(const std::vector<std::string>& paths) {
+#ifdef POSIX_FADV_DONTNEED
+        for (const auto& path : paths) {
+            int descriptor = open(path.c_str(), O_RDONLY);
+            if (descriptor < 0) {
+                continue;
+            }
+
+            posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+            close(descriptor);
+        }
+
+        return true;
+#else
+        (void)paths;
+        return false;
+#endif
+    }
+
+    inline std::string create_root(const char *name) {
+        auto root = rmaslr::formatted_string("/tmp/%s.XXXXXX", name);
+        if (!mkdtemp(&root[0])) {
+            error("Unable to create temporary directory, errno=%d(%s)", errno, strerror(errno));
+        }
+
+        return root;
+    }
+}
@@ -0,0 +1,73 @@
+//
+//  io.cc
+//  rmaslr
+//
+//  Compares checking a synthetic tree of mach-o files with one thread, one thread per cpu and io_uring,
+//  evicting the tree from the page cache before every run so each one starts cold
+//  Usage: rmaslr-bench-io [file-count] [iterations]
+//
+
+#include <chrono>
+
+#include "../engine.h"
+#include "fixtures.h"
+
+static double measure(const std::vector<std::string>& paths, const rmaslr::batch_options& options, int iterations) {
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        fixtures::evict(paths);
+
+        auto start = std::chrono::steady_clock::now();
+        auto results = rmaslr::process_files(paths, options);
+        auto end = std::chrono::steady_clock::now();
+
+        for (const auto& result : results) {
+            if (result.status == rmaslr::file_status::failed) {
+                error("File (%s) %s", result.path.c_str(), result.error.c_str());
+            }
+        }
+
+        double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        if (!i || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+int main(int argc, const char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 5000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 3;
+
+    auto root = fixtures::create_root("rmaslr-bench-io");
+    auto paths = fixtures::create_tree(root, count, fixtures::options());
+
+    auto serial = rmaslr::batch_options();
+    serial.jobs = 1;
+
+    auto threaded = rmaslr::batch_options();
+
+    auto io_uring = rmaslr::batch_options();
+    io_uring.io_uring = true;
+
+    bool has_io_uring = rmaslr::process_files_io_uring(paths, io_uring, [](size_t, rmaslr::file_result&&) {});
+
+    fprintf(stdout, "%d files, cold cache, best of %d\n", count, iterations);
+
+    double serial_time = measure(paths, serial, iterations);
+    fprintf(stdout, "1 thread:   %8.2f ms (%8.0f files/s)\n", serial_time, count / serial_time * 1000);
+
+    double threaded_time = measure(paths, threaded, iterations);
+    fprintf(stdout, "threads:    %8.2f ms (%8.0f files/s, %u threads)\n", threaded_time, count / threaded_time * 1000, std::max(std::thread::hardware_concurrency(), 1u));
+
+    if (has_io_uring) {
+        double io_uring_time = measure(paths, io_uring, iterations);
+        fprintf(stdout, "io_uring:   %8.2f ms (%8.0f files/s, queue depth %u)\n", io_uring_time, count / io_uring_time * 1000, io_uring.queue_depth);
+    } else {
+        fprintf(stdout, "io_uring:   not available\n");
+    }
+
+    fixtures::remove_tree(root, paths);
+    return 0;
+}
@@ -0,0 +1,211 @@
+//
+//  patch.cc
+//  rmaslr
+//
+//  The parse and patch hot path: single-file latency of checking and removing ASLR for every fat/thin layout,
+//  then throughput over a synthetic tree with a warm and a cold page cache
+//  Usage: rmaslr-bench-patch [file-count] [iterations] [slices] [slice-size]
+//
+
+#include <chrono>
+
+#include "../batch.h"
+#include "fixtures.h"
+
+using clock_type = std::chrono::steady_clock;
+
+static double elapsed_since(clock_type::time_point start) {
+    return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+}
+
+static void check_result(const rmaslr::file_result& result) {
+    if (result.status != rmaslr::file_status::ok) {
+        error("File (%s) %s", result.path.c_str(), result.status == rmaslr::file_status::skipped ? "is not a mach-o" : result.error.c_str());
+    }
+}
+
+static double median(std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+//process_file on one file, rewritten before every patch so there's always ASLR to remove
+static void measure_latency(const std::string& root, const fixtures::options& fixture, int iterations) {
+    auto contents = fixtures::create_file(fixture);
+    auto path = root + "/latency";
+
+    fixtures::write_file(path, contents);
+
+    auto check = rmaslr::batch_options();
+
+    auto patch = rmaslr::batch_options();
+    patch.remove_aslr = true;
+    patch.allow_arm64 = true;
+
+    auto check_samples = std::vector<double>();
+    auto patch_samples = std::vector<double>();
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = clock_type::now();
+        auto result = rmaslr::process_file(path, check);
+        check_samples.push_back(elapsed_since(start));
+
+        check_result(result);
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        fixtures::write_file(path, contents);
+
+        auto start = clock_type::now();
+        auto result = rmaslr::process_file(path, patch);
+        patch_samples.push_back(elapsed_since(start));
+
+        check_result(result);
+    }
+
+    fprintf(stdout, "%-34s check %8.2f us   patch %8.2f us\n", fixture.description(), median(check_samples), median(patch_samples));
+    unlink(path.c_str());
+}
+
+//a universal static library shares the fat magic, and must be skipped without being written to
+static void check_archive(const std::string& root) {
+    auto fixture = fixtures::options();
+    fixture.archive_slices = true;
+
+    auto contents = fixtures::create_file(fixture);
+    auto path = root + "/archive";
+
+    fixtures::write_file(path, contents);
+
+    auto patch = rmaslr::batch_options();
+    patch.remove_aslr = true;
+    patch.allow_arm64 = true;
+
+    auto result = rmaslr::process_file(path, patch);
+    if (result.status != rmaslr::file_status::skipped) {
+        error("File (%s) with static library slices was not skipped%s%s", path.c_str(), result.error.empty() ? "" : ": ", result.error.c_str());
+    }
+
+    auto file = rmaslr::file(path.c_str());
+    if (!file.is_open() || file.size() != contents.size() || memcmp(file.at<uint8_t>(0x0, file.size()), contents.data(), contents.size()) != 0) {
+        error("File (%s) with static library slices was written to", path.c_str());
+    }
+
+    unlink(path.c_str());
+}
+
+//best of iterations over every path, each run preceded by prepare
+template <typename F>
+static double measure_tree(const std::vector<std::string>& paths, const rmaslr::batch_options& options, int iterations, F prepare) {
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        prepare();
+
+        auto start = clock_type::now();
+        auto results = rmaslr::process_files(paths, options);
+        double elapsed = elapsed_since(start) / 1000;
+
+        for (const auto& result : results) {
+            if (result.status == rmaslr::file_status::failed) {
+                error("File (%s) %s", result.path.c_str(), result.error.c_str());
+            }
+        }
+
+        if (!i || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+static void print_throughput(const char *name, double milliseconds, size_t count) {
+    fprintf(stdout, "%-34s %9.2f ms (%9.0f files/s)\n", name, milliseconds, count / milliseconds * 1000);
+}
+
+int main(int argc, const char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 5000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 3;
+
+    auto fixture = fixtures::options();
+    if (argc > 3) {
+        fixture.slices = static_cast<uint32_t>(atoi(argv[3]));
+    }
+
+    if (argc > 4) {
+        fixture.slice_size = static_cast<uint32_t>(strtoul(argv[4], nullptr, 0));
+    }
+
+    auto root = fixtures::create_root("rmaslr-bench-patch");
+
+    //every layout parse_slices handles, with the slice count and size given
+    auto layouts = std::vector<fixtures::options>();
+    for (int layout = 0; layout < 6; layout++) {
+        auto options = fixture;
+        switch (layout) {
+            case 0:
+                options.slices = 0;
+                break;
+            case 1:
+                options.slices = 0;
+                options.swapped_slices = true;
+                break;
+            case 3:
+                options.native_fat = true;
+                break;
+            case 4:
+                options.fat_64 = true;
+                break;
+            case 5:
+                options.fat_64 = true;
+                options.native_fat = true;
+                options.swapped_slices = true;
+                break;
+        }
+
+        if (layout < 2 || options.slices) {
+            layouts.push_back(options);
+        }
+    }
+
+    check_archive(root);
+
+    fprintf(stdout, "single file, warm cache, median of %d\n", iterations * 100);
+    for (const auto& layout : layouts) {
+        measure_latency(root, layout, iterations * 100);
+    }
+
+    auto paths = fixtures::create_tree(root, count, fixture);
+    auto contents = fixtures::create_file(fixture);
+
+    auto rewrite = [&]() {
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (i % 4 != 3) {
+                fixtures::write_file(paths[i], contents);
+            }
+        }
+
+        sync();
+    };
+
+    auto check = rmaslr::batch_options();
+
+    auto patch = rmaslr::batch_options();
+    patch.remove_aslr = true;
+    patch.allow_arm64 = true;
+
+    fprintf(stdout, "\n%d files (%s), best of %d, %u threads\n", count, fixture.description(), iterations, std::max(std::thread::hardware_concurrency(), 1u));
+
+    print_throughput("check, warm", measure_tree(paths, check, iterations, []() {}), paths.size());
+    print_throughput("patch, warm", measure_tree(paths, patch, iterations, rewrite), paths.size());
+
+    if (fixtures::evict(paths)) {
+        print_throughput("check, cold", measure_tree(paths, check, iterations, [&]() { fixtures::evict(paths); }), paths.size());
+        print_throughput("patch, cold", measure_tree(paths, patch, iterations, [&]() { rewrite(); fixtures::evict(paths); }), paths.size());
+    } else {
+        fprintf(stdout, "cold cache:                        not available, the page cache cannot be dropped per file here\n");
+    }
+
+    fixtures::remove_tree(root, paths);
+    return 0;
+}
@@ -0,0 +1,259 @@
+//
+//  plist.cc
+//  rmaslr
+//
+//  Reading the keys parse_application_container needs from large XML and binary Info.plists, with the keys
+//  first and last in the dictionary. On apple's platforms the same files are also parsed by CoreFoundation,
+//  as rmaslr used to, to compare against
+//  Usage: rmaslr-bench-plist [entry-count] [iterations]
+//
+
+#include <chrono>
+
+#include "../plist.h"
+#include "fixtures.h"
+
+using clock_type = std::chrono::steady_clock;
+
+struct entry {
+    std::string key;
+    std::string value;
+    bool is_array; //value is written as an array of strings holding value, skipped by the parser
+};
+
+static const char *wanted_keys[] = { "CFBundleExecutable", "CFBundleName", "CFBundleIdentifier" };
+
+static std::vector<entry> create_entries(int count, bool wanted_first) {
+    auto entries = std::vector<entry>();
+    auto wanted = std::vector<entry>({
+        { "CFBundleExecutable", "Application", false },
+        { "CFBundleName", "Application \xc3\xa9", false }, //not ascii, so binary plists store it as utf-16
+        { "CFBundleIdentifier", "com.rmaslr.bench.application", false }
+    });
+
+    if (wanted_first) {
+        entries = wanted;
+    }
+
+    for (int i = 0; i < count; i++) {
+        entries.push_back({ rmaslr::formatted_string("NSBenchmarkKey%d", i), rmaslr::formatted_string("A value of entry %d, long enough to be skipped rather than compared", i), i % 3 == 0 });
+    }
+
+    if (!wanted_first) {
+        entries.insert(entries.end(), wanted.begin(), wanted.end());
+    }
+
+    return entries;
+}
+
+static std::vector<uint8_t> create_xml(const std::vector<entry>& entries) {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+                      "<plist version=\"1.0\">\n<dict>\n";
+
+    for (const auto& entry : entries) {
+        xml += "\t<key>" + entry.key + "</key>\n";
+        if (entry.is_array) {
+            xml += "\t<array>\n\t\t<string>" + entry.value + "</string>\n\t\t<string>" + entry.value + "</string>\n\t</array>\n";
+        } else {
+            xml += "\t<string>" + entry.value + "</string>\n";
+        }
+    }
+
+    xml += "</dict>\n</plist>\n";
+    return std::vector<uint8_t>(xml.begin(), xml.end());
+}
+
+static void append_integer(std::vector<uint8_t>& data, uint64_t value, int size) {
+    for (int i = size - 1; i >= 0; i--) {
+        data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+//a marker with its count in the low nibble, or followed by a 4-byte integer object
+static void append_marker(std::vector<uint8_t>& data, uint8_t type, uint64_t count) {
+    if (count < 15) {
+        data.push_back(static_cast<uint8_t>(type << 4 | count));
+        return;
+    }
+
+    data.push_back(static_cast<uint8_t>(type << 4 | 0xf));
+    data.push_back(0x12);
+
+    append_integer(data, count, 4);
+}
+
+static void append_string(std::vector<uint8_t>& data, const std::string& string) {
+    bool ascii = std::all_of(string.begin(), string.end(), [](char character) { return static_cast<unsigned char>(character) < 0x80; });
+    if (ascii) {
+        append_marker(data, 0x5, string.size());
+        data.insert(data.end(), string.begin(), string.end());
+
+        return;
+    }
+
+    //only two-byte utf-8 sequences are written by create_entries
+    auto units = std::vector<uint16_t>();
+    for (size_t i = 0; i < string.size(); i++) {
+        auto character = static_cast<unsigned char>(string[i]);
+        if (character < 0x80) {
+            units.push_back(character);
+        } else {
+            units.push_back(static_cast<uint16_t>((character & 0x1f) << 6 | (static_cast<unsigned char>(string[++i]) & 0x3f)));
+        }
+    }
+
+    append_marker(data, 0x6, units.size());
+    for (uint16_t unit : units) {
+        append_integer(data, unit, 2);
+    }
+}
+
+//a bplist00 of one dictionary. objects are the dictionary, then every key, then every value (an array holds two references to a string)
+static std::vector<uint8_t> create_binary(const std::vector<entry>& entries) {
+    auto data = std::vector<uint8_t>({ 'b', 'p', 'l', 'i', 's', 't', '0', '0' });
+    auto offsets = std::vector<uint64_t>();
+
+    uint64_t count = entries.size();
+
+    offsets.push_back(data.size());
+    append_marker(data, 0xd, count);
+
+    for (uint64_t i = 0; i < count * 2; i++) {
+        append_integer(data, 1 + i, 4);
+    }
+
+    for (const auto& entry : entries) {
+        offsets.push_back(data.size());
+        append_string(data, entry.key);
+    }
+
+    auto array_strings = std::vector<uint64_t>();
+    for (size_t i = 0; i < entries.size(); i++) {
+        offsets.push_back(data.size());
+        if (!entries[i].is_array) {
+            append_string(data, entries[i].value);
+            continue;
+        }
+
+        //the string both references point to is added after every value
+        uint64_t string = 1 + count * 2 + array_strings.size();
+        array_strings.push_back(i);
+
+        append_marker(data, 0xa, 2);
+        append_integer(data, string, 4);
+        append_integer(data, string, 4);
+    }
+
+    for (size_t index : array_strings) {
+        offsets.push_back(data.size());
+        append_string(data, entries[index].value);
+    }
+
+    uint64_t table_offset = data.size();
+    for (uint64_t offset : offsets) {
+        append_integer(data, offset, 4);
+    }
+
+    data.insert(data.end(), 6, 0);
+    data.push_back(4); //offset size
+    data.push_back(4); //reference size
+
+    append_integer(data, offsets.size(), 8);
+    append_integer(data, 0, 8);
+    append_integer(data, table_offset, 8);
+
+    return data;
+}
+
+static void check_strings(const std::map<std::string, std::string>& strings, const std::vector<entry>& entries, const char *name) {
+    for (const char *key : wanted_keys) {
+        auto expected = std::find_if(entries.begin(), entries.end(), [&](const entry& entry) { return entry.key == key; });
+        auto found = strings.find(key);
+
+        if (found == strings.end() || found->second != expected->value) {
+            error("%s: key (%s) was not read correctly", name, key);
+        }
+    }
+}
+
+template <typename F>
+static double median(int iterations, F function) {
+    auto samples = std::vector<double>();
+    for (int i = 0; i < iterations; i++) {
+        auto start = clock_type::now();
+        function();
+        samples.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+#ifdef __APPLE__
+//the old path: the whole plist as CoreFoundation objects, then one lookup per key
+static void read_with_corefoundation(const std::vector<uint8_t>& contents, std::map<std::string, std::string>& strings) {
+    CFDataRef data = CFDataCreateWithBytesNoCopy(kCFAllocatorDefault, contents.data(), static_cast<CFIndex>(contents.size()), kCFAllocatorNull);
+    auto plist = static_cast<CFDictionaryRef>(CFPropertyListCreateWithData(kCFAllocatorDefault, data, kCFPropertyListImmutable, nullptr, nullptr));
+
+    for (const char *key : wanted_keys) {
+        CFStringRef string_key = CFStringCreateWithCString(kCFAllocatorDefault, key, kCFStringEncodingUTF8);
+        auto value = static_cast<CFStringRef>(CFDictionaryGetValue(plist, string_key));
+
+        char buffer[256];
+        if (value && CFStringGetCString(value, buffer, sizeof(buffer), kCFStringEncodingUTF8)) {
+            strings[key] = buffer;
+        }
+
+        CFRelease(string_key);
+    }
+
+    CFRelease(plist);
+    CFRelease(data);
+}
+#endif
+
+int main(int argc, const char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 200;
+
+    auto keys = std::vector<const char *>(std::begin(wanted_keys), std::end(wanted_keys));
+    fprintf(stdout, "%d entries, median of %d\n", count, iterations);
+
+    for (bool wanted_first : { true, false }) {
+        auto entries = create_entries(count, wanted_first);
+
+        const std::pair<const char *, std::vector<uint8_t>> formats[] = {
+            { "xml", create_xml(entries) },
+            { "binary", create_binary(entries) }
+        };
+
+        for (const auto& format : formats) {
+            const auto& contents = format.second;
+            auto name = rmaslr::formatted_string("%s (%zu KiB), keys %s", format.first, contents.size() / 1024, wanted_first ? "first" : "last");
+
+            auto strings = std::map<std::string, std::string>();
+            double native = median(iterations, [&]() {
+                strings.clear();
+                if (!rmaslr::read_plist_strings(contents.data(), contents.size(), keys, strings)) {
+                    error("%s: not parsed", name.c_str());
+                }
+            });
+
+            check_strings(strings, entries, name.c_str());
+#ifdef __APPLE__
+            double corefoundation = median(iterations, [&]() {
+                strings.clear();
+                read_with_corefoundation(contents, strings);
+            });
+
+            check_strings(strings, entries, name.c_str());
+            fprintf(stdout, "%-36s native %9.2f us   corefoundation %9.2f us\n", name.c_str(), native, corefoundation);
+#else
+            fprintf(stdout, "%-36s native %9.2f us\n", name.c_str(), native);
+#endif
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+//
+//  startup.cc
+//  rmaslr
+//
+//  Wall time of running rmaslr for commands that should do no more than their own work (-h, and -c/-archs of a single file),
+//  against spawning this benchmark to do nothing, a c++ program loading the same runtime, so what's left is rmaslr's own startup
+//  Usage: rmaslr-bench-startup [iterations] [rmaslr-path]
+//
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include <chrono>
+
+#include "fixtures.h"
+
+extern char **environ;
+
+using clock_type = std::chrono::steady_clock;
+
+//microseconds from spawning arguments[0] to reaping it, with its output discarded
+static double run(const std::vector<const char *>& arguments) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    auto argv = arguments;
+    argv.push_back(nullptr);
+
+    auto start = clock_type::now();
+
+    pid_t pid = 0;
+    if (posix_spawnp(&pid, argv[0], &actions, nullptr, const_cast<char *const *>(argv.data()), environ) != 0) {
+        error("Unable to run %s, errno=%d(%s)", argv[0], errno, strerror(errno));
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    double elapsed = std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+    posix_spawn_file_actions_destroy(&actions);
+
+    return elapsed;
+}
+
+//median and 99th percentile of iterations runs, after a few to warm the page cache
+static std::pair<double, double> measure(const std::vector<const char *>& arguments, int iterations) {
+    for (int i = 0; i < 5; i++) {
+        run(arguments);
+    }
+
+    auto samples = std::vector<double>();
+    for (int i = 0; i < iterations; i++) {
+        samples.push_back(run(arguments));
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return { samples[samples.size() / 2], samples[std::min(samples.size() - 1, samples.size() * 99 / 100)] };
+}
+
+int main(int argc, const char *argv[]) {
+    //the baseline
+    if (argc > 1 && strcmp(argv[1], "--exit") == 0) {
+        return 0;
+    }
+
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+#ifdef RMASLR_BINARY
+    const char *rmaslr = argc > 2 ? argv[2] : RMASLR_BINARY;
+#else
+    if (argc < 3) {
+        error("Please provide the path of rmaslr");
+    }
+
+    const char *rmaslr = argv[2];
+#endif
+
+    auto root = fixtures::create_root("rmaslr-bench-startup");
+    auto path = root + "/binary";
+
+    auto fixture = fixtures::options();
+    fixture.slices = 0;
+
+    fixtures::write_file(path, fixtures::create_file(fixture));
+
+    auto spawn = measure({ "true" }, iterations);
+    fprintf(stdout, "%-24s median %8.1f us   p99 %8.1f us\n", "true", spawn.first, spawn.second);
+
+    auto baseline = measure({ argv[0], "--exit" }, iterations);
+    fprintf(stdout, "%-24s median %8.1f us   p99 %8.1f us\n", "empty c++ program", baseline.first, baseline.second);
+
+    const std::vector<std::pair<const char *, std::vector<const char *>>> commands = {
+        { "rmaslr -h", { rmaslr, "-h" } },
+        { "rmaslr -b file -c", { rmaslr, "-b", path.c_str(), "-c" } },
+        { "rmaslr -b file -archs", { rmaslr, "-b", path.c_str(), "-archs" } }
+    };
+
+    for (const auto& command : commands) {
+        auto result = measure(command.second, iterations);
+        fprintf(stdout, "%-24s median %8.1f us   p99 %8.1f us   over an empty c++ program %8.1f us\n", command.first, result.first, result.second, result.first - baseline.first);
+    }
+
+    unlink(path.c_str());
+    rmdir(root.c_str());
+
+    return 0;
+}
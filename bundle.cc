@@ -0,0 +1,173 @@
+#include <dirent.h>
+
+#include "bundle.h"
+#include "plist.h"
+
+//directories below Contents whose files are helpers run by the bundle, without an Info.plist of their own
+static const char *helper_directories[] = { "MacOS", "Helpers", "LaunchServices" };
+
+static bool is_regular_file(const std::string& path) noexcept {
+    struct stat sbuf;
+    return stat(path.c_str(), &sbuf) == 0 && S_ISREG(sbuf.st_mode);
+}
+
+static bool has_info_plist(const std::string& directory) noexcept {
+    return is_regular_file(directory + "/Info.plist") || is_regular_file(directory + "/Contents/Info.plist");
+}
+
+//"." for a bare name, which is relative to the working directory
+static std::string parent_directory(const std::string& path) noexcept {
+    auto pos = path.find_last_of('/');
+    if (pos == std::string::npos) {
+        return std::string(".");
+    }
+
+    return pos ? path.substr(0, pos) : std::string("/");
+}
+
+//where the CFBundleExecutable of an Info.plist in directory is
+static std::string executable_directory(const std::string& directory) noexcept {
+    auto name = std::find_last_component(directory);
+
+    //a mac bundle keeps its Info.plist in Contents, and its executable in Contents/MacOS
+    if (name == "Contents") {
+        return directory + "/MacOS";
+    }
+
+    //a versioned mac framework keeps it in Versions/<version>/Resources, beside its executable
+    if (name == "Resources") {
+        auto version = parent_directory(directory);
+        if (std::find_last_component(parent_directory(version)) == "Versions") {
+            return version;
+        }
+    }
+
+    return directory;
+}
+
+std::string rmaslr::find_bundle_directory(const std::string& path) noexcept {
+    auto directory = path;
+    while (directory.length() > 1 && directory.back() == '/') {
+        directory.pop_back();
+    }
+
+    struct stat sbuf;
+    if (stat(directory.c_str(), &sbuf) != 0) {
+        return std::string();
+    }
+
+    if (!S_ISDIR(sbuf.st_mode)) {
+        directory = parent_directory(directory);
+
+        //<bundle>/Contents/MacOS/<executable> on mac
+        auto contents = parent_directory(directory);
+        if (std::find_last_component(directory) == "MacOS" && std::find_last_component(contents) == "Contents") {
+            directory = parent_directory(contents);
+        }
+    }
+
+    if (!has_info_plist(directory)) {
+        return std::string();
+    }
+
+    return directory;
+}
+
+std::vector<std::string> rmaslr::find_bundle_executables(const std::string& bundle, unsigned int jobs) noexcept {
+    auto span = trace::span("find_bundle_executables", bundle.c_str());
+
+    auto executables = std::vector<std::string>();
+    auto plist_directories = std::vector<std::string>(); //every directory with an Info.plist
+
+    //only directory entries are read while walking, Info.plists are parsed afterwards on jobs threads
+    auto directories = std::vector<std::string>({ bundle });
+    while (!directories.empty()) {
+        std::string directory = std::move(directories.back());
+        directories.pop_back();
+
+        DIR *dir = opendir(directory.c_str());
+        if (!dir) {
+            continue;
+        }
+
+        auto name = std::find_last_component(directory);
+        bool helpers = directory.find("/Contents/") != std::string::npos && std::any_of(std::begin(helper_directories), std::end(helper_directories), [&name](const char *helper_directory) {
+            return name == helper_directory;
+        });
+
+        if (directory.back() != '/') {
+            directory.append(1, '/');
+        }
+
+        struct dirent *dir_entry = nullptr;
+        while ((dir_entry = readdir(dir))) {
+            if (strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) {
+                continue;
+            }
+
+            auto entry_path = directory + dir_entry->d_name;
+            auto type = dir_entry->d_type;
+
+            //not every filesystem fills in d_type
+            if (type == DT_UNKNOWN) {
+                struct stat sbuf;
+                if (lstat(entry_path.c_str(), &sbuf) != 0) {
+                    continue;
+                }
+
+                if (S_ISDIR(sbuf.st_mode)) {
+                    type = DT_DIR;
+                } else if (S_ISREG(sbuf.st_mode)) {
+                    type = DT_REG;
+                }
+            }
+
+            if (type == DT_DIR) {
+                directories.push_back(std::move(entry_path));
+            } else if (type == DT_REG) {
+                if (strcmp(dir_entry->d_name, "Info.plist") == 0) {
+                    directory.pop_back();
+                    plist_directories.push_back(directory);
+                    directory.append(1, '/');
+                } else if (helpers) {
+                    executables.push_back(std::move(entry_path));
+                }
+            }
+        }
+
+        closedir(dir);
+    }
+
+    auto bundle_executables = std::vector<std::string>(plist_directories.size());
+    parallel_for(plist_directories.size(), jobs, [&](size_t index) {
+        static const auto keys = std::vector<const char *>({ "CFBundleExecutable" });
+
+        auto strings = std::map<std::string, std::string>();
+        if (!read_plist_strings(plist_directories[index] + "/Info.plist", keys, strings)) {
+            return;
+        }
+
+        auto executable_name = strings.find("CFBundleExecutable");
+        if (executable_name == strings.end() || executable_name->second.empty() || executable_name->second.find('/') != std::string::npos) {
+            return;
+        }
+
+        //resource bundles can name an executable they don't ship
+        auto path = executable_directory(plist_directories[index]) + "/" + executable_name->second;
+        if (is_regular_file(path)) {
+            bundle_executables[index] = std::move(path);
+        }
+    });
+
+    for (auto& path : bundle_executables) {
+        if (!path.empty()) {
+            executables.push_back(std::move(path));
+        }
+    }
+
+    //a bundle's own executable is also in its Contents/MacOS
+    std::sort(executables.begin(), executables.end());
+    executables.erase(std::unique(executables.begin(), executables.end()), executables.end());
+
+    return executables;
+}
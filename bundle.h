@@ -0,0 +1,14 @@
+#pragma once
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    //the bundle path is the main executable of (the directory holding it, or holding Contents/MacOS on mac), or path itself
+    //when it's a bundle's directory. empty if neither has an Info.plist
+    std::string find_bundle_directory(const std::string& path) noexcept;
+
+    //the executable of bundle and of every bundle nested anywhere inside it (PlugIns/*.appex, Watch/*.app, XPCServices/*.xpc, frameworks,
+    //login items, ...), each found through the CFBundleExecutable of its Info.plist, along with every file in a Contents/MacOS, Helpers or
+    //LaunchServices directory. symbolic links are not followed, the Info.plists are read on at most jobs threads. sorted by path
+    std::vector<std::string> find_bundle_executables(const std::string& bundle, unsigned int jobs) noexcept;
+}
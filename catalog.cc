@@ -0,0 +1,401 @@
+#include <unordered_map>
+
+#include "catalog.h"
+
+#define CATALOG_MAGIC 0x544c4352 //"RCLT"
+#define CATALOG_VERSION 1
+
+struct catalog_record {
+    std::string bundle_path;
+
+    int64_t bundle_mtime;
+    int64_t info_mtime;
+
+    rmaslr::application application;
+};
+
+//order the fields of an application are stored in
+static std::string rmaslr::application::*catalog_fields[] = {
+    &rmaslr::application::bundle_identifier,
+    &rmaslr::application::container_name,
+    &rmaslr::application::display_name,
+    &rmaslr::application::executable_name,
+    &rmaslr::application::executable_path
+};
+
+static std::string catalog_path() noexcept {
+    const char *home = getenv("HOME");
+    if (!home) {
+        return std::string();
+    }
+
+    std::string caches = std::string(home) + "/Library/Caches";
+    if (access(caches.c_str(), W_OK) != 0) {
+        return std::string();
+    }
+
+    return caches + "/com.inoahdev.rmaslr.catalog";
+}
+
+static int64_t modification_time(const std::string& path) noexcept {
+    struct stat sbuf;
+    if (stat(path.c_str(), &sbuf) != 0) {
+        return -1;
+    }
+
+#ifdef __APPLE__
+    return static_cast<int64_t>(sbuf.st_mtimespec.tv_sec) * 1000000000 + sbuf.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(sbuf.st_mtim.tv_sec) * 1000000000 + sbuf.st_mtim.tv_nsec;
+#endif
+}
+
+static std::string info_plist_path(const std::string& bundle_path) noexcept {
+    if (rmaslr::platform::iphoneos()) {
+        return bundle_path + "/Info.plist";
+    }
+
+    return bundle_path + "/Contents/Info.plist";
+}
+
+//directories applications are installed into, a new or removed bundle changes their modification time
+static std::vector<std::pair<std::string, int64_t>> application_roots() noexcept {
+    auto roots = std::vector<std::pair<std::string, int64_t>>();
+    if (rmaslr::platform::iphoneos()) {
+        for (const char *root : { "/Applications", "/var/containers/Bundle/Application", "/private/var/mobile/Containers/Bundle/Application" }) {
+            roots.emplace_back(root, modification_time(root));
+        }
+    } else {
+        roots.emplace_back("/Applications", modification_time("/Applications"));
+    }
+
+    return roots;
+}
+
+static bool is_fresh(const catalog_record& record) noexcept {
+    return record.bundle_mtime == modification_time(record.bundle_path) && record.info_mtime == modification_time(info_plist_path(record.bundle_path));
+}
+
+static void write_value(std::string& buffer, const void *value, size_t size) noexcept {
+    buffer.append(static_cast<const char *>(value), size);
+}
+
+static void write_string(std::string& buffer, const std::string& string) noexcept {
+    uint32_t length = static_cast<uint32_t>(string.length());
+
+    write_value(buffer, &length, sizeof(length));
+    buffer.append(string);
+}
+
+template <typename T>
+static bool read_value(const rmaslr::file& file, uint64_t& offset, T& value) noexcept {
+    const T *value_ = file.at<T>(offset);
+    if (!value_) {
+        return false;
+    }
+
+    memcpy(&value, value_, sizeof(T));
+    offset += sizeof(T);
+
+    return true;
+}
+
+static bool read_string(const rmaslr::file& file, uint64_t& offset, std::string& string) noexcept {
+    uint32_t length = 0;
+    if (!read_value(file, offset, length)) {
+        return false;
+    }
+
+    const char *characters = file.at<char>(offset, length);
+    if (!characters) {
+        return false;
+    }
+
+    string.assign(characters, length);
+    offset += length;
+
+    return true;
+}
+
+static bool read_catalog(const std::string& path, std::vector<std::pair<std::string, int64_t>>& roots, std::vector<catalog_record>& records) noexcept {
+    auto file = rmaslr::file(path.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint64_t offset = 0;
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+
+    if (!read_value(file, offset, magic) || !read_value(file, offset, version)) {
+        return false;
+    }
+
+    if (magic != CATALOG_MAGIC || version != CATALOG_VERSION) {
+        return false;
+    }
+
+    uint32_t roots_count = 0;
+    if (!read_value(file, offset, roots_count)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < roots_count; i++) {
+        auto root = std::pair<std::string, int64_t>();
+        if (!read_string(file, offset, root.first) || !read_value(file, offset, root.second)) {
+            return false;
+        }
+
+        roots.push_back(std::move(root));
+    }
+
+    uint32_t records_count = 0;
+    if (!read_value(file, offset, records_count)) {
+        return false;
+    }
+
+    records.reserve(records_count);
+    for (uint32_t i = 0; i < records_count; i++) {
+        auto record = catalog_record();
+        if (!read_string(file, offset, record.bundle_path) || !read_value(file, offset, record.bundle_mtime) || !read_value(file, offset, record.info_mtime)) {
+            return false;
+        }
+
+        for (auto field : catalog_fields) {
+            if (!read_string(file, offset, record.application.*field)) {
+                return false;
+            }
+        }
+
+        records.push_back(std::move(record));
+    }
+
+    return true;
+}
+
+static void write_catalog(const std::string& path, const std::vector<std::pair<std::string, int64_t>>& roots, const std::vector<catalog_record>& records) noexcept {
+    auto buffer = std::string();
+
+    uint32_t magic = CATALOG_MAGIC;
+    uint32_t version = CATALOG_VERSION;
+
+    write_value(buffer, &magic, sizeof(magic));
+    write_value(buffer, &version, sizeof(version));
+
+    uint32_t roots_count = static_cast<uint32_t>(roots.size());
+    write_value(buffer, &roots_count, sizeof(roots_count));
+
+    for (const auto& root : roots) {
+        write_string(buffer, root.first);
+        write_value(buffer, &root.second, sizeof(root.second));
+    }
+
+    uint32_t records_count = static_cast<uint32_t>(records.size());
+    write_value(buffer, &records_count, sizeof(records_count));
+
+    for (const auto& record : records) {
+        write_string(buffer, record.bundle_path);
+
+        write_value(buffer, &record.bundle_mtime, sizeof(record.bundle_mtime));
+        write_value(buffer, &record.info_mtime, sizeof(record.info_mtime));
+
+        for (auto field : catalog_fields) {
+            write_string(buffer, record.application.*field);
+        }
+    }
+
+    //written to a temporary file first so a concurrent reader never sees a partial catalog
+    std::string temporary_path = path + ".XXXXXX";
+
+    int descriptor = mkstemp(&temporary_path[0]);
+    if (descriptor < 0) {
+        return;
+    }
+
+    bool written = write(descriptor, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+    close(descriptor);
+
+    if (!written || rename(temporary_path.c_str(), path.c_str()) != 0) {
+        unlink(temporary_path.c_str());
+    }
+}
+
+#ifdef __APPLE__
+static std::string find_directory(const std::string& path) noexcept {
+    auto pos = path.find_last_of('/');
+    if (pos == std::string::npos) {
+        return std::string();
+    }
+
+    return path.substr(0, pos);
+}
+
+static std::string copy_string(CFStringRef string) noexcept {
+    if (!string) {
+        return std::string();
+    }
+
+    const char *string_ = CFStringGetCStringPtr(string, kCFStringEncodingUTF8);
+    return string_ ? std::string(string_) : std::string();
+}
+
+static bool enumerate_springboard(std::vector<catalog_record>& cached, const std::vector<bool>& fresh, std::vector<catalog_record>& records) noexcept {
+    if (rmaslr::springboard::load() != rmaslr::springboard::load_status::ok) {
+        return false;
+    }
+
+    CFArrayRef applications = rmaslr::springboard::SBSCopyApplicationDisplayIdentifiers(false, false);
+    if (!applications) {
+        return false;
+    }
+
+    auto cached_indexes = std::unordered_map<std::string, size_t>();
+    for (size_t i = 0; i < cached.size(); i++) {
+        cached_indexes.emplace(cached[i].application.bundle_identifier, i);
+    }
+
+    auto size = CFArrayGetCount(applications);
+    records.reserve(size);
+
+    for (CFIndex i = 0; i < size; i++) {
+        CFStringRef bundle_id = (CFStringRef)CFArrayGetValueAtIndex(applications, i);
+        if (!bundle_id) {
+            continue;
+        }
+
+        std::string bundle_identifier = copy_string(bundle_id);
+        if (bundle_identifier.empty()) {
+            continue;
+        }
+
+        auto it = cached_indexes.find(bundle_identifier);
+        if (it != cached_indexes.end() && fresh[it->second]) {
+            records.push_back(std::move(cached[it->second]));
+            continue;
+        }
+
+        std::string display_name = copy_string(rmaslr::springboard::SBSCopyLocalizedApplicationNameForDisplayIdentifier(bundle_id));
+        std::string executable_path = copy_string(rmaslr::springboard::SBSCopyExecutablePathForDisplayIdentifier(bundle_id));
+
+        //apparently "iTunesU" has a null display name?
+        if (display_name.empty() || executable_path.empty()) {
+            continue;
+        }
+
+        auto record = catalog_record();
+        record.bundle_path = find_directory(executable_path);
+
+        record.bundle_mtime = modification_time(record.bundle_path);
+        record.info_mtime = modification_time(info_plist_path(record.bundle_path));
+
+        record.application.bundle_identifier = bundle_identifier;
+        record.application.display_name = display_name;
+        record.application.executable_name = std::find_last_component(executable_path);
+        record.application.executable_path = executable_path;
+
+        records.push_back(std::move(record));
+    }
+
+    return true;
+}
+#else
+//springboard only exists on iOS
+static bool enumerate_springboard(std::vector<catalog_record>&, const std::vector<bool>&, std::vector<catalog_record>&) noexcept {
+    return false;
+}
+#endif
+
+static bool enumerate_applications_directory(std::vector<catalog_record>& cached, const std::vector<bool>& fresh, std::vector<catalog_record>& records) noexcept {
+    auto cached_indexes = std::unordered_map<std::string, size_t>();
+    for (size_t i = 0; i < cached.size(); i++) {
+        cached_indexes.emplace(cached[i].bundle_path, i);
+    }
+
+    auto paths = rmaslr::find_application_containers("/Applications");
+    auto parsed = std::vector<catalog_record>(paths.size());
+
+    auto unparsed = std::vector<size_t>();
+    for (size_t i = 0; i < paths.size(); i++) {
+        auto it = cached_indexes.find(paths[i]);
+        if (it != cached_indexes.end() && fresh[it->second]) {
+            parsed[i] = std::move(cached[it->second]);
+            continue;
+        }
+
+        unparsed.push_back(i);
+    }
+
+    rmaslr::parallel_for(unparsed.size(), 0, [&](size_t index) {
+        auto& record = parsed[unparsed[index]];
+        auto& path = paths[unparsed[index]];
+
+        if (!rmaslr::parse_application_container(path, record.application)) {
+            return;
+        }
+
+        record.bundle_path = path;
+        record.bundle_mtime = modification_time(record.bundle_path);
+        record.info_mtime = modification_time(info_plist_path(record.bundle_path));
+    });
+
+    records.reserve(parsed.size());
+    for (auto& record : parsed) {
+        //not an application
+        if (record.bundle_path.empty()) {
+            continue;
+        }
+
+        records.push_back(std::move(record));
+    }
+
+    return true;
+}
+
+rmaslr::application_list rmaslr::load_applications() noexcept {
+    auto span = trace::span("load_applications");
+    auto timer = stats::timer(stats::stage::applications);
+    auto path = catalog_path();
+    auto roots = application_roots();
+
+    auto cached_roots = std::vector<std::pair<std::string, int64_t>>();
+    auto cached = std::vector<catalog_record>();
+
+    if (path.empty() || !read_catalog(path, cached_roots, cached)) {
+        cached_roots.clear();
+        cached.clear();
+    }
+
+    auto fresh = std::vector<bool>(cached.size());
+    bool up_to_date = cached_roots == roots;
+
+    for (size_t i = 0; i < cached.size(); i++) {
+        fresh[i] = is_fresh(cached[i]);
+        if (!fresh[i]) {
+            up_to_date = false;
+        }
+    }
+
+    auto records = std::vector<catalog_record>();
+    if (up_to_date) {
+        records = std::move(cached);
+    } else {
+        bool enumerated = false;
+        if (platform::iphoneos()) {
+            enumerated = enumerate_springboard(cached, fresh, records);
+        } else {
+            enumerated = enumerate_applications_directory(cached, fresh, records);
+        }
+
+        if (enumerated && !path.empty()) {
+            write_catalog(path, roots, records);
+        }
+    }
+
+    auto applications = application_list();
+    for (const auto& record : records) {
+        applications.add(record.application);
+    }
+
+    return applications;
+}
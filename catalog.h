@@ -0,0 +1,10 @@
+#pragma once
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    //every installed application, served from an on-disk catalog (~/Library/Caches/com.inoahdev.rmaslr.catalog)
+    //a bundle is only parsed again when the modification time of its directory or Info.plist changed,
+    //and the application directories are only enumerated again when one of them changed
+    application_list load_applications() noexcept;
+}
@@ -0,0 +1,209 @@
+#ifdef __APPLE__
+#include <copyfile.h>
+#else
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+#include "clone.h"
+
+//like mkdir -p for every directory leading to path
+static bool create_parent_directories(const std::string& path) noexcept {
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+        auto directory = path.substr(0, slash);
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#ifndef __APPLE__
+//copies size bytes from input to output starting at their current offsets, without a server-side or reflink copy
+static bool copy_contents(int input, int output, uint64_t size) noexcept {
+    uint64_t copied = 0;
+
+    //copy_file_range shares blocks itself on some filesystems (nfs, xfs, btrfs), and keeps the data in the kernel on the rest
+    while (copied < size) {
+        ssize_t result = copy_file_range(input, nullptr, output, nullptr, static_cast<size_t>(size - copied), 0);
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (result == 0 || errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) {
+                break;
+            }
+
+            return false;
+        }
+
+        copied += static_cast<uint64_t>(result);
+    }
+
+    while (copied < size) {
+        ssize_t result = sendfile(output, input, nullptr, static_cast<size_t>(size - copied));
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (result == 0 || errno == ENOSYS || errno == EINVAL) {
+                break;
+            }
+
+            return false;
+        }
+
+        copied += static_cast<uint64_t>(result);
+    }
+
+    char buffer[0x10000];
+    while (copied < size) {
+        ssize_t read_size = read(input, buffer, sizeof(buffer));
+        if (read_size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        //file shrunk while being copied
+        if (read_size == 0) {
+            break;
+        }
+
+        for (ssize_t written = 0; written < read_size;) {
+            ssize_t result = write(output, &buffer[written], static_cast<size_t>(read_size - written));
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return false;
+            }
+
+            written += result;
+        }
+
+        copied += static_cast<uint64_t>(read_size);
+    }
+
+    return true;
+}
+#endif
+
+bool rmaslr::clone_file(const std::string& path, const std::string& output_path) noexcept {
+    //replacing the output would empty the file itself
+    struct stat sbuf, output_sbuf;
+    if (stat(path.c_str(), &sbuf) == 0 && stat(output_path.c_str(), &output_sbuf) == 0 && sbuf.st_dev == output_sbuf.st_dev && sbuf.st_ino == output_sbuf.st_ino) {
+        errno = EEXIST;
+        return false;
+    }
+
+    if (!create_parent_directories(output_path)) {
+        return false;
+    }
+
+#ifdef __APPLE__
+    //COPYFILE_CLONE tries clonefile first, and copies the data and metadata itself where that isn't supported
+    return copyfile(path.c_str(), output_path.c_str(), nullptr, COPYFILE_ALL | COPYFILE_CLONE) == 0;
+#else
+    int input = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (input < 0) {
+        return false;
+    }
+
+    if (fstat(input, &sbuf) != 0) {
+        int error_number = errno;
+
+        close(input);
+        errno = error_number;
+
+        return false;
+    }
+
+    int output = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+    bool copied = output >= 0 && fchmod(output, sbuf.st_mode & 07777) == 0;
+    if (copied && ioctl(output, FICLONE, input) != 0) {
+        copied = copy_contents(input, output, static_cast<uint64_t>(sbuf.st_size));
+    }
+
+    int error_number = errno;
+
+    if (output >= 0 && close(output) != 0 && copied) {
+        copied = false;
+        error_number = errno;
+    }
+
+    close(input);
+    errno = error_number;
+
+    return copied;
+#endif
+}
+
+bool rmaslr::copy_range(int input, uint64_t offset, int output, uint64_t size) noexcept {
+    uint64_t copied = 0;
+
+#ifndef __APPLE__
+    auto input_offset = static_cast<loff_t>(offset);
+    while (copied < size) {
+        ssize_t result = copy_file_range(input, &input_offset, output, nullptr, static_cast<size_t>(size - copied), 0);
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (result == 0 || errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) {
+                break;
+            }
+
+            return false;
+        }
+
+        copied += static_cast<uint64_t>(result);
+    }
+#endif
+
+    char buffer[0x10000];
+    while (copied < size) {
+        size_t read_size = static_cast<size_t>(std::min<uint64_t>(sizeof(buffer), size - copied));
+
+        ssize_t result = pread(input, buffer, read_size, static_cast<off_t>(offset + copied));
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        //input shrunk while being copied
+        if (result == 0) {
+            errno = EIO;
+            return false;
+        }
+
+        for (ssize_t written = 0; written < result;) {
+            ssize_t write_result = write(output, &buffer[written], static_cast<size_t>(result - written));
+            if (write_result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return false;
+            }
+
+            written += write_result;
+        }
+
+        copied += static_cast<uint64_t>(result);
+    }
+
+    return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    //copies the file at path to output_path (replacing it), creating the directories leading to it.
+    //the copy shares path's blocks where the filesystem can clone (FICLONE on linux, clonefile on apple), so patching it
+    //afterwards only allocates the blocks actually written to. otherwise falls back to copy_file_range, sendfile, then read/write.
+    //false with errno set on failure
+    bool clone_file(const std::string& path, const std::string& output_path) noexcept;
+
+    //copies size bytes of input, from offset, to the current position of output. through copy_file_range where the kernel has it,
+    //so the data stays in the kernel (or is shared, on nfs, xfs and btrfs), otherwise pread/write. false with errno set on failure
+    bool copy_range(int input, uint64_t offset, int output, uint64_t size) noexcept;
+}
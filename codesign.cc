@@ -0,0 +1,265 @@
+#include <arpa/inet.h>
+
+#include "codesign.h"
+#include "sha.h"
+
+//from xnu's cs_blobs.h, every field of a code signature is big-endian
+#define CSMAGIC_EMBEDDED_SIGNATURE 0xfade0cc0
+#define CSMAGIC_CODEDIRECTORY 0xfade0c02
+
+#define CSSLOT_CODEDIRECTORY 0
+#define CSSLOT_ALTERNATE_CODEDIRECTORIES 0x1000
+#define CSSLOT_ALTERNATE_CODEDIRECTORY_MAX 5
+#define CSSLOT_SIGNATURESLOT 0x10000
+
+#define CS_HASHTYPE_SHA1 1
+#define CS_HASHTYPE_SHA256 2
+#define CS_HASHTYPE_SHA256_TRUNCATED 3
+
+struct blob_index {
+    uint32_t type;
+    uint32_t offset;
+};
+
+struct super_blob {
+    uint32_t magic;
+    uint32_t length;
+    uint32_t count;
+};
+
+struct generic_blob {
+    uint32_t magic;
+    uint32_t length;
+};
+
+//the fields every version of a CodeDirectory has
+struct code_directory {
+    uint32_t magic;
+    uint32_t length;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t hash_offset;
+    uint32_t ident_offset;
+    uint32_t special_slots;
+    uint32_t code_slots;
+    uint32_t code_limit;
+    uint8_t hash_size;
+    uint8_t hash_type;
+    uint8_t platform;
+    uint8_t page_size; //log2, 0 means a single page of code_limit bytes
+    uint32_t spare2;
+};
+
+//the file being updated, read and written through its descriptor
+struct descriptor_access {
+    int descriptor;
+
+    inline bool read(void *buffer, size_t size, uint64_t offset) const noexcept {
+        if (rmaslr::stats::enabled()) {
+            rmaslr::stats::add(rmaslr::stats::counter::syscalls);
+            rmaslr::stats::add(rmaslr::stats::counter::bytes_read, size);
+        }
+
+        return pread(descriptor, buffer, size, static_cast<off_t>(offset)) == static_cast<ssize_t>(size);
+    }
+
+    inline bool write(const void *buffer, size_t size, uint64_t offset) const noexcept {
+        if (rmaslr::stats::enabled()) {
+            rmaslr::stats::add(rmaslr::stats::counter::syscalls);
+            rmaslr::stats::add(rmaslr::stats::counter::bytes_written, size);
+        }
+
+        return pwrite(descriptor, buffer, size, static_cast<off_t>(offset)) == static_cast<ssize_t>(size);
+    }
+};
+
+//the file being updated, already in memory
+struct buffer_access {
+    uint8_t *data;
+    uint64_t size;
+
+    inline bool contains(size_t length, uint64_t offset) const noexcept {
+        return offset <= size && length <= size - offset;
+    }
+
+    inline bool read(void *buffer, size_t length, uint64_t offset) const noexcept {
+        if (!contains(length, offset)) {
+            return false;
+        }
+
+        memcpy(buffer, &data[offset], length);
+        return true;
+    }
+
+    inline bool write(const void *buffer, size_t length, uint64_t offset) const noexcept {
+        if (!contains(length, offset)) {
+            return false;
+        }
+
+        memcpy(&data[offset], buffer, length);
+        return true;
+    }
+};
+
+//hashes length bytes at offset with H, reading in chunks so a page of any size needs no large buffer
+template <typename H, typename A>
+static bool hash_range(const A& access, uint64_t offset, uint64_t length, uint8_t *digest) noexcept {
+    uint8_t buffer[0x4000];
+    H hash;
+
+    while (length) {
+        size_t size = static_cast<size_t>(std::min<uint64_t>(length, sizeof(buffer)));
+        if (!access.read(buffer, size, offset)) {
+            return false;
+        }
+
+        hash.update(buffer, size);
+
+        offset += size;
+        length -= size;
+    }
+
+    hash.finish(digest);
+    return true;
+}
+
+template <typename A>
+static rmaslr::signature_status update_code_directory(const A& access, const rmaslr::slice& slice, uint64_t signature, uint32_t blob_offset) noexcept {
+    if (blob_offset > slice.signature_size || slice.signature_size - blob_offset < sizeof(struct code_directory)) {
+        return rmaslr::signature_status::malformed;
+    }
+
+    struct code_directory directory;
+    if (!access.read(&directory, sizeof(directory), signature + blob_offset)) {
+        return rmaslr::signature_status::failed;
+    }
+
+    uint32_t length = ntohl(directory.length);
+    uint32_t hash_offset = ntohl(directory.hash_offset);
+
+    if (ntohl(directory.magic) != CSMAGIC_CODEDIRECTORY || length > slice.signature_size - blob_offset) {
+        return rmaslr::signature_status::malformed;
+    }
+
+    //an empty CodeDirectory does not cover page 0
+    if (!ntohl(directory.code_slots)) {
+        return rmaslr::signature_status::updated;
+    }
+
+    if (hash_offset > length || length - hash_offset < directory.hash_size) {
+        return rmaslr::signature_status::malformed;
+    }
+
+    uint64_t page_size = directory.page_size ? static_cast<uint64_t>(1) << std::min<uint8_t>(directory.page_size, 32) : UINT64_MAX;
+    uint64_t page_length = std::min<uint64_t>(page_size, ntohl(directory.code_limit));
+
+    uint8_t digest[rmaslr::sha256::digest_size];
+    bool hashed = false;
+
+    switch (directory.hash_type) {
+        case CS_HASHTYPE_SHA1:
+            if (directory.hash_size != rmaslr::sha1::digest_size) {
+                return rmaslr::signature_status::malformed;
+            }
+
+            hashed = hash_range<rmaslr::sha1>(access, slice.offset, page_length, digest);
+            break;
+        case CS_HASHTYPE_SHA256:
+        case CS_HASHTYPE_SHA256_TRUNCATED:
+            if (directory.hash_size > rmaslr::sha256::digest_size) {
+                return rmaslr::signature_status::malformed;
+            }
+
+            hashed = hash_range<rmaslr::sha256>(access, slice.offset, page_length, digest);
+            break;
+        default:
+            return rmaslr::signature_status::unsupported;
+    }
+
+    if (!hashed) {
+        return rmaslr::signature_status::failed;
+    }
+
+    uint64_t position = signature + blob_offset + hash_offset;
+    if (!access.write(digest, directory.hash_size, position)) {
+        return rmaslr::signature_status::failed;
+    }
+
+    return rmaslr::signature_status::updated;
+}
+
+template <typename A>
+static rmaslr::signature_status update_signature(const A& access, const rmaslr::slice& slice) noexcept {
+    using rmaslr::signature_status;
+    auto span = rmaslr::trace::span("update_signature");
+    auto timer = rmaslr::stats::timer(rmaslr::stats::stage::signature);
+
+    if (!slice.code_signature) {
+        return signature_status::none;
+    }
+
+    uint64_t signature = slice.offset + slice.signature_offset;
+
+    struct super_blob header;
+    if (slice.signature_size < sizeof(header)) {
+        return signature_status::malformed;
+    }
+
+    if (!access.read(&header, sizeof(header), signature)) {
+        return signature_status::failed;
+    }
+
+    uint32_t count = ntohl(header.count);
+    if (ntohl(header.magic) != CSMAGIC_EMBEDDED_SIGNATURE || count > (slice.signature_size - sizeof(header)) / sizeof(struct blob_index)) {
+        return signature_status::malformed;
+    }
+
+    auto indexes = std::vector<struct blob_index>(count);
+    if (count && !access.read(indexes.data(), count * sizeof(struct blob_index), signature + sizeof(header))) {
+        return signature_status::failed;
+    }
+
+    //an identity's CMS signature covers the CodeDirectory hashes, which no longer match once a page hash changes
+    for (const auto& index : indexes) {
+        if (ntohl(index.type) != CSSLOT_SIGNATURESLOT) {
+            continue;
+        }
+
+        uint32_t offset = ntohl(index.offset);
+        if (offset > slice.signature_size || slice.signature_size - offset < sizeof(struct generic_blob)) {
+            return signature_status::malformed;
+        }
+
+        struct generic_blob wrapper;
+        if (!access.read(&wrapper, sizeof(wrapper), signature + offset)) {
+            return signature_status::failed;
+        }
+
+        if (ntohl(wrapper.length) > sizeof(wrapper)) {
+            return signature_status::not_adhoc;
+        }
+    }
+
+    auto status = signature_status::malformed;
+    for (const auto& index : indexes) {
+        uint32_t type = ntohl(index.type);
+        if (type != CSSLOT_CODEDIRECTORY && (type < CSSLOT_ALTERNATE_CODEDIRECTORIES || type >= CSSLOT_ALTERNATE_CODEDIRECTORIES + CSSLOT_ALTERNATE_CODEDIRECTORY_MAX)) {
+            continue;
+        }
+
+        status = update_code_directory(access, slice, signature, ntohl(index.offset));
+        if (status != signature_status::updated) {
+            return status;
+        }
+    }
+
+    return status;
+}
+
+rmaslr::signature_status rmaslr::update_signature(int descriptor, const slice& slice) noexcept {
+    return ::update_signature(descriptor_access({ descriptor }), slice);
+}
+
+rmaslr::signature_status rmaslr::update_signature(uint8_t *data, uint64_t size, const slice& slice) noexcept {
+    return ::update_signature(buffer_access({ data, size }), slice);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    enum class signature_status {
+        none,        //no code signature, or the slice was not patched
+        updated,
+        not_adhoc,   //signed with an identity, only re-signing can make it valid again
+        unsupported, //a CodeDirectory uses a hash other than SHA-1/SHA-256
+        malformed,
+        failed       //reading or writing the file failed
+    };
+
+    //clearing MH_PIE only changes the first page of a slice, so after write_flags this recomputes the hash of page 0 in every
+    //CodeDirectory of slice's ad-hoc signature (read back through descriptor) and writes just those hashes.
+    //nothing else in an ad-hoc signature covers page 0, and its cdhash is never stored in the file
+    signature_status update_signature(int descriptor, const slice& slice) noexcept;
+
+    //the same, for a file held in size bytes at data
+    signature_status update_signature(uint8_t *data, uint64_t size, const slice& slice) noexcept;
+}
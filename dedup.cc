@@ -0,0 +1,174 @@
+#include <unordered_map>
+
+#include "dedup.h"
+
+static inline uint64_t rotate_left(uint64_t value, int count) noexcept {
+    return (value << count) | (value >> (64 - count));
+}
+
+//murmur3's finalizer
+static inline uint64_t mix(uint64_t value) noexcept {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+
+    return value;
+}
+
+//a fast non-cryptographic hash, two independent lanes of 8 bytes each. a match is always confirmed by comparing the files
+static uint64_t hash_content(const uint8_t *data, uint64_t size) noexcept {
+    uint64_t first = 0x9e3779b97f4a7c15ULL ^ size;
+    uint64_t second = 0xc2b2ae3d27d4eb4fULL;
+
+    uint64_t offset = 0;
+    for (; size - offset >= 16; offset += 16) {
+        uint64_t words[2];
+        memcpy(words, &data[offset], sizeof(words));
+
+        first = rotate_left(first ^ (words[0] * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+        second = rotate_left(second ^ (words[1] * 0x4cf5ad432745937fULL), 29) * 0x87c37b91114253d5ULL;
+    }
+
+    uint64_t tail = 0;
+    for (uint64_t i = offset; i < size; i++) {
+        tail = (tail << 8) | data[i];
+    }
+
+    return mix(first ^ rotate_left(second, 17) ^ mix(tail));
+}
+
+//hash of path's content, false if it is not a mach-o file or could not be read
+static bool hash_file(const std::string& path, uint64_t& hash) noexcept {
+    auto file = rmaslr::file(path.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = file.magic();
+    if (!rmaslr::is_macho_magic(magic) && !rmaslr::is_fat_magic(magic)) {
+        return false;
+    }
+
+    hash = hash_content(file.at<uint8_t>(0, file.size()), file.size());
+    return true;
+}
+
+static bool same_content(const std::string& path, const std::string& other_path) noexcept {
+    auto file = rmaslr::file(path.c_str());
+    auto other = rmaslr::file(other_path.c_str());
+
+    if (!file.is_open() || !other.is_open() || file.size() != other.size()) {
+        return false;
+    }
+
+    return memcmp(file.at<uint8_t>(0, file.size()), other.at<uint8_t>(0, other.size()), file.size()) == 0;
+}
+
+rmaslr::dedup_groups rmaslr::find_duplicates(const std::vector<std::string>& paths, unsigned int jobs) noexcept {
+    auto span = trace::span("find_duplicates");
+    auto groups = dedup_groups();
+
+    groups.representatives.resize(paths.size());
+    groups.hardlinks.assign(paths.size(), false);
+    groups.sbufs.assign(paths.size(), {});
+
+    parallel_for(paths.size(), jobs, [&](size_t index) {
+        if (stat(paths[index].c_str(), &groups.sbufs[index]) != 0) {
+            groups.sbufs[index].st_ino = 0;
+        }
+    });
+
+    //the first path to every file, then the first of every file of each size
+    auto inodes = std::map<std::pair<dev_t, ino_t>, size_t>();
+    auto sizes = std::unordered_map<off_t, std::vector<size_t>>();
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        const auto& sbuf = groups.sbufs[i];
+        groups.representatives[i] = i;
+
+        if (!sbuf.st_ino || !S_ISREG(sbuf.st_mode)) {
+            continue;
+        }
+
+        auto inserted = inodes.emplace(std::make_pair(sbuf.st_dev, sbuf.st_ino), i);
+        if (!inserted.second) {
+            groups.representatives[i] = inserted.first->second;
+            groups.hardlinks[i] = true;
+
+            continue;
+        }
+
+        //too small to hold a mach_header
+        if (sbuf.st_size >= static_cast<off_t>(sizeof(struct mach_header))) {
+            sizes[sbuf.st_size].push_back(i);
+        }
+    }
+
+    //only files sharing their size with another are read in full
+    auto candidates = std::vector<size_t>();
+    for (const auto& size : sizes) {
+        if (size.second.size() > 1) {
+            candidates.insert(candidates.end(), size.second.begin(), size.second.end());
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    auto hashes = std::vector<uint64_t>(candidates.size());
+    auto hashed = std::vector<uint8_t>(candidates.size()); //not std::vector<bool>, its elements are written from several threads
+
+    parallel_for(candidates.size(), jobs, [&](size_t index) {
+        hashed[index] = hash_file(paths[candidates[index]], hashes[index]);
+    });
+
+    //every candidate with the same size and hash as an earlier one, in path order, so a copy always comes after its representative
+    auto contents = std::map<std::pair<off_t, uint64_t>, std::vector<size_t>>();
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (!hashed[i]) {
+            continue;
+        }
+
+        size_t index = candidates[i];
+        auto& group = contents[std::make_pair(groups.sbufs[index].st_size, hashes[i])];
+
+        //a hash collision leaves the file to be parsed on its own, or to represent later copies of itself
+        bool matched = false;
+        for (size_t representative : group) {
+            if (same_content(paths[representative], paths[index])) {
+                groups.representatives[index] = representative;
+                matched = true;
+
+                break;
+            }
+        }
+
+        if (!matched) {
+            group.push_back(index);
+        }
+    }
+
+    return groups;
+}
+
+bool rmaslr::relink(const std::string& target, const std::string& path) noexcept {
+    //linked beside path first, so path is only ever replaced whole
+    auto temporary_path = path + ".rmaslr-link";
+    unlink(temporary_path.c_str());
+
+    if (link(target.c_str(), temporary_path.c_str()) != 0) {
+        return false;
+    }
+
+    if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+        int error_number = errno;
+
+        unlink(temporary_path.c_str());
+        errno = error_number;
+
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    enum class dedup_policy {
+        none,
+        edit, //identical copies are given the same edit as the file they duplicate, without being parsed
+        link  //identical copies are replaced by a hard link to the file they duplicate
+    };
+
+    struct dedup_groups {
+        //for every path, the index of the path it duplicates, or its own index. a duplicate always comes after its representative
+        std::vector<size_t> representatives;
+
+        //for every duplicate, whether it is another link to the same file rather than an identical copy
+        std::vector<bool> hardlinks;
+
+        //of every path, st_ino is 0 when it could not be stat'd
+        std::vector<struct stat> sbufs;
+    };
+
+    //groups paths by device and inode, then mach-o files of equal size by a hash of their content,
+    //confirmed by comparing them, so each distinct file is only parsed once. hashing runs on at most jobs threads
+    dedup_groups find_duplicates(const std::vector<std::string>& paths, unsigned int jobs) noexcept;
+
+    //atomically replaces path with a hard link to target, false with errno set on failure
+    bool relink(const std::string& target, const std::string& path) noexcept;
+}
@@ -0,0 +1,814 @@
+#include "engine.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define RMASLR_IO_URING 1
+#endif
+#endif
+
+#ifndef RMASLR_IO_URING
+
+bool rmaslr::process_files_io_uring(const std::vector<std::string>&, const rmaslr::batch_options&, const rmaslr::result_handler&) noexcept {
+    return false;
+}
+
+#else
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+#include <climits>
+#include <cstddef>
+
+//covers the mach_header of a thin file and the fat_arch table of every fat file with fewer than 204 architectures
+#define PREFIX_SIZE 4096
+
+static bool supports_operations(int descriptor) noexcept {
+    auto buffer = std::vector<uint64_t>((sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op)) / sizeof(uint64_t) + 1);
+    auto probe = reinterpret_cast<struct io_uring_probe *>(buffer.data());
+
+    if (syscall(__NR_io_uring_register, descriptor, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0) {
+        return false;
+    }
+
+    for (int operation : { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+        if (operation > probe->last_op || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//submission and completion rings set up directly through the system calls, so liburing is not required
+class ring {
+public:
+    explicit ring(unsigned int entries) noexcept {
+        struct io_uring_params params = {};
+
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+
+        int descriptor = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (descriptor < 0) {
+            return;
+        }
+
+        //more operations than the completion ring holds can be in flight, they must never be dropped
+        if (!(params.features & IORING_FEAT_NODROP) || !supports_operations(descriptor)) {
+            close(descriptor);
+            return;
+        }
+
+        sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cq_map_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+        bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_map) {
+            sq_map_size_ = cq_map_size_ = std::max(sq_map_size_, cq_map_size_);
+        }
+
+        sq_map_ = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+        if (sq_map_ == MAP_FAILED) {
+            sq_map_ = nullptr;
+            close(descriptor);
+
+            return;
+        }
+
+        if (single_map) {
+            cq_map_ = sq_map_;
+        } else {
+            cq_map_ = mmap(nullptr, cq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+            if (cq_map_ == MAP_FAILED) {
+                cq_map_ = nullptr;
+                close(descriptor);
+
+                return;
+            }
+        }
+
+        sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes_ = static_cast<struct io_uring_sqe *>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES));
+
+        if (sqes_ == MAP_FAILED) {
+            sqes_ = nullptr;
+            close(descriptor);
+
+            return;
+        }
+
+        auto sq = static_cast<uint8_t *>(sq_map_);
+        auto cq = static_cast<uint8_t *>(cq_map_);
+
+        sq_head_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+
+        cq_head_ = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        tail_ = *sq_tail_;
+        descriptor_ = descriptor;
+    }
+
+    ring(const ring&) = delete;
+    ring& operator=(const ring&) = delete;
+
+    ~ring() noexcept {
+        if (sqes_) {
+            munmap(sqes_, sqes_size_);
+        }
+
+        if (cq_map_ && cq_map_ != sq_map_) {
+            munmap(cq_map_, cq_map_size_);
+        }
+
+        if (sq_map_) {
+            munmap(sq_map_, sq_map_size_);
+        }
+
+        if (descriptor_ >= 0) {
+            close(descriptor_);
+        }
+    }
+
+    inline bool is_open() const noexcept {
+        return descriptor_ >= 0;
+    }
+
+    //a cleared submission entry, queued entries are submitted first when the ring is full. nullptr if submitting failed
+    struct io_uring_sqe *next(uint64_t user_data) noexcept {
+        if (tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            if (!enter(0) || tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+                return nullptr;
+            }
+        }
+
+        unsigned int index = tail_ & sq_mask_;
+        struct io_uring_sqe *sqe = &sqes_[index];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = user_data;
+
+        sq_array_[index] = index;
+
+        tail_++;
+        queued_++;
+
+        return sqe;
+    }
+
+    //submits every queued entry and waits for at least one completion, the time spent waiting on the kernel is its span
+    inline bool submit_and_wait() noexcept {
+        auto span = rmaslr::trace::span("io_uring_wait");
+        return enter(1);
+    }
+
+    //calls function(user_data, result) for every completion available
+    template <typename F>
+    void drain(F function) noexcept {
+        unsigned int head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe cqe = cqes_[head & cq_mask_];
+            __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+
+            function(cqe.user_data, cqe.res);
+        }
+    }
+private:
+    int descriptor_ = -1;
+
+    void *sq_map_ = nullptr;
+    size_t sq_map_size_ = 0;
+
+    void *cq_map_ = nullptr;
+    size_t cq_map_size_ = 0;
+
+    struct io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned int *sq_head_ = nullptr;
+    unsigned int *sq_tail_ = nullptr;
+    unsigned int *sq_array_ = nullptr;
+
+    unsigned int sq_mask_ = 0;
+    unsigned int sq_entries_ = 0;
+
+    unsigned int *cq_head_ = nullptr;
+    unsigned int *cq_tail_ = nullptr;
+    unsigned int cq_mask_ = 0;
+
+    struct io_uring_cqe *cqes_ = nullptr;
+
+    unsigned int tail_ = 0;
+    unsigned int queued_ = 0;
+
+    bool enter(unsigned int wait) noexcept {
+        __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+        for (;;) {
+            long submitted = syscall(__NR_io_uring_enter, descriptor_, queued_, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            rmaslr::stats::add_syscalls(1);
+
+            if (submitted >= 0) {
+                queued_ -= static_cast<unsigned int>(submitted);
+                return true;
+            }
+
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+};
+
+enum class job_state {
+    opening,
+    reading_prefix,
+    reading_table,
+    reading_headers,
+    reopening,
+    journaling,
+    writing,
+    closing
+};
+
+//one file being processed, slots are reused for the next file once closed so their buffers are only allocated once
+struct job {
+    size_t index = 0;
+
+    job_state state = job_state::opening;
+    uint32_t pending = 0;
+
+    int descriptor = -1;
+    int write_descriptor = -1;
+
+    std::vector<uint8_t> buffer;
+    uint64_t length = 0;
+
+    std::vector<rmaslr::slice> slices;
+
+    //header and load commands of slices not already in buffer, and how much of them could be read
+    std::vector<std::vector<uint8_t>> slice_buffers;
+    std::vector<uint64_t> available;
+
+    std::vector<size_t> removals;
+    std::vector<uint32_t> flags;
+
+    rmaslr::file_result result;
+
+    int error_number = 0;
+    uint32_t failing_index = UINT32_MAX;
+};
+
+class engine {
+public:
+    engine(ring& ring, const std::vector<std::string>& paths, const rmaslr::batch_options& options, const rmaslr::result_handler& handler) noexcept
+    : ring_(ring), paths_(paths), options_(options), handler_(handler) {}
+
+    void run() noexcept {
+        size_t depth = std::min(static_cast<size_t>(std::max(options_.queue_depth, 1u)), paths_.size());
+        jobs_.resize(depth);
+
+        size_t active = 0;
+        for (uint32_t slot = 0; slot < depth; slot++) {
+            start(slot);
+            active++;
+        }
+
+        while (active) {
+            commit_journal(active);
+            if (!active) {
+                break;
+            }
+
+            if (!ring_.submit_and_wait()) {
+                error("Unable to submit to io_uring, errno=%d(%s)", errno, strerror(errno));
+            }
+
+            ring_.drain([&](uint64_t user_data, int32_t result) {
+                auto slot = static_cast<uint32_t>(user_data >> 32);
+                if (complete(slot, static_cast<uint32_t>(user_data), result)) {
+                    finish(slot, active);
+                }
+            });
+        }
+    }
+private:
+    ring& ring_;
+
+    const std::vector<std::string>& paths_;
+    const rmaslr::batch_options& options_;
+    const rmaslr::result_handler& handler_;
+
+    std::vector<job> jobs_;
+    size_t next_ = 0;
+
+    //slots whose journal entries are appended but not yet committed
+    std::vector<uint32_t> journaling_;
+
+    void finish(uint32_t slot, size_t& active) noexcept {
+        auto& job = jobs_[slot];
+        handler_(job.index, std::move(job.result));
+
+        if (next_ < paths_.size()) {
+            start(slot);
+        } else {
+            active--;
+        }
+    }
+
+    //one sync for the entries of every file that reached this point since the last time around the loop
+    void commit_journal(size_t& active) noexcept {
+        if (journaling_.empty()) {
+            return;
+        }
+
+        bool journaled = options_.journal->commit();
+        int error_number = errno;
+
+        auto slots = std::move(journaling_);
+        journaling_.clear();
+
+        for (uint32_t slot : slots) {
+            bool done = journaled ? submit_writes(slot) : fail(slot, rmaslr::formatted_string("could not be journaled, errno=%d(%s)", error_number, strerror(error_number)));
+            if (done) {
+                finish(slot, active);
+            }
+        }
+    }
+
+    struct io_uring_sqe *prepare(uint32_t slot, uint32_t operation, uint8_t opcode, int descriptor, const void *address, uint32_t length, uint64_t offset) noexcept {
+        struct io_uring_sqe *sqe = ring_.next(static_cast<uint64_t>(slot) << 32 | operation);
+        if (!sqe) {
+            error("Unable to submit to io_uring, errno=%d(%s)", errno, strerror(errno));
+        }
+
+        sqe->opcode = opcode;
+        sqe->fd = descriptor;
+        sqe->addr = reinterpret_cast<uintptr_t>(address);
+        sqe->len = length;
+        sqe->off = offset;
+
+        jobs_[slot].pending++;
+        return sqe;
+    }
+
+    void start(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+
+        job.index = next_++;
+        job.state = job_state::opening;
+        job.pending = 0;
+
+        job.descriptor = -1;
+        job.write_descriptor = -1;
+
+        if (job.buffer.size() < PREFIX_SIZE) {
+            job.buffer.resize(PREFIX_SIZE);
+        }
+
+        job.length = 0;
+
+        job.slices.clear();
+        job.available.clear();
+        job.removals.clear();
+
+        job.error_number = 0;
+        job.failing_index = UINT32_MAX;
+
+        const std::string& path = paths_[job.index];
+        job.result = rmaslr::file_result();
+        job.result.path = path;
+
+        struct io_uring_sqe *sqe = prepare(slot, 0, IORING_OP_OPENAT, AT_FDCWD, path.c_str(), 0, 0);
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    }
+
+    //returns true once the file is done and its slot is free
+    bool complete(uint32_t slot, uint32_t operation, int32_t result) noexcept {
+        auto& job = jobs_[slot];
+        auto& file_result = job.result;
+
+        job.pending--;
+        if (rmaslr::stats::enabled()) {
+            count_completion(job.state, result);
+        }
+
+        switch (job.state) {
+            case job_state::opening:
+                if (result < 0) {
+                    file_result.status = rmaslr::file_status::failed;
+                    file_result.error = rmaslr::formatted_string("could not be opened, errno=%d(%s)", -result, strerror(-result));
+
+                    return true;
+                }
+
+                job.descriptor = result;
+                job.state = job_state::reading_prefix;
+
+                prepare(slot, 0, IORING_OP_READ, job.descriptor, job.buffer.data(), PREFIX_SIZE, 0);
+                return false;
+            case job_state::reading_prefix:
+                if (result < 0) {
+                    return fail(slot, rmaslr::formatted_string("could not be read, errno=%d(%s)", -result, strerror(-result)));
+                }
+
+                job.length = static_cast<uint64_t>(result);
+                return parse_prefix(slot);
+            case job_state::reading_table:
+                if (result < 0) {
+                    return fail(slot, rmaslr::formatted_string("could not be read, errno=%d(%s)", -result, strerror(-result)));
+                }
+
+                job.length = static_cast<uint64_t>(result);
+                return parse_table(slot);
+            case job_state::reading_headers:
+                if (result < 0) {
+                    job.error_number = -result;
+                } else if (!result) {
+                    job.failing_index = std::min(job.failing_index, operation);
+                } else {
+                    job.available[operation] = static_cast<uint64_t>(result);
+                    read_remaining_commands(slot, operation);
+                }
+
+                if (job.pending) {
+                    return false;
+                }
+
+                return resolve_headers(slot);
+            case job_state::journaling:
+                return false;
+            case job_state::reopening:
+                if (result < 0) {
+                    return fail(slot, rmaslr::formatted_string("could not be opened for writing, errno=%d(%s)", -result, strerror(-result)));
+                }
+
+                job.write_descriptor = result;
+                return write_flags(slot);
+            case job_state::writing:
+                if (result != sizeof(uint32_t) && file_result.status != rmaslr::file_status::failed) {
+                    int error_number = result < 0 ? -result : EIO;
+
+                    file_result.status = rmaslr::file_status::failed;
+                    file_result.error = rmaslr::formatted_string("could not be written to at offset 0x%.16llX, errno=%d(%s)", static_cast<unsigned long long>(job.slices[job.removals[operation]].offset), error_number, strerror(error_number));
+                }
+
+                if (job.pending) {
+                    return false;
+                }
+
+                update_signatures(slot);
+                return close_descriptors(slot);
+            case job_state::closing:
+                return !job.pending;
+        }
+
+        return false;
+    }
+
+    //operations go through the ring rather than the instrumented calls, so are counted as they complete
+    static void count_completion(job_state state, int32_t result) noexcept {
+        using namespace rmaslr::stats;
+        if (result < 0) {
+            return;
+        }
+
+        switch (state) {
+            case job_state::opening:
+                add(counter::files);
+                break;
+            case job_state::reading_prefix:
+            case job_state::reading_table:
+            case job_state::reading_headers:
+                add(counter::bytes_read, static_cast<uint64_t>(result));
+                break;
+            case job_state::writing:
+                add(counter::bytes_written, static_cast<uint64_t>(result));
+                break;
+            default:
+                break;
+        }
+    }
+
+    bool fail(uint32_t slot, const std::string& error) noexcept {
+        auto& file_result = jobs_[slot].result;
+
+        file_result.status = rmaslr::file_status::failed;
+        file_result.error = error;
+
+        return close_descriptors(slot);
+    }
+
+    bool close_descriptors(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+        job.state = job_state::closing;
+
+        for (int descriptor : { job.descriptor, job.write_descriptor }) {
+            if (descriptor >= 0) {
+                prepare(slot, 0, IORING_OP_CLOSE, descriptor, nullptr, 0, 0);
+            }
+        }
+
+        return !job.pending;
+    }
+
+    bool parse_prefix(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+
+        uint32_t magic = 0;
+        if (job.length >= sizeof(magic)) {
+            memcpy(&magic, job.buffer.data(), sizeof(magic));
+        }
+
+        if (!rmaslr::is_macho_magic(magic) && !rmaslr::is_fat_magic(magic)) {
+            job.result.status = rmaslr::file_status::skipped;
+            return close_descriptors(slot);
+        }
+
+        if (job.length < sizeof(struct mach_header_64)) {
+            return fail(slot, rmaslr::describe_parse_status(rmaslr::parse_status::not_macho, 0, 0));
+        }
+
+        if (rmaslr::is_macho_magic(magic)) {
+            auto slice = rmaslr::slice();
+            slice.header = reinterpret_cast<const struct mach_header *>(job.buffer.data());
+
+            rmaslr::decode_header(slice, true);
+            job.slices.push_back(slice);
+
+            return read_load_commands(slot);
+        }
+
+        auto header = reinterpret_cast<const struct fat_header *>(job.buffer.data());
+        if (rmaslr::is_java_class(header)) {
+            job.result.status = rmaslr::file_status::skipped;
+            return close_descriptors(slot);
+        }
+
+        uint32_t architectures_count = rmaslr::fat_architectures_count(header);
+        if (!architectures_count) {
+            return fail(slot, rmaslr::describe_parse_status(rmaslr::parse_status::no_architectures, 0, 0));
+        }
+
+        uint64_t table_end = table_size(header);
+        if (table_end <= job.length) {
+            return parse_table(slot);
+        }
+
+        //the whole file was read already, or nfat_arch is larger than the file could hold
+        struct stat sbuf;
+        if (job.length < PREFIX_SIZE || fstat(job.descriptor, &sbuf) != 0 || table_end > static_cast<uint64_t>(sbuf.st_size)) {
+            return fail(slot, rmaslr::describe_parse_status(rmaslr::parse_status::too_small, architectures_count, 0));
+        }
+
+        job.buffer.resize(table_end);
+        job.state = job_state::reading_table;
+
+        prepare(slot, 0, IORING_OP_READ, job.descriptor, job.buffer.data(), static_cast<uint32_t>(table_end), 0);
+        return false;
+    }
+
+    static uint64_t table_size(const struct fat_header *header) noexcept {
+        uint64_t architectures_count = rmaslr::fat_architectures_count(header);
+        if (header->magic == FAT_MAGIC_64 || header->magic == FAT_CIGAM_64) {
+            return sizeof(struct fat_header) + architectures_count * sizeof(struct fat_arch_64);
+        }
+
+        return sizeof(struct fat_header) + architectures_count * sizeof(struct fat_arch);
+    }
+
+    bool parse_table(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+        auto header = reinterpret_cast<const struct fat_header *>(job.buffer.data());
+
+        uint32_t architectures_count = rmaslr::fat_architectures_count(header);
+        if (table_size(header) > job.length) {
+            return fail(slot, rmaslr::describe_parse_status(rmaslr::parse_status::too_small, architectures_count, 0));
+        }
+
+        uint32_t failing_index = 0;
+
+        auto status = rmaslr::parse_fat_table(header, job.slices, &failing_index);
+        if (status != rmaslr::parse_status::ok) {
+            return fail(slot, rmaslr::describe_parse_status(status, architectures_count, failing_index));
+        }
+
+        return read_load_commands(slot);
+    }
+
+    //offset past the load commands of header, relative to it. only the header itself when it is not a mach-o header, which
+    //resolve_headers then skips the file for
+    static uint64_t commands_end(const struct mach_header *header) noexcept {
+        if (!rmaslr::is_macho_magic(header->magic)) {
+            return sizeof(struct mach_header);
+        }
+
+        return rmaslr::header_size(header) + rmaslr::with_header_view(header, [](auto view) {
+            return view.sizeofcmds();
+        });
+    }
+
+    //headers and load commands already in the buffer are used in place, the rest are all read at once,
+    //a page at each slice's offset first, which holds every load command of most binaries
+    bool read_load_commands(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+        auto count = job.slices.size();
+
+        if (job.slice_buffers.size() < count) {
+            job.slice_buffers.resize(count);
+        }
+
+        job.available.assign(count, 0);
+        job.state = job_state::reading_headers;
+
+        for (uint32_t i = 0; i < count; i++) {
+            auto& slice = job.slices[i];
+            if (slice.offset + sizeof(struct mach_header) <= job.length) {
+                auto header = reinterpret_cast<const struct mach_header *>(&job.buffer[slice.offset]);
+                if (slice.offset + commands_end(header) <= job.length) {
+                    slice.header = header;
+                    job.available[i] = job.length - slice.offset;
+
+                    continue;
+                }
+            }
+
+            //set once read, its buffer may still grow
+            slice.header = nullptr;
+
+            auto& buffer = job.slice_buffers[i];
+            buffer.resize(PREFIX_SIZE);
+
+            prepare(slot, i, IORING_OP_READ, job.descriptor, buffer.data(), PREFIX_SIZE, slice.offset);
+        }
+
+        if (job.pending) {
+            return false;
+        }
+
+        return resolve_headers(slot);
+    }
+
+    //reads the rest of slice's load commands when they did not fit in its buffer, as far as the file goes
+    void read_remaining_commands(uint32_t slot, uint32_t index) noexcept {
+        auto& job = jobs_[slot];
+        auto& buffer = job.slice_buffers[index];
+
+        //a short read already reached the end of the file
+        if (job.available[index] < buffer.size()) {
+            return;
+        }
+
+        uint64_t end = commands_end(reinterpret_cast<const struct mach_header *>(buffer.data()));
+        if (end <= buffer.size()) {
+            return;
+        }
+
+        const auto& slice = job.slices[index];
+
+        struct stat sbuf;
+        if (fstat(job.descriptor, &sbuf) != 0 || static_cast<uint64_t>(sbuf.st_size) <= slice.offset + buffer.size()) {
+            return;
+        }
+
+        end = std::min<uint64_t>({ end, static_cast<uint64_t>(sbuf.st_size) - slice.offset, UINT32_MAX });
+        buffer.resize(end);
+
+        prepare(slot, index, IORING_OP_READ, job.descriptor, buffer.data(), static_cast<uint32_t>(end), slice.offset);
+    }
+
+    bool resolve_headers(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+        if (job.error_number) {
+            return fail(slot, rmaslr::formatted_string("could not be read, errno=%d(%s)", job.error_number, strerror(job.error_number)));
+        }
+
+        if (job.failing_index != UINT32_MAX) {
+            return fail(slot, rmaslr::describe_parse_status(rmaslr::parse_status::placed_past_end, 0, job.failing_index));
+        }
+
+        for (uint32_t i = 0; i < job.slices.size(); i++) {
+            auto& slice = job.slices[i];
+            if (!slice.header) {
+                slice.header = reinterpret_cast<const struct mach_header *>(job.slice_buffers[i].data());
+            }
+
+            //same as parse_slices, a fat file with a slice that isn't a whole mach-o header (a universal static library) is skipped
+            if (!rmaslr::is_macho_header(slice.header, job.available[i])) {
+                job.result.status = rmaslr::file_status::skipped;
+                return close_descriptors(slot);
+            }
+        }
+
+        for (uint32_t i = 0; i < job.slices.size(); i++) {
+            auto& slice = job.slices[i];
+
+            rmaslr::decode_header(slice, false);
+            rmaslr::inspect_load_commands(slice, job.available[i]);
+        }
+
+        return plan(slot);
+    }
+
+    bool plan(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+
+        job.removals = rmaslr::plan_slices(job.slices, options_, job.result);
+        if (job.removals.empty()) {
+            return close_descriptors(slot);
+        }
+
+        job.state = job_state::reopening;
+
+        struct io_uring_sqe *sqe = prepare(slot, 0, IORING_OP_OPENAT, AT_FDCWD, paths_[job.index].c_str(), 0, 0);
+        sqe->open_flags = O_RDWR | O_CLOEXEC;
+
+        return false;
+    }
+
+    bool write_flags(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+
+        //same check as file::make_writable, the path must still refer to the file that was read
+        struct stat read_sbuf;
+        struct stat write_sbuf;
+
+        if (fstat(job.descriptor, &read_sbuf) != 0 || fstat(job.write_descriptor, &write_sbuf) != 0) {
+            return fail(slot, rmaslr::formatted_string("could not be opened for writing, errno=%d(%s)", errno, strerror(errno)));
+        }
+
+        if (read_sbuf.st_dev != write_sbuf.st_dev || read_sbuf.st_ino != write_sbuf.st_ino) {
+            return fail(slot, rmaslr::formatted_string("could not be opened for writing, errno=%d(%s)", ESTALE, strerror(ESTALE)));
+        }
+
+        if (options_.journal) {
+            for (size_t index : job.removals) {
+                const auto& slice = job.slices[index];
+                options_.journal->append(paths_[job.index], read_sbuf, slice.offset, rmaslr::to_file_order(slice, slice.flags), rmaslr::to_file_order(slice, slice.flags & ~MH_PIE));
+            }
+
+            job.state = job_state::journaling;
+            journaling_.push_back(slot);
+
+            return false;
+        }
+
+        return submit_writes(slot);
+    }
+
+    bool submit_writes(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+
+        job.flags.resize(job.removals.size());
+        job.state = job_state::writing;
+
+        for (uint32_t i = 0; i < job.removals.size(); i++) {
+            const auto& slice = job.slices[job.removals[i]];
+            job.flags[i] = rmaslr::to_file_order(slice, slice.flags & ~MH_PIE);
+
+            prepare(slot, i, IORING_OP_WRITE, job.write_descriptor, &job.flags[i], sizeof(uint32_t), slice.offset + offsetof(struct mach_header, flags));
+        }
+
+        return false;
+    }
+
+    //done in place on this thread, only signed slices have any and each is a few small reads and one write
+    void update_signatures(uint32_t slot) noexcept {
+        auto& job = jobs_[slot];
+        if (job.result.status == rmaslr::file_status::failed) {
+            return;
+        }
+
+        for (size_t index : job.removals) {
+            const auto& slice = job.slices[index];
+            if (slice.code_signature) {
+                rmaslr::find_slice_result(job.result, slice.offset)->signature = rmaslr::update_signature(job.write_descriptor, slice);
+            }
+        }
+    }
+};
+
+bool rmaslr::process_files_io_uring(const std::vector<std::string>& paths, const rmaslr::batch_options& options, const rmaslr::result_handler& handler) noexcept {
+    if (paths.empty()) {
+        return false;
+    }
+
+    unsigned int depth = std::min(std::max(options.queue_depth, 1u), 4096u);
+
+    ::ring uring(depth * 2);
+    if (!uring.is_open()) {
+        return false;
+    }
+
+    ::engine(uring, paths, options, handler).run();
+
+    return true;
+}
+
+#endif
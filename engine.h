@@ -0,0 +1,11 @@
+#pragma once
+
+#include "batch.h"
+
+namespace rmaslr {
+    //processes every file in paths on the calling thread through io_uring, keeping options.queue_depth files in flight.
+    //each file is a small state machine (open, read the header or fat table, read slice headers and load commands, reopen, journal, write flags, close)
+    //whose operations are submitted together with those of every other file and completed in any order.
+    //returns false without calling handler when io_uring is unavailable (not linux, or disabled/too old in the kernel)
+    bool process_files_io_uring(const std::vector<std::string>& paths, const batch_options& options, const result_handler& handler) noexcept;
+}
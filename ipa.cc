@@ -0,0 +1,752 @@
+#include <zlib.h>
+
+#include "clone.h"
+#include "ipa.h"
+#include "plist.h"
+
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define ZIP_END_SIGNATURE 0x06054b50
+#define ZIP64_END_SIGNATURE 0x06064b50
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP_DESCRIPTOR_SIGNATURE 0x08074b50
+
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_END_SIZE 22
+#define ZIP64_END_SIZE 56
+#define ZIP64_LOCATOR_SIZE 20
+
+#define ZIP_FLAG_ENCRYPTED 0x1
+#define ZIP_FLAG_DESCRIPTOR 0x8
+
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+#define ZIP64_EXTRA_ID 0x0001
+
+//a 32-bit size or offset holding this has its value in the zip64 extra field instead
+#define ZIP64_MARKER 0xffffffff
+
+//the most deflate can expand its input by, a 258-byte match for every 2 bits
+#define DEFLATE_MAX_RATIO 1032
+
+//stored entries are compared and written back in pages
+#define PATCH_CHUNK_SIZE 0x1000
+
+//zip is little-endian throughout
+static inline uint16_t read16(const uint8_t *data) noexcept {
+    return static_cast<uint16_t>(data[0] | data[1] << 8);
+}
+
+static inline uint32_t read32(const uint8_t *data) noexcept {
+    return static_cast<uint32_t>(read16(data)) | static_cast<uint32_t>(read16(&data[2])) << 16;
+}
+
+static inline uint64_t read64(const uint8_t *data) noexcept {
+    return static_cast<uint64_t>(read32(data)) | static_cast<uint64_t>(read32(&data[4])) << 32;
+}
+
+static inline void write16(uint8_t *data, uint16_t value) noexcept {
+    data[0] = static_cast<uint8_t>(value);
+    data[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static inline void write32(uint8_t *data, uint32_t value) noexcept {
+    write16(data, static_cast<uint16_t>(value));
+    write16(&data[2], static_cast<uint16_t>(value >> 16));
+}
+
+static inline void write64(uint8_t *data, uint64_t value) noexcept {
+    write32(data, static_cast<uint32_t>(value));
+    write32(&data[4], static_cast<uint32_t>(value >> 32));
+}
+
+struct zip_entry {
+    std::string name;
+
+    uint16_t flags;
+    uint16_t method;
+    uint32_t crc;
+
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
+    uint64_t local_offset;
+
+    uint64_t central_offset; //of its central directory header
+    uint64_t data_offset;    //past its local header
+    uint64_t end_offset;     //where the next entry (or the central directory) starts
+
+    //where the central header keeps each value, in its zip64 extra field when not 0, otherwise in its own field
+    uint64_t compressed_size_extra;
+    uint64_t uncompressed_size_extra;
+    uint64_t local_offset_extra;
+};
+
+struct zip_archive {
+    std::vector<zip_entry> entries;
+
+    uint64_t central_offset;
+    uint64_t central_end; //where the zip64 end record, locator and end record follow
+
+    uint64_t end_offset;       //of the end of central directory record
+    uint64_t zip64_end_offset; //of the zip64 end record, 0 when there is none
+    uint64_t locator_offset;
+};
+
+static bool find_end(const rmaslr::file& file, zip_archive& archive) noexcept {
+    if (file.size() < ZIP_END_SIZE) {
+        return false;
+    }
+
+    //the record is last, followed only by a comment of at most 0xffff bytes
+    uint64_t last = file.size() - ZIP_END_SIZE;
+    uint64_t first = last > 0xffff ? last - 0xffff : 0;
+
+    const uint8_t *data = file.at<uint8_t>(first, last - first + ZIP_END_SIZE);
+    for (uint64_t offset = last + 1; offset-- > first;) {
+        const uint8_t *record = &data[offset - first];
+        if (read32(record) == ZIP_END_SIGNATURE && offset + ZIP_END_SIZE + read16(&record[20]) == file.size()) {
+            archive.end_offset = offset;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//the 64-bit values of a central header whose 32-bit fields hold ZIP64_MARKER, in the order they appear in
+static bool read_zip64_extra(const rmaslr::file& file, uint64_t extra_offset, uint16_t extra_size, zip_entry& entry, bool uncompressed, bool compressed, bool local) noexcept {
+    const uint8_t *extra = file.at<uint8_t>(extra_offset, extra_size);
+    for (uint64_t position = 0; position + 4 <= extra_size;) {
+        uint16_t id = read16(&extra[position]);
+        uint16_t size = read16(&extra[position + 2]);
+
+        if (position + 4 + size > extra_size) {
+            return false;
+        }
+
+        if (id != ZIP64_EXTRA_ID) {
+            position += 4 + size;
+            continue;
+        }
+
+        uint64_t field = position + 4;
+        uint64_t end = field + size;
+
+        const bool *present[] = { &uncompressed, &compressed, &local };
+        uint64_t *values[] = { &entry.uncompressed_size, &entry.compressed_size, &entry.local_offset };
+        uint64_t *locations[] = { &entry.uncompressed_size_extra, &entry.compressed_size_extra, &entry.local_offset_extra };
+
+        for (int i = 0; i < 3; i++) {
+            if (!*present[i]) {
+                continue;
+            }
+
+            if (field + 8 > end) {
+                return false;
+            }
+
+            *values[i] = read64(&extra[field]);
+            *locations[i] = extra_offset + field;
+
+            field += 8;
+        }
+
+        return true;
+    }
+
+    return !uncompressed && !compressed && !local;
+}
+
+static bool parse_archive(const rmaslr::file& file, zip_archive& archive, std::string& error) noexcept {
+    archive = zip_archive();
+    if (!find_end(file, archive)) {
+        error = "is not a zip archive";
+        return false;
+    }
+
+    const uint8_t *end = file.at<uint8_t>(archive.end_offset, ZIP_END_SIZE);
+
+    uint64_t count = read16(&end[10]);
+    uint64_t central_size = read32(&end[12]);
+    uint64_t central_offset = read32(&end[16]);
+
+    const uint8_t *locator = archive.end_offset >= ZIP64_LOCATOR_SIZE ? file.at<uint8_t>(archive.end_offset - ZIP64_LOCATOR_SIZE, ZIP64_LOCATOR_SIZE) : nullptr;
+    if (locator && read32(locator) == ZIP64_LOCATOR_SIGNATURE) {
+        archive.locator_offset = archive.end_offset - ZIP64_LOCATOR_SIZE;
+        archive.zip64_end_offset = read64(&locator[8]);
+
+        const uint8_t *zip64_end = file.at<uint8_t>(archive.zip64_end_offset, ZIP64_END_SIZE);
+        if (!zip64_end || read32(zip64_end) != ZIP64_END_SIGNATURE) {
+            error = "has an invalid zip64 end of central directory record";
+            return false;
+        }
+
+        count = read64(&zip64_end[32]);
+        central_size = read64(&zip64_end[40]);
+        central_offset = read64(&zip64_end[48]);
+    }
+
+    uint64_t records_offset = archive.zip64_end_offset ? archive.zip64_end_offset : archive.end_offset;
+    if (central_offset > records_offset || central_size > records_offset - central_offset) {
+        error = "has a central directory placed past its end";
+        return false;
+    }
+
+    archive.central_offset = central_offset;
+    archive.central_end = central_offset + central_size;
+
+    //every header is at least this large, so a count larger than could fit is not believed
+    if (count > central_size / ZIP_CENTRAL_HEADER_SIZE) {
+        error = "has a central directory too small for its entries";
+        return false;
+    }
+
+    archive.entries.reserve(count);
+
+    uint64_t offset = central_offset;
+    for (uint64_t i = 0; i < count; i++) {
+        const uint8_t *header = file.at<uint8_t>(offset, ZIP_CENTRAL_HEADER_SIZE);
+        if (!header || offset + ZIP_CENTRAL_HEADER_SIZE > archive.central_end || read32(header) != ZIP_CENTRAL_HEADER_SIGNATURE) {
+            error = rmaslr::formatted_string("has an invalid central directory header for entry #%lld", static_cast<long long>(i + 1));
+            return false;
+        }
+
+        uint16_t name_size = read16(&header[28]);
+        uint16_t extra_size = read16(&header[30]);
+        uint16_t comment_size = read16(&header[32]);
+
+        uint64_t header_size = ZIP_CENTRAL_HEADER_SIZE + name_size + extra_size + comment_size;
+        if (header_size > archive.central_end - offset) {
+            error = rmaslr::formatted_string("has an invalid central directory header for entry #%lld", static_cast<long long>(i + 1));
+            return false;
+        }
+
+        auto entry = zip_entry();
+        entry.name = std::string(reinterpret_cast<const char *>(&header[ZIP_CENTRAL_HEADER_SIZE]), name_size);
+        entry.flags = read16(&header[8]);
+        entry.method = read16(&header[10]);
+        entry.crc = read32(&header[16]);
+        entry.compressed_size = read32(&header[20]);
+        entry.uncompressed_size = read32(&header[24]);
+        entry.local_offset = read32(&header[42]);
+        entry.central_offset = offset;
+
+        bool zip64_uncompressed = entry.uncompressed_size == ZIP64_MARKER;
+        bool zip64_compressed = entry.compressed_size == ZIP64_MARKER;
+        bool zip64_local = entry.local_offset == ZIP64_MARKER;
+
+        if (!read_zip64_extra(file, offset + ZIP_CENTRAL_HEADER_SIZE + name_size, extra_size, entry, zip64_uncompressed, zip64_compressed, zip64_local)) {
+            error = rmaslr::formatted_string("has an invalid zip64 extra field for entry (%s)", entry.name.c_str());
+            return false;
+        }
+
+        archive.entries.push_back(std::move(entry));
+        offset += header_size;
+    }
+
+    //every entry ends where the next one in the file begins
+    auto order = std::vector<size_t>(archive.entries.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&archive](size_t first, size_t second) {
+        return archive.entries[first].local_offset < archive.entries[second].local_offset;
+    });
+
+    for (size_t i = 0; i < order.size(); i++) {
+        auto& entry = archive.entries[order[i]];
+        entry.end_offset = i + 1 < order.size() ? archive.entries[order[i + 1]].local_offset : central_offset;
+
+        const uint8_t *local = file.at<uint8_t>(entry.local_offset, ZIP_LOCAL_HEADER_SIZE);
+        if (!local || read32(local) != ZIP_LOCAL_HEADER_SIGNATURE) {
+            error = rmaslr::formatted_string("has an invalid local header for entry (%s)", entry.name.c_str());
+            return false;
+        }
+
+        entry.data_offset = entry.local_offset + ZIP_LOCAL_HEADER_SIZE + read16(&local[26]) + read16(&local[28]);
+        if (entry.data_offset > entry.end_offset || entry.compressed_size > entry.end_offset - entry.data_offset) {
+            error = rmaslr::formatted_string("has entry (%s) placed past the start of the next", entry.name.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//the contents of entry, checked against its crc
+static bool read_entry(const rmaslr::file& file, const zip_entry& entry, std::vector<uint8_t>& contents, std::string& error) noexcept {
+    auto span = rmaslr::trace::span("read_entry", entry.name.c_str());
+
+    if (entry.flags & ZIP_FLAG_ENCRYPTED) {
+        error = rmaslr::formatted_string("has entry (%s) encrypted", entry.name.c_str());
+        return false;
+    }
+
+    const uint8_t *data = file.at<uint8_t>(entry.data_offset, entry.compressed_size);
+    if (!data) {
+        error = rmaslr::formatted_string("has entry (%s) placed past end of file", entry.name.c_str());
+        return false;
+    }
+
+    //the size is only trusted once it agrees with the data actually there, it's allocated up front
+    if (entry.method == ZIP_METHOD_STORED && entry.compressed_size != entry.uncompressed_size) {
+        error = rmaslr::formatted_string("has stored entry (%s) with mismatched sizes", entry.name.c_str());
+        return false;
+    }
+
+    if (entry.method == ZIP_METHOD_DEFLATED && entry.uncompressed_size > entry.compressed_size * DEFLATE_MAX_RATIO) {
+        error = rmaslr::formatted_string("has entry (%s) larger than its compressed data can inflate to", entry.name.c_str());
+        return false;
+    }
+
+    contents.resize(entry.uncompressed_size);
+    if (entry.method == ZIP_METHOD_STORED) {
+        memcpy(contents.data(), data, contents.size());
+    } else if (entry.method == ZIP_METHOD_DEFLATED) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            error = "could not be inflated, out of memory";
+            return false;
+        }
+
+        uint64_t consumed = 0;
+        uint64_t produced = 0;
+
+        int status = Z_OK;
+        while (status == Z_OK) {
+            //both are 32-bit in zlib
+            stream.next_in = const_cast<uint8_t *>(&data[consumed]);
+            stream.avail_in = static_cast<uInt>(std::min<uint64_t>(entry.compressed_size - consumed, UINT_MAX));
+            stream.next_out = &contents[produced];
+            stream.avail_out = static_cast<uInt>(std::min<uint64_t>(contents.size() - produced, UINT_MAX));
+
+            uInt available_in = stream.avail_in;
+            uInt available_out = stream.avail_out;
+
+            status = inflate(&stream, Z_NO_FLUSH);
+
+            consumed += available_in - stream.avail_in;
+            produced += available_out - stream.avail_out;
+
+            //nothing more could be produced, the entry is larger than its header says
+            if (status == Z_OK && available_in == stream.avail_in && available_out == stream.avail_out) {
+                status = Z_DATA_ERROR;
+            }
+        }
+
+        inflateEnd(&stream);
+        if (status != Z_STREAM_END || produced != contents.size()) {
+            error = rmaslr::formatted_string("has entry (%s) that could not be inflated", entry.name.c_str());
+            return false;
+        }
+    } else {
+        error = rmaslr::formatted_string("has entry (%s) compressed with unsupported method %d", entry.name.c_str(), entry.method);
+        return false;
+    }
+
+    uint32_t crc = static_cast<uint32_t>(crc32_z(crc32(0, nullptr, 0), contents.data(), contents.size()));
+    if (crc != entry.crc) {
+        error = rmaslr::formatted_string("has entry (%s) whose crc does not match its contents", entry.name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+static const zip_entry *find_entry(const zip_archive& archive, const std::string& name) noexcept {
+    for (const auto& entry : archive.entries) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+//Payload/<name>.app/Info.plist, of the application itself rather than one nested inside it
+static const zip_entry *find_info_plist(const zip_archive& archive) noexcept {
+    const std::string prefix = "Payload/";
+    const std::string suffix = ".app/Info.plist";
+
+    for (const auto& entry : archive.entries) {
+        const auto& name = entry.name;
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+
+        if (name.find('/', prefix.size()) == name.size() - suffix.size() + 4) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+static bool write_all(int descriptor, const uint8_t *data, size_t size) noexcept {
+    while (size) {
+        ssize_t written = write(descriptor, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+static bool pwrite_all(int descriptor, const uint8_t *data, size_t size, uint64_t offset) noexcept {
+    while (size) {
+        ssize_t written = pwrite(descriptor, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+
+    return true;
+}
+
+//writes the pages of a stored entry that differ from contents, then its crc wherever the archive keeps it
+static bool patch_stored_entry(const std::string& path, const rmaslr::file& file, const zip_entry& entry, const std::vector<uint8_t>& contents, uint32_t crc) noexcept {
+    int descriptor = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    //the original is still mapped, and is only ever written a page after it was compared
+    const uint8_t *original = file.at<uint8_t>(entry.data_offset, contents.size());
+    bool written = true;
+
+    for (uint64_t offset = 0; offset < contents.size() && written; offset += PATCH_CHUNK_SIZE) {
+        size_t size = static_cast<size_t>(std::min<uint64_t>(PATCH_CHUNK_SIZE, contents.size() - offset));
+        if (memcmp(&original[offset], &contents[offset], size) == 0) {
+            continue;
+        }
+
+        written = pwrite_all(descriptor, &contents[offset], size, entry.data_offset + offset);
+        if (written && rmaslr::stats::enabled()) {
+            rmaslr::stats::add(rmaslr::stats::counter::bytes_written, size);
+        }
+    }
+
+    uint8_t crc_bytes[4];
+    write32(crc_bytes, crc);
+
+    written = written && pwrite_all(descriptor, crc_bytes, sizeof(crc_bytes), entry.local_offset + 14) && pwrite_all(descriptor, crc_bytes, sizeof(crc_bytes), entry.central_offset + 16);
+
+    //a data descriptor follows the data, with or without its signature
+    if (written && (entry.flags & ZIP_FLAG_DESCRIPTOR)) {
+        uint64_t descriptor_offset = entry.data_offset + entry.compressed_size;
+        const uint8_t *signature = file.at<uint8_t>(descriptor_offset, 4);
+
+        if (signature && read32(signature) == ZIP_DESCRIPTOR_SIGNATURE) {
+            descriptor_offset += 4;
+        }
+
+        written = pwrite_all(descriptor, crc_bytes, sizeof(crc_bytes), descriptor_offset);
+    }
+
+    written = written && fsync(descriptor) == 0;
+
+    int error_number = errno;
+    close(descriptor);
+    errno = error_number;
+
+    return written;
+}
+
+static bool deflate_contents(const std::vector<uint8_t>& contents, std::vector<uint8_t>& compressed) noexcept {
+    auto span = rmaslr::trace::span("deflate");
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    compressed.resize(deflateBound(&stream, static_cast<uLong>(contents.size())));
+
+    stream.next_in = const_cast<uint8_t *>(contents.data());
+    stream.avail_in = static_cast<uInt>(contents.size());
+    stream.next_out = compressed.data();
+    stream.avail_out = static_cast<uInt>(compressed.size());
+
+    int status = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+
+    deflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+//adds delta to the offset of a central header or end record, in its own 32-bit field or where zip64 keeps it
+static bool shift_offset(uint8_t *field, uint8_t *zip64_field, int64_t delta) noexcept {
+    if (zip64_field) {
+        write64(zip64_field, read64(zip64_field) + static_cast<uint64_t>(delta));
+        return true;
+    }
+
+    uint64_t value = read32(field) + static_cast<uint64_t>(delta);
+    if (value >= ZIP64_MARKER) {
+        return false;
+    }
+
+    write32(field, static_cast<uint32_t>(value));
+    return true;
+}
+
+//writes a copy of the archive with entry re-emitted from contents, every other entry copied through verbatim, to a temporary file renamed over output_path
+static bool rewrite_archive(const rmaslr::file& file, const zip_archive& archive, const zip_entry& entry, const std::vector<uint8_t>& contents, uint32_t crc, const std::string& output_path, std::string& error) noexcept {
+    auto compressed = std::vector<uint8_t>();
+    if (contents.size() >= ZIP64_MARKER || !deflate_contents(contents, compressed) || compressed.size() >= ZIP64_MARKER) {
+        error = rmaslr::formatted_string("has entry (%s) that could not be deflated", entry.name.c_str());
+        return false;
+    }
+
+    //the same local header without a data descriptor or zip64 sizes, as both sizes are now known and fit
+    const uint8_t *old_local = file.at<uint8_t>(entry.local_offset, entry.data_offset - entry.local_offset);
+    uint16_t name_size = read16(&old_local[26]);
+    uint16_t extra_size = read16(&old_local[28]);
+
+    auto local = std::vector<uint8_t>(old_local, old_local + ZIP_LOCAL_HEADER_SIZE + name_size);
+    const uint8_t *extra = &old_local[ZIP_LOCAL_HEADER_SIZE + name_size];
+
+    for (uint32_t position = 0; position + 4 <= extra_size;) {
+        uint16_t size = read16(&extra[position + 2]);
+        if (position + 4 + size > extra_size) {
+            break;
+        }
+
+        if (read16(&extra[position]) != ZIP64_EXTRA_ID) {
+            local.insert(local.end(), &extra[position], &extra[position + 4 + size]);
+        }
+
+        position += 4 + size;
+    }
+
+    write16(&local[6], static_cast<uint16_t>(entry.flags & ~ZIP_FLAG_DESCRIPTOR));
+    write16(&local[8], ZIP_METHOD_DEFLATED);
+    write32(&local[14], crc);
+    write32(&local[18], static_cast<uint32_t>(compressed.size()));
+    write32(&local[22], static_cast<uint32_t>(contents.size()));
+    write16(&local[28], static_cast<uint16_t>(local.size() - ZIP_LOCAL_HEADER_SIZE - name_size));
+
+    int64_t delta = static_cast<int64_t>(local.size() + compressed.size()) - static_cast<int64_t>(entry.end_offset - entry.local_offset);
+
+    //the central directory and the records after it, with every offset past entry moved by delta
+    const uint8_t *tail = file.at<uint8_t>(archive.central_offset, file.size() - archive.central_offset);
+    auto central = std::vector<uint8_t>(tail, tail + (file.size() - archive.central_offset));
+    auto at = [&archive, &central](uint64_t offset) {
+        return offset ? &central[offset - archive.central_offset] : nullptr;
+    };
+
+    bool fits = true;
+    for (const auto& other : archive.entries) {
+        uint8_t *header = at(other.central_offset);
+        if (&other == &entry) {
+            write16(&header[8], static_cast<uint16_t>(entry.flags & ~ZIP_FLAG_DESCRIPTOR));
+            write16(&header[10], ZIP_METHOD_DEFLATED);
+            write32(&header[16], crc);
+
+            //left in the extra field when that's where they were
+            if (other.compressed_size_extra) {
+                write64(at(other.compressed_size_extra), compressed.size());
+            } else {
+                write32(&header[20], static_cast<uint32_t>(compressed.size()));
+            }
+
+            if (other.uncompressed_size_extra) {
+                write64(at(other.uncompressed_size_extra), contents.size());
+            } else {
+                write32(&header[24], static_cast<uint32_t>(contents.size()));
+            }
+        } else if (other.local_offset > entry.local_offset) {
+            fits = fits && shift_offset(&header[42], at(other.local_offset_extra), delta);
+        }
+    }
+
+    if (archive.zip64_end_offset) {
+        uint8_t *zip64_end = at(archive.zip64_end_offset);
+        uint8_t *locator = at(archive.locator_offset);
+
+        write64(&zip64_end[48], read64(&zip64_end[48]) + static_cast<uint64_t>(delta));
+        write64(&locator[8], read64(&locator[8]) + static_cast<uint64_t>(delta));
+    }
+
+    uint8_t *end = at(archive.end_offset);
+    if (read32(&end[16]) != ZIP64_MARKER) {
+        fits = fits && shift_offset(&end[16], nullptr, delta);
+    }
+
+    if (!fits) {
+        error = "would need zip64 offsets once patched";
+        return false;
+    }
+
+    auto temporary_path = output_path + ".rmaslr-XXXXXX";
+    int output = mkstemp(&temporary_path[0]);
+
+    if (output < 0) {
+        error = rmaslr::formatted_string("could not be copied to a temporary file, errno=%d(%s)", errno, strerror(errno));
+        return false;
+    }
+
+    auto span = rmaslr::trace::span("rewrite_archive", output_path.c_str());
+    int input = file.descriptor();
+
+    bool written = fchmod(output, file.stat().st_mode & 07777) == 0 &&
+                   rmaslr::copy_range(input, 0, output, entry.local_offset) &&
+                   write_all(output, local.data(), local.size()) &&
+                   write_all(output, compressed.data(), compressed.size()) &&
+                   rmaslr::copy_range(input, entry.end_offset, output, archive.central_offset - entry.end_offset) &&
+                   write_all(output, central.data(), central.size()) &&
+                   fsync(output) == 0;
+
+    int error_number = errno;
+    if (close(output) != 0 && written) {
+        written = false;
+        error_number = errno;
+    }
+
+    if (written && rename(temporary_path.c_str(), output_path.c_str()) != 0) {
+        written = false;
+        error_number = errno;
+    }
+
+    if (!written) {
+        unlink(temporary_path.c_str());
+
+        error = rmaslr::formatted_string("could not be written, errno=%d(%s)", error_number, strerror(error_number));
+        return false;
+    }
+
+    if (rmaslr::stats::enabled()) {
+        rmaslr::stats::add(rmaslr::stats::counter::bytes_written, file.size() + static_cast<uint64_t>(delta));
+    }
+
+    return true;
+}
+
+bool rmaslr::is_ipa(const std::string& path) noexcept {
+    int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    uint8_t signature[4];
+    bool is_zip = pread(descriptor, signature, sizeof(signature), 0) == sizeof(signature) && read32(signature) == ZIP_LOCAL_HEADER_SIGNATURE;
+
+    close(descriptor);
+    return is_zip;
+}
+
+rmaslr::file_result rmaslr::process_ipa(const std::string& path, const batch_options& options, const std::string& output_path) noexcept {
+    auto span = trace::span("process_ipa", path.c_str());
+
+    auto result = file_result();
+    result.path = path;
+
+    auto fail = [&result](std::string error) {
+        result.status = file_status::failed;
+        result.error = std::move(error);
+
+        return result;
+    };
+
+    auto file = rmaslr::file(path.c_str());
+    if (!file.is_open()) {
+        return fail(formatted_string("could not be opened, errno=%d(%s)", file.error_number(), strerror(file.error_number())));
+    }
+
+    auto archive = zip_archive();
+    auto error = std::string();
+
+    if (!parse_archive(file, archive, error)) {
+        return fail(error);
+    }
+
+    const zip_entry *info_plist = find_info_plist(archive);
+    if (!info_plist) {
+        return fail("does not contain an application in Payload/");
+    }
+
+    auto contents = std::vector<uint8_t>();
+    if (!read_entry(file, *info_plist, contents, error)) {
+        return fail(error);
+    }
+
+    static const auto keys = std::vector<const char *>({ "CFBundleExecutable" });
+    auto strings = std::map<std::string, std::string>();
+
+    if (!read_plist_strings(contents.data(), contents.size(), keys, strings) || strings["CFBundleExecutable"].empty()) {
+        return fail(formatted_string("has an Info.plist (%s) without a CFBundleExecutable", info_plist->name.c_str()));
+    }
+
+    auto bundle = info_plist->name.substr(0, info_plist->name.size() - strlen("Info.plist"));
+    const zip_entry *executable = find_entry(archive, bundle + strings["CFBundleExecutable"]);
+
+    if (!executable) {
+        return fail(formatted_string("does not contain the application's executable (%s%s)", bundle.c_str(), strings["CFBundleExecutable"].c_str()));
+    }
+
+    result.path = path + ":" + executable->name;
+    if (!read_entry(file, *executable, contents, error)) {
+        return fail(error);
+    }
+
+    //offsets inside a compressed entry can't be restored by the journal
+    auto unjournaled = options;
+    unjournaled.journal = nullptr;
+
+    process_buffer(contents.data(), contents.size(), contents.data(), unjournaled, result);
+
+    bool removed = std::any_of(result.slices.begin(), result.slices.end(), [](const slice_result& slice) {
+        return slice.action == slice_action::removed;
+    });
+
+    const std::string& target = output_path.empty() ? path : output_path;
+    if (!removed) {
+        if (!output_path.empty() && result.status == file_status::ok && !clone_file(path, output_path)) {
+            return fail(formatted_string("could not be copied to path (%s), errno=%d(%s)", output_path.c_str(), errno, strerror(errno)));
+        }
+
+        return result;
+    }
+
+    uint32_t crc = static_cast<uint32_t>(crc32_z(crc32(0, nullptr, 0), contents.data(), contents.size()));
+    if (executable->method == ZIP_METHOD_STORED) {
+        if (!output_path.empty() && !clone_file(path, output_path)) {
+            return fail(formatted_string("could not be copied to path (%s), errno=%d(%s)", output_path.c_str(), errno, strerror(errno)));
+        }
+
+        if (!patch_stored_entry(target, file, *executable, contents, crc)) {
+            return fail(formatted_string("could not be written to, errno=%d(%s)", errno, strerror(errno)));
+        }
+
+        return result;
+    }
+
+    if (!rewrite_archive(file, archive, *executable, contents, crc, target, error)) {
+        return fail(error);
+    }
+
+    return result;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "batch.h"
+
+namespace rmaslr {
+    //whether the file at path is a zip archive, as an .ipa is
+    bool is_ipa(const std::string& path) noexcept;
+
+    //runs the main executable of the .ipa at path through plan_removals without extracting the archive. the executable is found through
+    //Payload/<name>.app/Info.plist, and only that entry and the Info.plist are inflated. a stored entry is patched in place (only the pages
+    //that changed are written) and its crc fixed. a deflated one is compressed again into a copy of the archive that replaces it, with every
+    //other entry copied through verbatim by copy_range. with output_path, the patched archive is written there and path is left untouched.
+    //the result's path is path:<entry name>. options' journal is not used, flags inside a compressed entry can't be restored in place
+    file_result process_ipa(const std::string& path, const batch_options& options, const std::string& output_path = std::string()) noexcept;
+}
@@ -0,0 +1,445 @@
+#include <sys/file.h>
+
+#include <climits>
+#include <mutex>
+#include <set>
+
+#include "codesign.h"
+#include "journal.h"
+
+#define JOURNAL_MAGIC 0x4c4e4a52 //"RJNL"
+#define JOURNAL_VERSION 1
+
+struct journal_header {
+    uint32_t magic;
+    uint32_t version;
+};
+
+//followed by path_length bytes of path
+struct journal_record {
+    uint32_t checksum; //of everything after it, including the path
+    uint32_t path_length;
+
+    uint64_t device;
+    uint64_t inode;
+
+    uint64_t offset;
+    uint32_t old_flags;
+    uint32_t new_flags;
+};
+
+static_assert(sizeof(struct journal_record) == 40, "journal_record is written as-is");
+
+//fnv-1a, enough to recognise a record cut short by a crash
+static uint32_t checksum(const void *data, size_t size, uint32_t hash = 2166136261u) noexcept {
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static uint32_t record_checksum(const struct journal_record& record, const char *path) noexcept {
+    auto fields = reinterpret_cast<const uint8_t *>(&record) + sizeof(record.checksum);
+    return checksum(path, record.path_length, checksum(fields, sizeof(record) - sizeof(record.checksum)));
+}
+
+//makes everything written to descriptor durable, on apple fsync alone leaves it in the drive's cache
+static bool sync_descriptor(int descriptor) noexcept {
+#ifdef __APPLE__
+    if (fcntl(descriptor, F_FULLFSYNC) == 0) {
+        return true;
+    }
+
+    return fsync(descriptor) == 0;
+#else
+    return fdatasync(descriptor) == 0;
+#endif
+}
+
+static bool write_all(int descriptor, const char *data, size_t size) noexcept {
+    while (size) {
+        ssize_t written = write(descriptor, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+//every entry in file up to its first torn or corrupt record, returns the offset that record starts at (the end of the last valid one),
+//0 if file doesn't start with a journal header
+static uint64_t scan_journal(const rmaslr::file& file, std::vector<rmaslr::journal_entry> *entries) noexcept {
+    auto header = file.at<struct journal_header>(0);
+    if (!header || header->magic != JOURNAL_MAGIC || header->version != JOURNAL_VERSION) {
+        return 0;
+    }
+
+    uint64_t offset = sizeof(struct journal_header);
+    for (;;) {
+        auto record = file.at<struct journal_record>(offset);
+        if (!record) {
+            break;
+        }
+
+        const char *record_path = file.at<char>(offset + sizeof(*record), record->path_length);
+        if (!record_path || record->checksum != record_checksum(*record, record_path)) {
+            break;
+        }
+
+        if (entries) {
+            entries->push_back(rmaslr::journal_entry({ std::string(record_path, record->path_length), record->device, record->inode, record->offset, record->old_flags, record->new_flags }));
+        }
+
+        offset += sizeof(*record) + record->path_length;
+    }
+
+    return offset;
+}
+
+rmaslr::journal::~journal() noexcept {
+    if (descriptor_ >= 0) {
+        close(descriptor_);
+    }
+}
+
+bool rmaslr::journal::open(const std::string& path) noexcept {
+    descriptor_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (descriptor_ < 0) {
+        return false;
+    }
+
+    auto fail = [this]() {
+        int error_number = errno;
+
+        close(descriptor_);
+        descriptor_ = -1;
+
+        errno = error_number;
+        return false;
+    };
+
+    //held by every writer, so the tail isn't cut while another process appends to it
+    struct stat sbuf;
+    if (flock(descriptor_, LOCK_EX) != 0 || fstat(descriptor_, &sbuf) != 0) {
+        return fail();
+    }
+
+    //a tail torn by a crash is cut off, otherwise every record appended after it would be unreadable.
+    //a journal whose header was torn is started again
+    if (static_cast<uint64_t>(sbuf.st_size) < sizeof(struct journal_header)) {
+        if (sbuf.st_size && ftruncate(descriptor_, 0) != 0) {
+            return fail();
+        }
+
+        sbuf.st_size = 0;
+    } else {
+        auto file = rmaslr::file(path.c_str());
+        if (!file.is_open()) {
+            errno = file.error_number();
+            return fail();
+        }
+
+        uint64_t end = scan_journal(file, nullptr);
+        if (!end) {
+            errno = EINVAL;
+            return fail();
+        }
+
+        if (end != file.size() && (ftruncate(descriptor_, static_cast<off_t>(end)) != 0 || !sync_descriptor(descriptor_))) {
+            return fail();
+        }
+    }
+
+    flock(descriptor_, LOCK_UN);
+
+    char directory[PATH_MAX];
+    if (getcwd(directory, sizeof(directory))) {
+        directory_ = directory;
+        directory_.append(1, '/');
+    }
+
+    //made durable together with the first entries
+    if (!sbuf.st_size) {
+        auto header = journal_header({ JOURNAL_MAGIC, JOURNAL_VERSION });
+        buffer_.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    return true;
+}
+
+void rmaslr::journal::append(const std::string& path, const struct stat& sbuf, uint64_t offset, uint32_t old_flags, uint32_t new_flags) noexcept {
+    //restoring may well happen from another directory
+    const std::string& full_path = path[0] == '/' ? path : directory_ + path;
+    auto record = journal_record();
+
+    record.path_length = static_cast<uint32_t>(full_path.length());
+    record.device = static_cast<uint64_t>(sbuf.st_dev);
+    record.inode = static_cast<uint64_t>(sbuf.st_ino);
+    record.offset = offset;
+    record.old_flags = old_flags;
+    record.new_flags = new_flags;
+    record.checksum = record_checksum(record, full_path.data());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    buffer_.append(reinterpret_cast<const char *>(&record), sizeof(record));
+    buffer_.append(full_path);
+}
+
+bool rmaslr::journal::commit() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffer_.empty()) {
+        return true;
+    }
+
+    auto span = trace::span("journal_commit");
+    auto timer = stats::timer(stats::stage::journal);
+    if (stats::enabled()) {
+        stats::add(stats::counter::syscalls, 5); //lock, fstat, write, sync and unlock
+        stats::add(stats::counter::bytes_written, buffer_.size());
+    }
+
+    struct stat sbuf;
+    if (flock(descriptor_, LOCK_EX) != 0) {
+        return false;
+    }
+
+    if (fstat(descriptor_, &sbuf) != 0) {
+        int error_number = errno;
+
+        flock(descriptor_, LOCK_UN);
+        errno = error_number;
+
+        return false;
+    }
+
+    //a partial write is cut off again, so the next commit (of the same buffer) starts where this one did
+    if (!write_all(descriptor_, buffer_.data(), buffer_.size()) || !sync_descriptor(descriptor_)) {
+        int error_number = errno;
+        if (ftruncate(descriptor_, sbuf.st_size) == 0) {
+            sync_descriptor(descriptor_);
+        }
+
+        flock(descriptor_, LOCK_UN);
+        errno = error_number;
+
+        return false;
+    }
+
+    flock(descriptor_, LOCK_UN);
+
+    buffer_.clear();
+    return true;
+}
+
+std::string rmaslr::default_journal_path() noexcept {
+    const char *home = getenv("HOME");
+    if (!home) {
+        return std::string();
+    }
+
+    std::string caches = std::string(home) + "/Library/Caches";
+    if (access(caches.c_str(), W_OK) != 0) {
+        return std::string();
+    }
+
+    return caches + "/com.inoahdev.rmaslr.journal";
+}
+
+bool rmaslr::read_journal(const std::string& path, std::vector<journal_entry>& entries, bool *complete) noexcept {
+    auto file = rmaslr::file(path.c_str());
+    if (!file.is_open()) {
+        errno = file.error_number();
+        return false;
+    }
+
+    uint64_t end = scan_journal(file, &entries);
+    if (!end) {
+        errno = EINVAL;
+        return false;
+    }
+
+    if (complete) {
+        *complete = end == file.size();
+    }
+
+    return true;
+}
+
+struct restore_group {
+    const std::string *path;
+
+    uint64_t device;
+    uint64_t inode;
+
+    std::vector<const rmaslr::journal_entry *> entries; //newest first
+};
+
+struct restore_counts {
+    std::mutex mutex;
+
+    size_t restored = 0; //slices
+    size_t files = 0;    //with at least one restored slice
+    size_t skipped = 0;  //slices no longer holding the flags that were written, or files replaced since
+    size_t failed = 0;
+};
+
+static void restore_file(const restore_group& group, restore_counts& counts) noexcept {
+    const char *path = group.path->c_str();
+
+    auto file = rmaslr::file(path, true);
+    auto fail = [&](int error_number) {
+        std::lock_guard<std::mutex> lock(counts.mutex);
+
+        fprintf(stderr, "\x1B[31mError:\x1B[0m File (%s) could not be restored, errno=%d(%s)\n", path, error_number, strerror(error_number));
+        counts.failed += group.entries.size();
+    };
+
+    if (!file.is_open()) {
+        if (file.error_number() == ENOENT) {
+            std::lock_guard<std::mutex> lock(counts.mutex);
+            counts.skipped += group.entries.size();
+        } else {
+            fail(file.error_number());
+        }
+
+        return;
+    }
+
+    struct stat sbuf = file.stat();
+    if (static_cast<uint64_t>(sbuf.st_dev) != group.device || static_cast<uint64_t>(sbuf.st_ino) != group.inode) {
+        std::lock_guard<std::mutex> lock(counts.mutex);
+        counts.skipped += group.entries.size();
+
+        return;
+    }
+
+    auto restored_offsets = std::set<uint64_t>();
+    size_t skipped = 0;
+
+    for (const auto *entry : group.entries) {
+        off_t position = static_cast<off_t>(entry->offset + offsetof(struct mach_header, flags));
+
+        uint32_t flags = 0;
+
+        ssize_t read_size = pread(file.descriptor(), &flags, sizeof(flags), position);
+        if (read_size != sizeof(flags)) {
+            fail(read_size < 0 ? errno : EIO);
+            return;
+        }
+
+        if (flags != entry->new_flags) {
+            skipped++;
+            continue;
+        }
+
+        if (pwrite(file.descriptor(), &entry->old_flags, sizeof(entry->old_flags), position) != sizeof(entry->old_flags)) {
+            fail(errno);
+            return;
+        }
+
+        restored_offsets.insert(entry->offset);
+    }
+
+    //page 0 changed back, so the page hashes written when patching are stale again
+    if (!restored_offsets.empty()) {
+        auto slices = std::vector<rmaslr::slice>();
+        if (rmaslr::parse_slices(file, slices) == rmaslr::parse_status::ok) {
+            for (auto& slice : slices) {
+                if (!restored_offsets.count(slice.offset)) {
+                    continue;
+                }
+
+                rmaslr::inspect_load_commands(file, slice);
+                rmaslr::update_signature(file.descriptor(), slice);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(counts.mutex);
+    if (!restored_offsets.empty()) {
+        fprintf(stdout, "Restored file (%s)\n", path);
+        counts.files++;
+    }
+
+    counts.restored += restored_offsets.size();
+    counts.skipped += skipped;
+}
+
+bool rmaslr::restore_journal(const std::string& path, unsigned int jobs) noexcept {
+    //locked until it's emptied, so nothing appended meanwhile is truncated away without being restored
+    int descriptor = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (descriptor < 0 || flock(descriptor, LOCK_EX) != 0) {
+        fprintf(stderr, "\x1B[31mError:\x1B[0m Unable to open journal at path (%s), errno=%d(%s)\n", path.c_str(), errno, strerror(errno));
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+
+        return false;
+    }
+
+    auto entries = std::vector<journal_entry>();
+    bool complete = false;
+
+    if (!read_journal(path, entries, &complete)) {
+        fprintf(stderr, "\x1B[31mError:\x1B[0m Unable to read journal at path (%s), errno=%d(%s)\n", path.c_str(), errno, strerror(errno));
+        close(descriptor);
+
+        return false;
+    }
+
+    //one group per file, in the order of their newest entry
+    auto groups = std::vector<restore_group>();
+    auto group_indexes = std::map<std::pair<uint64_t, uint64_t>, size_t>();
+
+    for (size_t i = entries.size(); i-- > 0;) {
+        const auto& entry = entries[i];
+
+        auto key = std::make_pair(entry.device, entry.inode);
+        auto it = group_indexes.find(key);
+
+        if (it == group_indexes.end()) {
+            it = group_indexes.emplace(key, groups.size()).first;
+            groups.push_back(restore_group({ &entry.path, entry.device, entry.inode, {} }));
+        }
+
+        groups[it->second].entries.push_back(&entry);
+    }
+
+    restore_counts counts;
+    parallel_for(groups.size(), jobs, [&](size_t index) {
+        restore_file(groups[index], counts);
+    });
+
+    fprintf(stdout, "Restored %ld architectures in %ld files (%ld changed since they were patched, %ld failed)\n", counts.restored, counts.files, counts.skipped, counts.failed);
+    if (counts.failed) {
+        close(descriptor);
+        return false;
+    }
+
+    //whatever follows a corrupt record can't be read, it's kept rather than thrown away unrestored
+    if (!complete) {
+        notice("Journal at path (%s) has a torn or corrupt record after the %ld that were read, it was not emptied", path.c_str(), entries.size());
+        close(descriptor);
+
+        return true;
+    }
+
+    //only the header is kept, so restoring again does nothing
+    if (ftruncate(descriptor, sizeof(struct journal_header)) != 0 || !sync_descriptor(descriptor)) {
+        fprintf(stderr, "\x1B[31mError:\x1B[0m Unable to empty journal at path (%s), errno=%d(%s)\n", path.c_str(), errno, strerror(errno));
+    }
+
+    close(descriptor);
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <mutex>
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    struct journal_entry {
+        std::string path;
+
+        uint64_t device;
+        uint64_t inode;
+
+        uint64_t offset;    //of the slice's mach_header
+        uint32_t old_flags; //both in the file's byte-order, as found and as written
+        uint32_t new_flags;
+    };
+
+    //append-only record of every flags write, so a crash or a bad batch can be rolled back with restore_journal.
+    //entries are buffered by append and made durable together by commit, which must return before the writes they describe happen
+    class journal {
+    public:
+        journal() noexcept = default;
+
+        journal(const journal&) = delete;
+        journal& operator=(const journal&) = delete;
+
+        ~journal() noexcept;
+
+        //opens path for appending, creating it if needed, and cuts off a tail torn by a crash. false with errno set on failure,
+        //or EINVAL if path is not a journal
+        bool open(const std::string& path) noexcept;
+
+        inline bool is_open() const noexcept {
+            return descriptor_ >= 0;
+        }
+
+        //safe to call from any thread
+        void append(const std::string& path, const struct stat& sbuf, uint64_t offset, uint32_t old_flags, uint32_t new_flags) noexcept;
+
+        //writes every entry appended so far with one write and one sync, false with errno set if either failed
+        bool commit() noexcept;
+    private:
+        int descriptor_ = -1;
+        std::string directory_; //relative paths are recorded relative to the working directory at open
+
+        std::mutex mutex_;
+        std::string buffer_;
+    };
+
+    //~/Library/Caches/com.inoahdev.rmaslr.journal, empty when that directory is not writable
+    std::string default_journal_path() noexcept;
+
+    //every entry in the journal at path in the order they were written, stopping at a torn or corrupt tail.
+    //complete is set to whether every byte of the journal was read as a valid record
+    bool read_journal(const std::string& path, std::vector<journal_entry>& entries, bool *complete = nullptr) noexcept;
+
+    //puts back the old flags of every entry in the journal at path, newest first, files being restored on at most jobs threads.
+    //a slice is only written to when it still holds the flags rmaslr wrote, and its ad-hoc signature is updated again afterwards.
+    //the journal is locked while restoring, and emptied once everything in it was read and restored. returns false if anything failed
+    bool restore_journal(const std::string& path, unsigned int jobs) noexcept;
+}
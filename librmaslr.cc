@@ -0,0 +1,222 @@
+#include <cstddef>
+#include <memory>
+
+#include "batch.h"
+#include "librmaslr.h"
+
+struct rmaslr_context {
+    //only read once the context is shared, every call works on its own copy
+    rmaslr::batch_options options;
+    std::unique_ptr<rmaslr::journal> journal;
+};
+
+static char *copy_error(const std::string& error) noexcept {
+    return strdup(error.c_str());
+}
+
+static rmaslr_result invalid_argument(const char *error) noexcept {
+    auto result = rmaslr_result();
+    result.status = RMASLR_INVALID_ARGUMENT;
+    result.error = strdup(error);
+
+    return result;
+}
+
+static rmaslr_result convert_result(const rmaslr::file_result& file_result) noexcept {
+    auto result = rmaslr_result();
+    switch (file_result.status) {
+        case rmaslr::file_status::ok:
+            result.status = RMASLR_OK;
+            break;
+        case rmaslr::file_status::skipped:
+            result.status = RMASLR_NOT_MACHO;
+            return result;
+        case rmaslr::file_status::failed:
+            result.status = RMASLR_FAILED;
+            result.error = copy_error(file_result.error);
+
+            break;
+    }
+
+    if (file_result.slices.empty()) {
+        return result;
+    }
+
+    result.slices = static_cast<rmaslr_slice *>(calloc(file_result.slices.size(), sizeof(rmaslr_slice)));
+    if (!result.slices) {
+        free(result.error);
+
+        result.status = RMASLR_FAILED;
+        result.error = copy_error("out of memory");
+
+        return result;
+    }
+
+    result.slice_count = file_result.slices.size();
+    for (size_t i = 0; i < file_result.slices.size(); i++) {
+        const auto& slice = file_result.slices[i];
+        auto& converted = result.slices[i];
+
+        const rmaslr::architecture *architecture = rmaslr::find_architecture(slice.cputype, slice.cpusubtype);
+
+        converted.offset = slice.offset;
+        converted.cputype = slice.cputype;
+        converted.cpusubtype = slice.cpusubtype;
+        converted.architecture = architecture ? architecture->name : "unknown";
+        converted.flags = slice.flags;
+        converted.filetype = slice.filetype;
+        converted.pie = (slice.flags & MH_PIE) != 0;
+        converted.encrypted = slice.encrypted;
+        converted.code_signed = slice.code_signature;
+
+        //both enums are declared in the same order as rmaslr's own
+        converted.action = static_cast<rmaslr_action>(slice.action);
+        converted.signature = static_cast<rmaslr_signature>(slice.signature);
+    }
+
+    return result;
+}
+
+static rmaslr_result process_path(const rmaslr::batch_options& options, const char *path) noexcept {
+    if (!path) {
+        return invalid_argument("path is NULL");
+    }
+
+    return convert_result(rmaslr::process_file(path, options));
+}
+
+//the same as process_file, on a view of data. removals are written straight into it
+static rmaslr_result process_buffer(const rmaslr::batch_options& options, const void *data, size_t size, uint8_t *writable_data) noexcept {
+    if (!data && size) {
+        return invalid_argument("data is NULL");
+    }
+
+    auto file_result = rmaslr::file_result();
+    rmaslr::process_buffer(static_cast<const uint8_t *>(data), size, writable_data, options, file_result);
+
+    return convert_result(file_result);
+}
+
+rmaslr_context *rmaslr_context_create(void) {
+    return new (std::nothrow) rmaslr_context();
+}
+
+void rmaslr_context_destroy(rmaslr_context *context) {
+    delete context;
+}
+
+rmaslr_status rmaslr_context_set_architectures(rmaslr_context *context, const char *const *names, size_t count) {
+    if (!context || (!names && count)) {
+        return RMASLR_INVALID_ARGUMENT;
+    }
+
+    auto architectures = rmaslr::architecture_set();
+    for (size_t i = 0; i < count; i++) {
+        const rmaslr::architecture *architecture = names[i] ? rmaslr::find_architecture(names[i]) : nullptr;
+        if (!architecture) {
+            return RMASLR_INVALID_ARGUMENT;
+        }
+
+        architectures.insert(architecture);
+    }
+
+    context->options.architectures = architectures;
+    return RMASLR_OK;
+}
+
+void rmaslr_context_set_allow_arm64(rmaslr_context *context, int allow) {
+    if (context) {
+        context->options.allow_arm64 = allow != 0;
+    }
+}
+
+rmaslr_status rmaslr_context_set_journal(rmaslr_context *context, const char *path) {
+    if (!context) {
+        return RMASLR_INVALID_ARGUMENT;
+    }
+
+    context->options.journal = nullptr;
+    context->journal.reset();
+
+    if (!path) {
+        return RMASLR_OK;
+    }
+
+    auto journal = std::unique_ptr<rmaslr::journal>(new (std::nothrow) rmaslr::journal());
+    if (!journal || !journal->open(path)) {
+        return RMASLR_FAILED;
+    }
+
+    context->journal = std::move(journal);
+    context->options.journal = context->journal.get();
+
+    return RMASLR_OK;
+}
+
+rmaslr_result rmaslr_check_path(const rmaslr_context *context, const char *path) {
+    if (!context) {
+        return invalid_argument("context is NULL");
+    }
+
+    return process_path(context->options, path);
+}
+
+rmaslr_result rmaslr_check_buffer(const rmaslr_context *context, const void *data, size_t size) {
+    if (!context) {
+        return invalid_argument("context is NULL");
+    }
+
+    return process_buffer(context->options, data, size, nullptr);
+}
+
+rmaslr_result rmaslr_list_architectures_path(const rmaslr_context *context, const char *path) {
+    if (!context) {
+        return invalid_argument("context is NULL");
+    }
+
+    return process_path(rmaslr::batch_options(), path);
+}
+
+rmaslr_result rmaslr_list_architectures_buffer(const rmaslr_context *context, const void *data, size_t size) {
+    if (!context) {
+        return invalid_argument("context is NULL");
+    }
+
+    return process_buffer(rmaslr::batch_options(), data, size, nullptr);
+}
+
+rmaslr_result rmaslr_remove_aslr_path(const rmaslr_context *context, const char *path) {
+    if (!context) {
+        return invalid_argument("context is NULL");
+    }
+
+    auto options = context->options;
+    options.remove_aslr = true;
+
+    return process_path(options, path);
+}
+
+rmaslr_result rmaslr_remove_aslr_buffer(const rmaslr_context *context, void *data, size_t size) {
+    if (!context) {
+        return invalid_argument("context is NULL");
+    }
+
+    auto options = context->options;
+    options.remove_aslr = true;
+    options.journal = nullptr;
+
+    return process_buffer(options, data, size, static_cast<uint8_t *>(data));
+}
+
+void rmaslr_result_free(rmaslr_result *result) {
+    if (!result) {
+        return;
+    }
+
+    free(result->error);
+    free(result->slices);
+
+    result->error = nullptr;
+    result->slices = nullptr;
+    result->slice_count = 0;
+}
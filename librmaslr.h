@@ -0,0 +1,102 @@
+//
+//  librmaslr.h
+//  rmaslr
+//
+//  C interface to rmaslr's parser and patcher, for tools that want to check or remove ASLR without running the rmaslr binary.
+//  A context holds the options every call uses; once configured it may be shared by any number of threads calling it concurrently
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rmaslr_context rmaslr_context;
+
+typedef enum {
+    RMASLR_OK,
+    RMASLR_NOT_MACHO,        //the file or buffer is not a mach-o, nothing was looked at
+    RMASLR_FAILED,           //error describes why
+    RMASLR_INVALID_ARGUMENT
+} rmaslr_status;
+
+typedef enum {
+    RMASLR_ACTION_NONE,        //only checked
+    RMASLR_ACTION_REMOVED,
+    RMASLR_ACTION_NOT_PRESENT, //did not contain ASLR
+    RMASLR_ACTION_DECLINED,    //64-bit arm slice, see rmaslr_context_set_allow_arm64
+    RMASLR_ACTION_ENCRYPTED    //FairPlay-encrypted, left alone as it cannot run once modified
+} rmaslr_action;
+
+typedef enum {
+    RMASLR_SIGNATURE_NONE,        //no code signature, or the slice was not patched
+    RMASLR_SIGNATURE_UPDATED,     //ad-hoc signature whose page 0 hashes were updated
+    RMASLR_SIGNATURE_NOT_ADHOC,   //signed with an identity, only re-signing can make it valid again
+    RMASLR_SIGNATURE_UNSUPPORTED,
+    RMASLR_SIGNATURE_MALFORMED,
+    RMASLR_SIGNATURE_FAILED
+} rmaslr_signature;
+
+typedef struct {
+    uint64_t offset; //of the slice's mach_header
+
+    int32_t cputype;
+    int32_t cpusubtype;
+    const char *architecture; //static, "unknown" when not recognized
+
+    uint32_t flags; //as found, before any change
+    uint32_t filetype;
+
+    int pie;
+    int encrypted;
+    int code_signed;
+
+    rmaslr_action action;
+    rmaslr_signature signature;
+} rmaslr_slice;
+
+typedef struct {
+    rmaslr_status status;
+    char *error; //NULL unless status is RMASLR_FAILED or RMASLR_INVALID_ARGUMENT
+
+    size_t slice_count;
+    rmaslr_slice *slices;
+} rmaslr_result;
+
+//NULL only when out of memory
+rmaslr_context *rmaslr_context_create(void);
+void rmaslr_context_destroy(rmaslr_context *context);
+
+//the setters below are not thread-safe, call them before sharing context.
+//only slices of the count architectures named (as in -archs) are looked at, 0 looks at every slice
+rmaslr_status rmaslr_context_set_architectures(rmaslr_context *context, const char *const *names, size_t count);
+
+//whether ASLR is removed from 64-bit arm slices, off by default
+void rmaslr_context_set_allow_arm64(rmaslr_context *context, int allow);
+
+//records every flags write to files on disk in the journal at path, restorable with rmaslr --restore. NULL stops journaling
+rmaslr_status rmaslr_context_set_journal(rmaslr_context *context, const char *path);
+
+//every slice matching the context's architectures, with its flags and load command state
+rmaslr_result rmaslr_check_path(const rmaslr_context *context, const char *path);
+rmaslr_result rmaslr_check_buffer(const rmaslr_context *context, const void *data, size_t size);
+
+//every slice, ignoring the context's architectures
+rmaslr_result rmaslr_list_architectures_path(const rmaslr_context *context, const char *path);
+rmaslr_result rmaslr_list_architectures_buffer(const rmaslr_context *context, const void *data, size_t size);
+
+//clears MH_PIE of every matching slice and updates ad-hoc signatures to match.
+//the buffer variant patches data in place and is never journaled
+rmaslr_result rmaslr_remove_aslr_path(const rmaslr_context *context, const char *path);
+rmaslr_result rmaslr_remove_aslr_buffer(const rmaslr_context *context, void *data, size_t size);
+
+//frees what result points to, result itself may be on the stack
+void rmaslr_result_free(rmaslr_result *result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,147 @@
+#if defined(__linux__)
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#include <set>
+#include <tuple>
+
+#include "locality.h"
+
+struct placement {
+    size_t index;
+    bool found;    //stat'd, otherwise ordered last
+    bool resident; //the first page is in the page cache
+
+    dev_t device;
+    ino_t inode;
+    uint64_t physical_offset; //of the first extent, 0 when unknown
+};
+
+//the device offset of the file's first byte, 0 if the filesystem doesn't say
+static uint64_t physical_offset(int fd) noexcept {
+#if defined(__linux__)
+    //room for a single extent
+    alignas(struct fiemap) uint8_t buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+    memset(buffer, 0, sizeof(buffer));
+
+    auto map = reinterpret_cast<struct fiemap *>(buffer);
+
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+
+    rmaslr::stats::add_syscalls(1);
+    if (ioctl(fd, FS_IOC_FIEMAP, map) != 0 || !map->fm_mapped_extents) {
+        return 0;
+    }
+
+    return map->fm_extents[0].fe_physical;
+#elif defined(F_LOG2PHYS_EXT)
+    struct log2phys physical;
+
+    physical.l2p_flags = 0;
+    physical.l2p_contigbytes = 1;
+    physical.l2p_devoffset = 0;
+
+    rmaslr::stats::add_syscalls(1);
+    if (fcntl(fd, F_LOG2PHYS_EXT, &physical) != 0) {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(physical.l2p_devoffset);
+#else
+    (void)fd;
+    return 0;
+#endif
+}
+
+//whether the page holding the file's headers is cached, mapping it doesn't fault it in
+static bool first_page_resident(int fd) noexcept {
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    void *map = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+    rmaslr::stats::add_syscalls(1);
+
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+#if defined(__APPLE__)
+    char vector = 0;
+#else
+    unsigned char vector = 0;
+#endif
+
+    bool resident = mincore(map, page_size, &vector) == 0 && (vector & 1);
+    munmap(map, page_size);
+
+    rmaslr::stats::add_syscalls(2);
+    return resident;
+}
+
+static void probe(const std::string& path, placement& placement) noexcept {
+    int fd = open(path.c_str(), O_RDONLY);
+    rmaslr::stats::add_syscalls(1);
+
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat sbuf;
+    if (fstat(fd, &sbuf) == 0 && S_ISREG(sbuf.st_mode)) {
+        placement.found = true;
+        placement.device = sbuf.st_dev;
+        placement.inode = sbuf.st_ino;
+
+        //where a cached file is doesn't matter, its headers are read without touching the disk
+        if (sbuf.st_size > 0) {
+            placement.resident = first_page_resident(fd);
+            if (!placement.resident) {
+                placement.physical_offset = physical_offset(fd);
+            }
+        }
+    }
+
+    close(fd);
+    rmaslr::stats::add_syscalls(2);
+}
+
+std::vector<std::string> rmaslr::order_by_locality(const std::vector<std::string>& paths, unsigned int jobs) noexcept {
+    auto span = trace::span("order_by_locality");
+    auto placements = std::vector<placement>(paths.size());
+
+    parallel_for(paths.size(), jobs, [&](size_t index) {
+        placements[index] = { index, false, false, 0, 0, 0 };
+        probe(paths[index], placements[index]);
+    });
+
+    //the first path to every file
+    auto inodes = std::set<std::pair<dev_t, ino_t>>();
+    auto ordered = std::vector<placement>();
+
+    ordered.reserve(placements.size());
+    for (const auto& placement : placements) {
+        if (placement.found && !inodes.emplace(placement.device, placement.inode).second) {
+            continue;
+        }
+
+        ordered.push_back(placement);
+    }
+
+    //without a physical offset, the inode number is the closest stand-in for where a file is
+    std::stable_sort(ordered.begin(), ordered.end(), [](const placement& first, const placement& second) {
+        return std::make_tuple(!first.found, !first.resident, first.device, first.physical_offset, first.inode) <
+               std::make_tuple(!second.found, !second.resident, second.device, second.physical_offset, second.inode);
+    });
+
+    auto result = std::vector<std::string>();
+    result.reserve(ordered.size());
+
+    for (const auto& placement : ordered) {
+        result.push_back(paths[placement.index]);
+    }
+
+    return result;
+}
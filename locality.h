@@ -0,0 +1,11 @@
+#pragma once
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    //drops every path to a (device, inode) already listed, then orders the rest so their headers are read with as few seeks as possible:
+    //files whose first page is in the page cache (mincore) first, then by device and the physical offset of their first extent
+    //(FIEMAP on linux, F_LOG2PHYS_EXT on apple's platforms, the inode number where neither is supported).
+    //paths that cannot be stat'd are kept, last, for process_file to report. probing runs on at most jobs threads
+    std::vector<std::string> order_by_locality(const std::vector<std::string>& paths, unsigned int jobs) noexcept;
+}
@@ -0,0 +1,410 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#ifdef __APPLE__
+#include <mach-o/loader.h>
+#include <mach-o/fat.h>
+#else
+//the parts of <mach-o/loader.h> and <mach-o/fat.h> rmaslr uses, so it builds without apple's sdk
+typedef int cpu_type_t;
+typedef int cpu_subtype_t;
+
+#define CPU_ARCH_ABI64 0x01000000
+#define CPU_ARCH_ABI64_32 0x02000000
+
+#define CPU_TYPE_X86 7
+#define CPU_TYPE_I386 CPU_TYPE_X86
+#define CPU_TYPE_X86_64 (CPU_TYPE_X86 | CPU_ARCH_ABI64)
+#define CPU_TYPE_ARM 12
+#define CPU_TYPE_ARM64 (CPU_TYPE_ARM | CPU_ARCH_ABI64)
+#define CPU_TYPE_ARM64_32 (CPU_TYPE_ARM | CPU_ARCH_ABI64_32)
+#define CPU_TYPE_POWERPC 18
+#define CPU_TYPE_POWERPC64 (CPU_TYPE_POWERPC | CPU_ARCH_ABI64)
+
+#define CPU_SUBTYPE_MASK 0xff000000
+#define CPU_SUBTYPE_MULTIPLE -1
+
+#define CPU_SUBTYPE_I386_ALL 3
+#define CPU_SUBTYPE_X86_64_ALL 3
+#define CPU_SUBTYPE_X86_64_H 8
+#define CPU_SUBTYPE_ARM_ALL 0
+#define CPU_SUBTYPE_ARM_V4T 5
+#define CPU_SUBTYPE_ARM_V6 6
+#define CPU_SUBTYPE_ARM_V5TEJ 7
+#define CPU_SUBTYPE_ARM_XSCALE 8
+#define CPU_SUBTYPE_ARM_V7 9
+#define CPU_SUBTYPE_ARM_V7F 10
+#define CPU_SUBTYPE_ARM_V7S 11
+#define CPU_SUBTYPE_ARM_V7K 12
+#define CPU_SUBTYPE_ARM_V6M 14
+#define CPU_SUBTYPE_ARM_V7M 15
+#define CPU_SUBTYPE_ARM_V7EM 16
+#define CPU_SUBTYPE_ARM64_ALL 0
+#define CPU_SUBTYPE_ARM64_V8 1
+#define CPU_SUBTYPE_ARM64E 2
+#define CPU_SUBTYPE_ARM64_32_V8 1
+#define CPU_SUBTYPE_POWERPC_ALL 0
+#define CPU_SUBTYPE_POWERPC_970 100
+
+struct mach_header {
+    uint32_t magic;
+    cpu_type_t cputype;
+    cpu_subtype_t cpusubtype;
+    uint32_t filetype;
+    uint32_t ncmds;
+    uint32_t sizeofcmds;
+    uint32_t flags;
+};
+
+struct mach_header_64 {
+    uint32_t magic;
+    cpu_type_t cputype;
+    cpu_subtype_t cpusubtype;
+    uint32_t filetype;
+    uint32_t ncmds;
+    uint32_t sizeofcmds;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+#define MH_MAGIC 0xfeedface
+#define MH_CIGAM 0xcefaedfe
+#define MH_MAGIC_64 0xfeedfacf
+#define MH_CIGAM_64 0xcffaedfe
+
+#define MH_OBJECT 0x1
+#define MH_EXECUTE 0x2
+#define MH_DYLIB 0x6
+#define MH_DYLINKER 0x7
+#define MH_BUNDLE 0x8
+
+#define MH_NOUNDEFS 0x1
+#define MH_DYLDLINK 0x4
+#define MH_TWOLEVEL 0x80
+#define MH_PIE 0x200000
+
+struct load_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+};
+
+#define LC_REQ_DYLD 0x80000000
+#define LC_SEGMENT 0x1
+#define LC_SEGMENT_64 0x19
+#define LC_CODE_SIGNATURE 0x1d
+#define LC_ENCRYPTION_INFO 0x21
+#define LC_ENCRYPTION_INFO_64 0x2C
+
+struct linkedit_data_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    uint32_t dataoff;
+    uint32_t datasize;
+};
+
+struct encryption_info_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    uint32_t cryptoff;
+    uint32_t cryptsize;
+    uint32_t cryptid;
+};
+
+struct encryption_info_command_64 {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    uint32_t cryptoff;
+    uint32_t cryptsize;
+    uint32_t cryptid;
+    uint32_t pad;
+};
+
+#define FAT_MAGIC 0xcafebabe
+#define FAT_CIGAM 0xbebafeca
+
+struct fat_header {
+    uint32_t magic;
+    uint32_t nfat_arch;
+};
+
+struct fat_arch {
+    cpu_type_t cputype;
+    cpu_subtype_t cpusubtype;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t align;
+};
+#endif
+
+//subtypes newer than some sdks
+#ifndef CPU_SUBTYPE_ARM_V8
+#define CPU_SUBTYPE_ARM_V8 13
+#endif
+
+#ifndef CPU_SUBTYPE_ARM_V8M
+#define CPU_SUBTYPE_ARM_V8M 17
+#endif
+
+#ifndef CPU_SUBTYPE_ARM64E
+#define CPU_SUBTYPE_ARM64E 2
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if !defined(FAT_MAGIC_64) && !defined(FAT_CIGAM_64)
+struct fat_arch_64 {
+    cpu_type_t cputype;
+    cpu_subtype_t cpusubtype;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t align;
+    uint32_t reserved;
+};
+
+#define FAT_MAGIC_64 0xcafebabf
+#define FAT_CIGAM_64 0xbfbafeca
+#endif
+
+namespace rmaslr {
+    //byte-order of a header is decided once, every field access afterwards is either a plain load or a bswap
+    template <bool swapped>
+    struct byte_order {
+        static inline uint32_t get(uint32_t value) noexcept {
+            return swapped ? __builtin_bswap32(value) : value;
+        }
+
+        static inline uint64_t get(uint64_t value) noexcept {
+            return swapped ? __builtin_bswap64(value) : value;
+        }
+
+        static inline int32_t get(int32_t value) noexcept {
+            return static_cast<int32_t>(get(static_cast<uint32_t>(value)));
+        }
+    };
+
+    template <bool swapped>
+    class header_view {
+    public:
+        explicit header_view(const struct mach_header *header) noexcept : header_(header) {}
+
+        inline cpu_type_t cputype() const noexcept {
+            return byte_order<swapped>::get(header_->cputype);
+        }
+
+        inline cpu_subtype_t cpusubtype() const noexcept {
+            return byte_order<swapped>::get(header_->cpusubtype);
+        }
+
+        inline uint32_t filetype() const noexcept {
+            return byte_order<swapped>::get(header_->filetype);
+        }
+
+        inline uint32_t ncmds() const noexcept {
+            return byte_order<swapped>::get(header_->ncmds);
+        }
+
+        inline uint32_t sizeofcmds() const noexcept {
+            return byte_order<swapped>::get(header_->sizeofcmds);
+        }
+
+        inline uint32_t flags() const noexcept {
+            return byte_order<swapped>::get(header_->flags);
+        }
+    private:
+        const struct mach_header *header_;
+    };
+
+    template <bool is_64>
+    using fat_arch_type = typename std::conditional<is_64, struct fat_arch_64, struct fat_arch>::type;
+
+    //fat_arch/fat_arch_64 table, fields are returned in host byte-order
+    template <bool swapped, bool is_64>
+    class fat_view {
+    public:
+        using arch_type = fat_arch_type<is_64>;
+
+        explicit fat_view(const arch_type *archs) noexcept : archs_(archs) {}
+
+        inline cpu_type_t cputype(uint32_t index) const noexcept {
+            return byte_order<swapped>::get(archs_[index].cputype);
+        }
+
+        inline cpu_subtype_t cpusubtype(uint32_t index) const noexcept {
+            return byte_order<swapped>::get(archs_[index].cpusubtype);
+        }
+
+        inline uint64_t offset(uint32_t index) const noexcept {
+            return byte_order<swapped>::get(archs_[index].offset);
+        }
+
+        inline uint64_t size(uint32_t index) const noexcept {
+            return byte_order<swapped>::get(archs_[index].size);
+        }
+    private:
+        const arch_type *archs_;
+    };
+
+    inline bool is_swapped_magic(uint32_t magic) noexcept {
+        return magic == MH_CIGAM || magic == MH_CIGAM_64 || magic == FAT_CIGAM || magic == FAT_CIGAM_64;
+    }
+
+    //calls function(header_view<swapped>) with the view matching the header's byte-order
+    template <typename F>
+    inline auto with_header_view(const struct mach_header *header, F function) -> decltype(function(header_view<false>(header))) {
+        if (is_swapped_magic(header->magic)) {
+            return function(header_view<true>(header));
+        }
+
+        return function(header_view<false>(header));
+    }
+
+    //size of the mach_header or mach_header_64 of header, the load commands start right after it
+    inline uint64_t header_size(const struct mach_header *header) noexcept {
+        if (header->magic == MH_MAGIC_64 || header->magic == MH_CIGAM_64) {
+            return sizeof(struct mach_header_64);
+        }
+
+        return sizeof(struct mach_header);
+    }
+
+    //walks load commands one at a time, nothing past the last one returned is ever read.
+    //every command is checked to lie within size bytes of commands, iteration stops at the first one that does not
+    template <bool swapped>
+    class load_command_iterator {
+    public:
+        load_command_iterator(const uint8_t *commands, uint64_t size, uint32_t count) noexcept : commands_(commands), size_(size), count_(count) {}
+
+        //the next command, nullptr once count commands were returned or when the next one is out of bounds (malformed() is then true)
+        const struct load_command *next() noexcept {
+            if (index_ == count_ || malformed_) {
+                return nullptr;
+            }
+
+            if (size_ - offset_ < sizeof(struct load_command)) {
+                malformed_ = true;
+                return nullptr;
+            }
+
+            auto command = reinterpret_cast<const struct load_command *>(&commands_[offset_]);
+            uint32_t cmdsize = byte_order<swapped>::get(command->cmdsize);
+
+            if (cmdsize < sizeof(struct load_command) || cmdsize > size_ - offset_) {
+                malformed_ = true;
+                return nullptr;
+            }
+
+            offset_ += cmdsize;
+            index_++;
+
+            return command;
+        }
+
+        inline uint32_t cmd(const struct load_command *command) const noexcept {
+            return byte_order<swapped>::get(command->cmd);
+        }
+
+        //command as T, nullptr if its cmdsize is too small to hold one
+        template <typename T>
+        inline const T *as(const struct load_command *command) const noexcept {
+            if (byte_order<swapped>::get(command->cmdsize) < sizeof(T)) {
+                return nullptr;
+            }
+
+            return reinterpret_cast<const T *>(command);
+        }
+
+        inline bool malformed() const noexcept {
+            return malformed_;
+        }
+    private:
+        const uint8_t *commands_;
+        uint64_t size_;
+        uint64_t offset_ = 0;
+
+        uint32_t count_;
+        uint32_t index_ = 0;
+
+        bool malformed_ = false;
+    };
+
+    //lane 0: cputype, cpusubtype, offset. lane 1: size, align, reserved
+#if defined(__x86_64__) || defined(__i386__)
+    //built for ssse3 even when the rest of the build isn't (the default on linux), only called once has_ssse3() is true
+    __attribute__((target("ssse3"))) inline void swap_fat_archs_64_ssse3(const struct fat_arch_64 *in, struct fat_arch_64 *out, size_t count) noexcept {
+        const __m128i lane0 = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 15, 14, 13, 12, 11, 10, 9, 8);
+        const __m128i lane1 = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 15, 14, 13, 12);
+
+        for (size_t i = 0; i < count; i++) {
+            const __m128i *source = reinterpret_cast<const __m128i *>(&in[i]);
+            __m128i *destination = reinterpret_cast<__m128i *>(&out[i]);
+
+            __m128i first = _mm_loadu_si128(&source[0]);
+            __m128i second = _mm_loadu_si128(&source[1]);
+
+            _mm_storeu_si128(&destination[0], _mm_shuffle_epi8(first, lane0));
+            _mm_storeu_si128(&destination[1], _mm_shuffle_epi8(second, lane1));
+        }
+    }
+
+    //always true when the build targets ssse3 (x86_64 macOS does), otherwise asked of the cpu once
+    inline bool has_ssse3() noexcept {
+#if defined(__SSSE3__)
+        return true;
+#else
+        static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3"));
+        return supported;
+#endif
+    }
+#endif
+
+    //swaps every field of count fat_arch_64 entries from in into out, in and out may be the same
+    inline void swap_fat_archs_64(const struct fat_arch_64 *in, struct fat_arch_64 *out, size_t count) noexcept {
+        static_assert(sizeof(struct fat_arch_64) == 32, "fat_arch_64 is expected to be two 16-byte lanes");
+
+#if defined(__x86_64__) || defined(__i386__)
+        if (has_ssse3()) {
+            swap_fat_archs_64_ssse3(in, out, count);
+            return;
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        static const uint8_t lane0_indexes[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 15, 14, 13, 12, 11, 10, 9, 8 };
+        static const uint8_t lane1_indexes[16] = { 7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 15, 14, 13, 12 };
+
+        const uint8x16_t lane0 = vld1q_u8(lane0_indexes);
+        const uint8x16_t lane1 = vld1q_u8(lane1_indexes);
+
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t *source = reinterpret_cast<const uint8_t *>(&in[i]);
+            uint8_t *destination = reinterpret_cast<uint8_t *>(&out[i]);
+
+            uint8x16_t first = vld1q_u8(source);
+            uint8x16_t second = vld1q_u8(source + 16);
+
+            vst1q_u8(destination, vqtbl1q_u8(first, lane0));
+            vst1q_u8(destination + 16, vqtbl1q_u8(second, lane1));
+        }
+
+        return;
+#endif
+
+        for (size_t i = 0; i < count; i++) {
+            struct fat_arch_64 arch = in[i];
+
+            arch.cputype = byte_order<true>::get(arch.cputype);
+            arch.cpusubtype = byte_order<true>::get(arch.cpusubtype);
+            arch.offset = byte_order<true>::get(arch.offset);
+            arch.size = byte_order<true>::get(arch.size);
+            arch.align = byte_order<true>::get(arch.align);
+            arch.reserved = byte_order<true>::get(arch.reserved);
+
+            out[i] = arch;
+        }
+    }
+}
@@ -9,6 +9,8 @@
 #include <cstdarg>
 #include <cstddef>
 
+#include <algorithm>
+
 #include <iostream>
 #include <map>
 #include <string>
@@ -16,9 +18,19 @@
 
 #include <dirent.h>
 #include <dlfcn.h>
+#include <glob.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "batch.h"
+#include "bundle.h"
+#include "catalog.h"
+#include "clone.h"
+#include "ipa.h"
+#include "locality.h"
+#include "report.h"
+#include "shared_cache.h"
+#include "watch.h"
 #include "rmaslr.h"
 
 //compatibility with linter-clang and older headers
@@ -64,14 +76,13 @@ namespace environment {
         return buffer;
     };
 
-    static std::string current_directory = get_current_directory();
+    //only resolved when a relative path needs it
+    const std::string& current_directory() noexcept {
+        static std::string current_directory = get_current_directory();
+        return current_directory;
+    }
 }
 
-static CFArrayRef (*SBSCopyApplicationDisplayIdentifiers)(bool onlyActive, bool debugging) = nullptr;
-
-static CFStringRef (*SBSCopyLocalizedApplicationNameForDisplayIdentifier)(CFStringRef bundle_id) = nullptr;
-static CFStringRef (*SBSCopyExecutablePathForDisplayIdentifier)(CFStringRef bundle_id) = nullptr;
-
 void print_usage() noexcept {
     fprintf(stdout, "Usage: rmaslr -a application\n");
     fprintf(stdout, "Options:\n");
@@ -79,15 +90,167 @@ void print_usage() noexcept {
     fprintf(stdout, "    -apps,  --applications,        Print a list of Applications\n");
     fprintf(stdout, "    -arch,  --architecture,        Single out an architecture to remove ASLR from\n");
     fprintf(stdout, "    -archs, --architectures,       Print all possible architectures, and if application/binary is provided, print all architectures present\n");
-    fprintf(stdout, "    -b,     --binary,              Remove ASLR for a Mach-O Executable\n");
-    fprintf(stdout, "    -c,     --check,               Check if application or binary contains ASLR\n");
+    fprintf(stdout, "    -b,     --binary,              Remove ASLR for Mach-O Executables or an .ipa (a dyld shared cache can be checked with -c), more than one (or a glob) are run like -r, ordered to read from disk sequentially\n");
+    fprintf(stdout, "    -c,     --check,               Check if application or binary contains ASLR, is encrypted or is code signed\n");
+    fprintf(stdout, "            --dedup,               With -r, parse hardlinked and identical files once: edit (give copies the same edit) or link (replace copies with hard links)\n");
+    fprintf(stdout, "            --deep,                With -a or -b, also run the executables of every bundle nested in the application (extensions, watch apps, helpers), with one report\n");
+    fprintf(stdout, "            --files-from,          Also run the NUL-delimited paths in this file (- for stdin), like several -b paths\n");
+    fprintf(stdout, "            --format,              Output format of -c, -archs and -r: text (default), ndjson or csv, one record per architecture\n");
     fprintf(stdout, "    -h,     --help,                Print this message\n");
+    fprintf(stdout, "            --io-uring,            With -r, read and patch files through io_uring on one thread instead of -j threads (Linux only)\n");
+    fprintf(stdout, "    -j,     --jobs,                Number of files to process at once with -r (defaults to one per cpu)\n");
+    fprintf(stdout, "            --journal,             Path of the journal every change is recorded in first (defaults to ~/Library/Caches/com.inoahdev.rmaslr.journal)\n");
+    fprintf(stdout, "    -o,     --output,              Write patched copies to this path or directory, cloning the originals where the filesystem can\n");
+    fprintf(stdout, "    -r,     --recursive,           Remove ASLR for every Mach-O found in the provided directories/files\n");
+    fprintf(stdout, "            --restore,             Undo every change recorded in the journal, newest first\n");
+    fprintf(stdout, "            --stats,               Print the time spent in every stage, and the bytes and syscalls used, to stderr at exit (one json object with --format ndjson or csv)\n");
+    fprintf(stdout, "            --trace,               Write a chrome trace-event json file of where time was spent (opened with perfetto or chrome://tracing) to this path\n");
+    fprintf(stdout, "            --watch,               Stay running and remove ASLR from (or with -c, check) every file written into the provided directories (Linux only)\n");
     fprintf(stdout, "    -u,     --usage,               Print this message\n");
 
     exit(0);
 }
 
+void print_applications(const rmaslr::application_list& applications, const std::vector<size_t>& indexes) noexcept {
+    using field = rmaslr::application_list::field;
+
+    size_t max_container_size = 0;
+    size_t max_display_size = 0;
+    size_t max_executable_name_size = 0;
+
+    for (size_t index : indexes) {
+        if (rmaslr::platform::macosx()) {
+            max_container_size = std::max(max_container_size, strlen(applications.get(index, field::container_name)));
+        }
+
+        max_display_size = std::max(max_display_size, strlen(applications.get(index, field::display_name)));
+        max_executable_name_size = std::max(max_executable_name_size, strlen(applications.get(index, field::executable_name)));
+    }
+
+    std::string container_spaces;
+    if (rmaslr::platform::macosx()) {
+        container_spaces = std::string(max_container_size + 1, ' ');
+    }
+
+    std::string display_spaces = std::string(max_display_size + 1, ' ');
+    std::string executable_spaces = std::string(max_executable_name_size + 1, ' ');
+
+    auto i = 1;
+    auto size_spaces = std::string(rmaslr::get_size(indexes.size()), ' ');
+
+    for (size_t index : indexes) {
+        const char *container_name = applications.get(index, field::container_name);
+        const char *display_name = applications.get(index, field::display_name);
+        const char *executable_name = applications.get(index, field::executable_name);
+        const char *bundle_identifier = applications.get(index, field::bundle_identifier);
+
+        if (rmaslr::platform::iphoneos()) {
+            fprintf(stdout, "%d. %sApplication (Display Name: \"%s\",%sExecutable Name: \"%s\",%sBundle Identifier: \"%s\")\n", i, &size_spaces[rmaslr::get_size(i)], display_name, &display_spaces[strlen(display_name)], executable_name, &executable_spaces[strlen(executable_name)], bundle_identifier);
+        } else {
+            fprintf(stdout, "%d. %sApplication (Container Name: \"%s\",%sDisplay Name: \"%s\",%sExecutable Name: \"%s\",%sBundle Identifier: \"%s\")\n", i, &size_spaces[rmaslr::get_size(i)], container_name, &container_spaces[strlen(container_name)], display_name, &display_spaces[strlen(display_name)], executable_name, &executable_spaces[strlen(executable_name)], bundle_identifier);
+        }
+
+        i++;
+    }
+}
+
+//SpringBoardServices is only needed to list applications on iOS, so only the commands that do load it
+int load_springboard() noexcept {
+    if (!rmaslr::platform::iphoneos()) {
+        return 0;
+    }
+
+    switch (rmaslr::springboard::load()) {
+        case rmaslr::springboard::load_status::ok:
+            break;
+        case rmaslr::springboard::load_status::missing_framework:
+            assert_("Unable to load Required Framework: SpringBoardServices");
+        case rmaslr::springboard::load_status::missing_functions:
+            assert_("Unable to load required functions from Required Framework: SpringBoardServices");
+    }
+
+    return 0;
+}
+
+//appends every NUL-delimited path in the file at list_path, or stdin for "-". relative paths are relative to the current directory
+static bool read_files_from(const char *list_path, std::vector<std::string>& paths) noexcept {
+    FILE *list = strcmp(list_path, "-") == 0 ? stdin : fopen(list_path, "r");
+    if (!list) {
+        return false;
+    }
+
+    char *line = nullptr;
+    size_t capacity = 0;
+
+    ssize_t length = 0;
+    while ((length = getdelim(&line, &capacity, '\0', list)) > 0) {
+        //the last path may or may not be terminated
+        if (line[length - 1] == '\0') {
+            length--;
+        }
+
+        if (!length) {
+            continue;
+        }
+
+        if (line[0] == '/') {
+            paths.emplace_back(line, static_cast<size_t>(length));
+        } else {
+            paths.push_back(environment::current_directory() + std::string(line, static_cast<size_t>(length)));
+        }
+    }
+
+    free(line);
+    if (list != stdin) {
+        fclose(list);
+    }
+
+    return true;
+}
+
+//set once options are parsed, stats are printed from atexit as many paths leave through error()
+static bool stats_json = false;
+
+void print_stats() noexcept {
+    rmaslr::stats::print(stderr, stats_json);
+}
+
 int main(int argc, const char * argv[], const char * envp[]) noexcept {
+    //taken out before anything else, so platform detection and loading SpringBoardServices are measured too,
+    //and so they can be given alongside options that take no others such as -apps
+    for (int i = 1; i < argc; i++) {
+        int taken = 0;
+        if (strcmp(argv[i], "--stats") == 0) {
+            if (!rmaslr::stats::enabled()) {
+                rmaslr::stats::enable();
+                atexit(print_stats);
+            }
+
+            taken = 1;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            if (i == argc - 1) {
+                assert_("Please provide a path for the trace");
+            }
+
+            if (rmaslr::trace::enabled()) {
+                assert_("Please provide only one path for the trace");
+            }
+
+            if (!rmaslr::trace::start(argv[i + 1])) {
+                assert_("Unable to create trace at path (%s), errno=%d(%s)", argv[i + 1], errno, strerror(errno));
+            }
+
+            atexit(rmaslr::trace::finish);
+            taken = 2;
+        }
+
+        if (taken) {
+            std::copy(&argv[i + taken], &argv[argc], &argv[i]);
+            argc -= taken;
+            i--;
+        }
+    }
+
     if (argc < 2) {
         print_usage();
     }
@@ -95,25 +258,25 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
     const char *name = nullptr;
     const char *binary_path = nullptr;
 
-    void *handle = nullptr;
+    auto default_architectures = rmaslr::architecture_set();
 
-    if (rmaslr::platform::iphoneos()) {
-        handle = dlopen("/System/Library/PrivateFrameworks/SpringBoardServices.framework/SpringBoardServices", RTLD_NOW);
-        if (!handle) {
-            assert_("Unable to load Required Framework: SpringBoardServices");
-        }
+    bool recursive = false;
+    bool watching = false;
+    bool restoring = false;
+    bool deep = false;
 
-        SBSCopyApplicationDisplayIdentifiers = (CFArrayRef(*)(bool, bool))dlsym(handle, "SBSCopyApplicationDisplayIdentifiers");
-        SBSCopyLocalizedApplicationNameForDisplayIdentifier = (CFStringRef (*)(CFStringRef))dlsym(handle, "SBSCopyLocalizedApplicationNameForDisplayIdentifier");
-        SBSCopyExecutablePathForDisplayIdentifier = (CFStringRef (*)(CFStringRef))dlsym(handle, "SBSCopyExecutablePathForDisplayIdentifier");
+    auto journal_path = std::string();
+    const char *output_path = nullptr;
 
-        if (!SBSCopyApplicationDisplayIdentifiers || !SBSCopyLocalizedApplicationNameForDisplayIdentifier || !SBSCopyExecutablePathForDisplayIdentifier) {
-            assert_("Unable to load required functions from Required Framework: SpringBoardServices");
-        }
-    }
+    auto binary_paths = std::vector<std::string>(); //every path given to -b, and in the list of --files-from
+    bool files_from = false;
+    bool prompts_unavailable = false; //stdin was the list of files, and there is no terminal
 
-    auto default_architectures = std::vector<const NXArchInfo *>();
-    auto default_architectures_original_size = 0;
+    auto batch_paths = std::vector<std::string>();
+    auto batch_roots = std::vector<std::pair<std::string, size_t>>(); //every path given to -r, and the index in batch_paths of its first file
+    auto watch_paths = std::vector<std::string>();
+    auto batch_options = rmaslr::batch_options();
+    auto report_format = rmaslr::report_format::text;
 
     const char *argument = argv[1];
     if (argument[0] != '-') {
@@ -137,6 +300,52 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
         return &string[(uintptr_t)result_ - (uintptr_t)string];
     };
 
+    //a path given to -b, an application's directory on mac is taken as its executable
+    auto add_binary = [&](const char *path) -> int {
+        if (path[0] != '/') {
+            path = strdup((environment::current_directory() + path).c_str());
+        }
+
+        struct stat sbuf;
+        if (stat(path, &sbuf) != 0) {
+            assert_("Unable to get information on file at path (%s)", path);
+        }
+
+        name = find_last_component(path);
+
+        //the platform is only looked up for directories, a plain file never needs it
+        if (S_ISDIR(sbuf.st_mode) && rmaslr::platform::macosx()) {
+            auto information = rmaslr::application();
+            if (!rmaslr::parse_application_container(path, information)) {
+                assert_("Directory at path (%s) is not an application", path);
+            }
+
+            path = strdup(information.executable_path.c_str());
+            if (!strlen(path) || access(path, F_OK) != 0) {
+                assert_("Executable at path (\"%s\") is not valid (either not found in Info.plist or not present on the filesystem)", path);
+            }
+
+            rmaslr::options::application(true);
+        }
+
+        if (access(path, R_OK) != 0) {
+            if (access(path, F_OK) != 0) {
+                assert_("File at path (%s) does not exist", path);
+            }
+
+            if (rmaslr::is_root()) {
+                assert_("Unable to read file at path (%s)", path);
+            } else {
+                assert_("Unable to read file at path (%s). Try running as root", path);
+            }
+        }
+
+        binary_path = path;
+        binary_paths.push_back(path);
+
+        return 0;
+    };
+
     if (strcmp(option, "h") == 0 || strcmp(option, "help") == 0 || strcmp(option, "u") == 0 || strcmp(option, "usage") == 0) {
         if (argc > 2) {
             assert_("Please run %s seperately", argument);
@@ -158,194 +367,33 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
             }
         }
 
-        auto applications = std::vector<std::map<const char *, std::string>>();
-
-        if (rmaslr::platform::iphoneos()) {
-            CFArrayRef applications_ = SBSCopyApplicationDisplayIdentifiers(false, false);
-            if (!applications_) {
-                assert_("Unable to retrieve application-list");
-            }
-
-            auto size = CFArrayGetCount(applications_);
-            for (CFIndex i = 0; i < size; i++) {
-                CFStringRef bundle_id = (CFStringRef)CFArrayGetValueAtIndex(applications_, i);
-                if (!bundle_id) {
-                    continue;
-                }
-
-                CFStringRef display_name = SBSCopyLocalizedApplicationNameForDisplayIdentifier(bundle_id);
-                if (!display_name) {
-                    continue;
-                }
-
-                const char *displayName = CFStringGetCStringPtr(display_name, kCFStringEncodingUTF8);
-                const char *bundleIdentifier = "";
-
-                const char *executablePath = "";
-                const char *executableName = "";
-
-                if (use_listing) {
-                    bundleIdentifier = CFStringGetCStringPtr(bundle_id, kCFStringEncodingUTF8);
-                    executablePath = CFStringGetCStringPtr(SBSCopyExecutablePathForDisplayIdentifier(bundle_id), kCFStringEncodingUTF8);
-
-                    executableName = find_last_component(executablePath);
-                }
-
-                if (!displayName || !bundleIdentifier || !executablePath || !executableName) {
-                    continue;
-                }
-
-                applications.push_back({{ "bundleIdentifier", bundleIdentifier }, { "displayName", displayName }, { "containerName", "" }, { "executableName", executableName }, { "executablePath", executablePath }});
-            }
-        } else {
-            DIR *directory = opendir("/Applications");
-            if (!directory) {
-                error("Unable to access directory \"/Applications\".");
-            }
-
-            std::string applicationDirectory = "/Applications/";
-            struct dirent *dir_entry = nullptr;
-
-            while ((dir_entry = readdir(directory))) {
-                auto application = applicationDirectory + dir_entry->d_name;
-                auto application_information = rmaslr::parse_application_container(application);
-
-                if (application_information.empty()) {
-                    continue;
-                }
-
-                applications.push_back(application_information);
-            }
+        if (load_springboard() != 0) {
+            return -1;
         }
 
-        auto sorted_vector = std::vector<std::map<const char *, std::string>>();
-        std::string first_name;
-
-        for (auto& information : applications) {
-            auto information_ = information;
-
-            std::string name = information_["containerName"];
-            if (name.empty() || std::is_in_map(sorted_vector, name)) {
-                name = information_["displayName"];
-                if (name.empty() || std::is_in_map(sorted_vector, name)) {
-                    name = information_["executableName"];
-                    if (!use_listing) {
-                        information_["displayName"] = "";
-                        information_["containerName"] = "";
-                    }
-                } else if (!use_listing) {
-                    information_["executableName"] = "";
-                    information_["containerName"] = "";
-                }
-            } else if (!use_listing) {
-                information_["displayName"] = "";
-                information_["executableName"] = "";
-            }
-
-            sorted_vector.push_back(information);
+        auto applications = rmaslr::load_applications();
+        if (applications.empty()) {
+            assert_("Unable to retrieve application-list");
         }
 
-        std::sort(sorted_vector.begin(), sorted_vector.end(), [](std::map<const char *, std::string>& first, std::map<const char *, std::string>& second) {
-            std::string first_name = first["containerName"];
-            if (first_name.empty()) {
-                first_name = first["displayName"];
-                if (first_name.empty()) {
-                    first_name = first["executableName"];
-                    if (first_name.empty()) {
-                        return false;
-                    }
-                }
-            }
-
-            std::string second_name = second["containerName"];
-            if (second_name.empty()) {
-                second_name = second["displayName"];
-                if (second_name.empty()) {
-                    second_name = second["executableName"];
-                    if (second_name.empty()) {
-                        return false;
-                    }
-                }
-            }
-
-            return std::case_compare(first_name, second_name);
-        });
-
+        auto sorted = applications.sorted();
         if (use_listing) {
-            auto max_container_size = 0;
-            auto max_display_size = 0;
-            auto max_executable_name_size = 0;
-
-            for (auto& information : sorted_vector) {
-                if (rmaslr::platform::macosx()) {
-                    auto container_length = information["containerName"].length();
-                    if (max_container_size < container_length) {
-                        max_container_size = container_length;
-                    }
-                }
-
-                auto display_length = information["displayName"].length();
-                if (max_display_size < display_length) {
-                    max_display_size = display_length;
-                }
-
-                auto executable_length = information["executableName"].length();
-                if (max_executable_name_size < executable_length) {
-                    max_executable_name_size = executable_length;
-                }
-            }
-
-            std::string container_spaces;
-            if (rmaslr::platform::macosx()) {
-                container_spaces = std::string(max_container_size + 1, ' ');
-            }
-
-            std::string display_spaces = std::string(max_display_size + 1, ' ');
-            std::string executable_spaces = std::string(max_executable_name_size + 1, ' ');
-
-            auto i = 1;
-            auto size_spaces = std::string(rmaslr::get_size(sorted_vector.size()), ' ');
-
-            for (auto& information : sorted_vector) {
-                if (rmaslr::platform::iphoneos()) {
-                    fprintf(stdout, "%d. %sApplication (Display Name: \"%s\",%sExecutable Name: \"%s\",%sBundle Identifier: \"%s\")\n", i, &size_spaces[rmaslr::get_size(i)], information["displayName"].c_str(), &display_spaces[information["displayName"].length()], information["executableName"].c_str(), &executable_spaces[information["executableName"].length()], information["bundleIdentifier"].c_str());
-                } else {
-                    fprintf(stdout, "%d. %sApplication (Container Name: \"%s\",%sDisplay Name: \"%s\",%sExecutable Name: \"%s\",%sBundle Identifier: \"%s\")\n", i, &size_spaces[rmaslr::get_size(i)], information["containerName"].c_str(), &container_spaces[information["containerName"].length()], information["displayName"].c_str(), &display_spaces[information["displayName"].length()], information["executableName"].c_str(), &executable_spaces[information["executableName"].length()], information["bundleIdentifier"].c_str());
-                }
-
-                i++;
-            }
+            print_applications(applications, sorted);
         } else {
-            auto front = sorted_vector.front();
-
-            std::string name = front["containerName"];
-            if (name.empty()) {
-                name = front["displayName"];
-                if (name.empty()) {
-                    name = front["executableName"];
-                }
-            }
-
-            fprintf(stdout, "%s", name.c_str());
-            sorted_vector.erase(sorted_vector.begin());
-
-            for (auto& information : sorted_vector) {
-                name = information["containerName"];
-                if (name.empty()) {
-                    name = information["displayName"];
-                    if (name.empty()) {
-                        name = information["executableName"];
-                        if (name.empty()) {
-                            continue;
-                        }
-                    }
+            bool first = true;
+            for (size_t index : sorted) {
+                const char *name = applications.name(index, true);
+                if (!name[0]) {
+                    continue;
                 }
 
-                fprintf(stdout, ", %s", name.c_str());
+                fprintf(stdout, first ? "%s" : ", %s", name);
+                first = false;
             }
 
             fprintf(stdout, "\n");
         }
+
         return 0;
     } else if (strcmp(option, "archs") == 0) {
         if (argc > 2) {
@@ -354,11 +402,8 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
 
         //to sort alphabetically
         auto arch_names = std::vector<const char *>();
-
-        const NXArchInfo *archInfos = NXGetAllArchInfos();
-        while (archInfos && archInfos->name) {
-            arch_names.push_back(archInfos->name);
-            archInfos++; //retrieve next "const NXArchInfo *" object
+        for (const auto& architecture : rmaslr::architectures) {
+            arch_names.push_back(architecture.name);
         }
 
         std::sort(arch_names.begin(), arch_names.end(), [](const char *string1, const char *string2) {
@@ -390,186 +435,49 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
                 assert_("Please provide an application display-name/identifier/executable-name");
             }
 
+            if (recursive || watching) {
+                assert_("Cannot select an application and run recursively at the same time");
+            }
+
             i++;
 
-            auto applications_found = std::vector<std::map<const char *, std::string>>();
             auto app_name = argv[i];
+            if (rmaslr::platform::macosx() && !rmaslr::is_root()) {
+                error("rmaslr needs to be run as root on mac when selecting mac applications placed in /Applications/");
+            }
 
-            if (rmaslr::platform::iphoneos()) {
-                CFArrayRef apps = SBSCopyApplicationDisplayIdentifiers(false, false);
-                if (!apps) {
-                    assert_("Unable to retrieve application-list");
-                }
-
-                auto size = CFArrayGetCount(apps);
-                for (CFIndex i = 0; i < size; i++) {
-                    if (binary_path) {
-                        binary_path = nullptr;
-                    }
-
-                    CFStringRef bundle_id = (CFStringRef)CFArrayGetValueAtIndex(apps, i);
-                    if (!bundle_id) {
-                        continue;
-                    }
-
-                    char const * display_name = CFStringGetCStringPtr(SBSCopyLocalizedApplicationNameForDisplayIdentifier(bundle_id), kCFStringEncodingUTF8);
-                    char const * executable_path_ = CFStringGetCStringPtr(SBSCopyExecutablePathForDisplayIdentifier(bundle_id), kCFStringEncodingUTF8);
-                    char const * bundle_id_ = CFStringGetCStringPtr(bundle_id, kCFStringEncodingUTF8);
-
-                    char const * executable_name = find_last_component(executable_path_);
-
-                    //apparently "iTunesU" has a null display name?
-                    if (!display_name || !executable_path_ || !bundle_id_) {
-                        continue;
-                    }
-
-                    const char *name_ = display_name;
-                    if (!strlen(name_) || strcmp(name_, app_name) != 0) {
-                        name_ = bundle_id_;
-                        if (!strlen(name_) || strcmp(name_, app_name) != 0) {
-                            name_ = executable_name;
-                            if (!strlen(name_) || strcmp(name_, app_name) != 0) {
-                                continue;
-                            }
-                        }
-                    }
-
-                    auto information = std::map<const char *, std::string>();
-                    information = {
-                        { "bundleIdentifier", bundle_id_ },
-                        { "containerName", "" },
-                        { "displayName", display_name },
-                        { "executableName", executable_name },
-                        { "executablePath", executable_path_ }
-                    };
-
-                    applications_found.push_back(information);
-                }
-            } else {
-                if (!rmaslr::is_root()) {
-                    error("rmaslr needs to be run as root on mac when selecting mac applications placed in /Applications/");
-                }
-
-                DIR *directory = opendir("/Applications");
-                if (!directory) {
-                    error("Unable to access directory \"/Applications\".");
-                }
-
-                auto applicationDirectory = std::string("/Applications/");
-                struct dirent *dir_entry = nullptr;
-
-                while ((dir_entry = readdir(directory))) {
-                    auto application = applicationDirectory + dir_entry->d_name;
-                    auto information = rmaslr::parse_application_container(application);
-
-                    if (information.empty()) {
-                        continue;
-                    }
-
-                    std::string name = information["containerName"];
-                    if (name.empty() || name != app_name) {
-                        name = information["displayName"];
-                        if (name.empty() || name != app_name) {
-                            name = information["bundleIdentifier"];
-                            if (name.empty() || name != app_name) {
-                                name = information["executableName"];
-                                if (name.empty() || name != app_name) {
-                                    continue;
-                                }
-                            }
-                        }
-                    }
+            if (load_springboard() != 0) {
+                return -1;
+            }
 
-                    applications_found.push_back(information);
-                }
+            auto applications = rmaslr::load_applications();
+            if (applications.empty()) {
+                assert_("Unable to retrieve application-list");
             }
 
+            auto applications_found = applications.find(app_name);
             if (applications_found.empty()) {
                 assert_("Unable to find application \"%s\"", app_name);
             }
 
             if (applications_found.size() > 1) {
                 fprintf(stdout, "Multiple Applications with the name (\"%s\") have been found:\n", app_name);
+                print_applications(applications, applications_found);
 
-                auto max_container_size = 0;
-                auto max_display_size = 0;
-                auto max_executable_name_size = 0;
-
-                for (auto& information : applications_found) {
-                    if (rmaslr::platform::macosx()) {
-                        auto container_length = information["containerName"].length();
-                        if (max_container_size < container_length) {
-                            max_container_size = container_length;
-                        }
-                    }
-
-                    auto display_length = information["displayName"].length();
-                    if (max_display_size < display_length) {
-                        max_display_size = display_length;
-                    }
-
-                    auto executable_length = information["executableName"].length();
-                    if (max_executable_name_size < executable_length) {
-                        max_executable_name_size = executable_length;
-                    }
-                }
-
-                std::string container_spaces;
-                if (rmaslr::platform::macosx()) {
-                    container_spaces = std::string(max_container_size + 1, ' ');
-                }
-
-                std::string display_spaces = std::string(max_display_size + 1, ' ');
-                std::string executable_spaces = std::string(max_executable_name_size + 1, ' ');
+                auto result = rmaslr::request_input_ranged<int>("Please select one of the applications above by number: ", { 1, static_cast<int>(applications_found.size()) });
+                auto index = applications_found[result - 1];
 
-                auto i = 1;
-                auto size_spaces = std::string(rmaslr::get_size(applications_found.size()), ' ');
-
-                for (auto iter = applications_found.begin(); iter != applications_found.end(); iter++) {
-                    auto information = *iter;
-
-                    if (rmaslr::platform::iphoneos()) {
-                        fprintf(stdout, "%d. %sApplication (Display Name: \"%s\",%sExecutable Name: \"%s\",%sBundle Identifier: \"%s\")\n", i, &size_spaces[rmaslr::get_size(i)], information["displayName"].c_str(), &display_spaces[information["displayName"].length()], information["executableName"].c_str(), &executable_spaces[information["executableName"].length()], information["bundleIdentifier"].c_str());
-                    } else {
-                        fprintf(stdout, "%d. %sApplication (Container Name: \"%s\",%sDisplay Name: \"%s\",%sExecutable Name: \"%s\",%sBundle Identifier: \"%s\")\n", i, &size_spaces[rmaslr::get_size(i)], information["containerName"].c_str(), &container_spaces[information["containerName"].length()], information["displayName"].c_str(), &display_spaces[information["displayName"].length()], information["executableName"].c_str(), &executable_spaces[information["executableName"].length()], information["bundleIdentifier"].c_str());
-                    }
-
-                    i++;
-                }
-
-                auto result = rmaslr::request_input_ranged<int>("Please select one of the applications above by number: ", { 1, i });
-                auto application_information = applications_found[result - 1];
-
-                binary_path = strdup(application_information["executablePath"].c_str());
-
-                auto displayName = application_information["displayName"];
-                auto containerName = application_information["containerName"];
-                auto executableName = application_information["executableName"];
-
-                auto iter = std::find(applications_found.begin(), applications_found.end(), application_information);
-                if (iter != applications_found.end()) {
-                    applications_found.erase(iter);
-                }
-
-                if (!std::is_in_map(applications_found, containerName) && rmaslr::platform::macosx()) {
-                    name = strdup(containerName.c_str());
-                } else if (!std::is_in_map(applications_found, displayName)) {
-                    name = strdup(displayName.c_str());
-                } else if (!std::is_in_map(applications_found, executableName)) {
-                    name = strdup(executableName.c_str());
-                } else {
-                    name = app_name;
-                }
+                binary_path = strdup(applications.get(index, rmaslr::application_list::field::executable_path));
+                name = strdup(applications.name(index, true));
             } else {
-                auto application_information = applications_found.front();
-
+                auto index = applications_found.front();
                 if (rmaslr::platform::iphoneos()) {
-                    name = strdup(application_information["displayName"].c_str());
+                    name = strdup(applications.get(index, rmaslr::application_list::field::display_name));
                 } else {
                     name = app_name;
                 }
 
-                binary_path = strdup(application_information["executablePath"].c_str());
+                binary_path = strdup(applications.get(index, rmaslr::application_list::field::executable_path));
             }
 
             rmaslr::options::application(true);
@@ -585,57 +493,71 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
                 assert_("Please provide a path to a mach-o binary");
             }
 
+            if (recursive || watching) {
+                assert_("Cannot select a binary and run recursively at the same time");
+            }
+
             i++;
-            const char *path = argv[i];
+            for (; i < argc; i++) {
+                const char *pattern = argv[i];
+                if (pattern[0] == '-') {
+                    break;
+                }
 
-            if (path[0] != '/') {
-                std::string current_directory = environment::current_directory;
+                //globs are expanded for callers that don't go through a shell, a path that exists is always taken as is
+                struct stat sbuf;
+                if (strpbrk(pattern, "*?[") && stat(pattern, &sbuf) != 0) {
+                    glob_t matches;
+                    if (glob(pattern, 0, nullptr, &matches) != 0) {
+                        assert_("No files match (%s)", pattern);
+                    }
 
-                current_directory.append(path);
-                path = current_directory.c_str();
-            }
+                    for (size_t index = 0; index < matches.gl_pathc; index++) {
+                        if (add_binary(strdup(matches.gl_pathv[index])) != 0) {
+                            return -1;
+                        }
+                    }
 
-            struct stat sbuf;
-            if (stat(path, &sbuf) != 0) {
-                assert_("Unable to get information on file at path (%s)", path);
+                    globfree(&matches);
+                } else if (add_binary(pattern) != 0) {
+                    return -1;
+                }
             }
 
-            name = find_last_component(path);
-
-            if (rmaslr::platform::macosx() && S_ISDIR(sbuf.st_mode)) {
-                auto path_ = std::string(path);
-                auto information = rmaslr::parse_application_container(path_);
+            i--;
+        } else if (strcmp(option, "files-from") == 0) {
+            if (last_argument) {
+                assert_("Please provide a file of NUL-delimited paths, or - for stdin");
+            }
 
-                if (information.empty()) {
-                    assert_("Directory at path (%s) is not an application", path);
-                }
+            if (recursive || watching) {
+                assert_("Cannot select binaries and run recursively at the same time");
+            }
 
-                path = information["executablePath"].c_str();
-                if (!strlen(path) || access(path, F_OK) != 0) {
-                    assert_("Executable at path (\"%s\") is not valid (either not found in Info.plist or not present on the filesystem)", path);
-                }
+            i++;
 
-                rmaslr::options::application(true);
+            size_t first = binary_paths.size();
+            if (!read_files_from(argv[i], binary_paths)) {
+                assert_("Unable to open list of files at path (%s), errno=%d(%s)", argv[i], errno, strerror(errno));
             }
 
-            binary_path = path;
-            if (access(binary_path, R_OK) != 0) {
-                if (access(binary_path, F_OK) != 0) {
-                    assert_("File at path (%s) does not exist", binary_path);
-                }
+            if (binary_paths.size() == first) {
+                assert_("No paths were provided in (%s)", argv[i]);
+            }
 
-                if (rmaslr::is_root()) {
-                    assert_("Unable to read file at path (%s)", binary_path);
-                } else {
-                    assert_("Unable to read file at path (%s). Try running as root", binary_path);
-                }
+            //prompts are read from the terminal instead
+            if (strcmp(argv[i], "-") == 0 && !freopen("/dev/tty", "r", stdin)) {
+                prompts_unavailable = true;
             }
+
+            binary_path = strdup(binary_paths.front().c_str());
+            files_from = true;
         } else if (strcmp(option, "arch") == 0 || strcmp(option, "architecture") == 0) {
             if (last_argument) {
                 assert_("Please provide an architecture name");
             }
 
-            if (!binary_path) {
+            if (!binary_path && !recursive && !watching) {
                 assert_("Please select an application or binary first");
             }
 
@@ -646,19 +568,18 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
             i++;
             for (; i < argc; i++) {
                 const char *architecture = argv[i];
-                const NXArchInfo *archInfo = NXGetArchInfoFromName(architecture);
+                const rmaslr::architecture *archInfo = rmaslr::find_architecture(architecture);
 
                 if (!archInfo) {
                     break;
                 }
 
-                default_architectures.push_back(archInfo);
+                default_architectures.insert(archInfo);
             }
 
             i--;
 
-            default_architectures_original_size = default_architectures.size();
-            if (!default_architectures_original_size) {
+            if (default_architectures.empty()) {
                 assert_("%s is not a valid architecture", argv[i]);
             }
         } else if (strcmp(option, "archs") == 0 || strcmp(option, "architectures") == 0) {
@@ -666,7 +587,7 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
                 assert_("Please select an application or binary first");
             }
 
-            if (default_architectures.size()) {
+            if (!default_architectures.empty()) {
                 assert_("Cannot both display architectures and select an arch to remove ASLR from");
             }
 
@@ -676,7 +597,7 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
 
             rmaslr::options::display_archs(true);
         } else if (strcmp(option, "c") == 0 || strcmp(option, "check") == 0) {
-            if (!binary_path) {
+            if (!binary_path && !recursive && !watching) {
                 assert_("Please select an application or binary first");
             }
 
@@ -685,287 +606,578 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
             }
 
             rmaslr::options::check_aslr(true);
-        } else {
-            assert_("Unrecognized option %s", argument);
-        }
-    }
+        } else if (strcmp(option, "r") == 0 || strcmp(option, "recursive") == 0) {
+            if (last_argument) {
+                assert_("Please provide a path to a directory or mach-o binary");
+            }
 
-    if (!binary_path) {
-        assert_("Unable to get path");
-    }
+            if (binary_path) {
+                assert_("Cannot select an application or binary and run recursively at the same time");
+            }
 
-    auto file = rmaslr::file(binary_path);
-    struct stat sbuf = file.stat();
+            if (watching) {
+                assert_("Cannot run recursively and watch directories at the same time");
+            }
 
-    if (sbuf.st_size < sizeof(struct mach_header_64)) {
-        if (rmaslr::options::application()) {
-            assert_("Application (%s)'s executable is not a valid mach-o", name);
-        }
+            recursive = true;
 
-        assert_("File (%s) is not a valid mach-o", name);
-    }
+            i++;
+            for (; i < argc; i++) {
+                const char *path = argv[i];
+                if (path[0] == '-') {
+                    break;
+                }
 
-    uint32_t magic = file.read<uint32_t>();
-    bool is_fat = false;
+                batch_roots.emplace_back(path, batch_paths.size());
+                if (!rmaslr::collect_files(path, batch_paths)) {
+                    assert_("Unable to get information on file at path (%s)", path);
+                }
+            }
 
-    switch (magic) {
-        case MH_MAGIC:
-        case MH_CIGAM:
-        case MH_MAGIC_64:
-        case MH_CIGAM_64:
-            break;
-        case FAT_MAGIC:
-        case FAT_CIGAM:
-        case FAT_MAGIC_64:
-        case FAT_CIGAM_64:
-            is_fat = true;
-            break;
-        default: {
-            if (rmaslr::options::application()) {
-                assert_("Application (%s)'s executable is not a valid mach-o", name);
+            i--;
+        } else if (strcmp(option, "format") == 0) {
+            if (last_argument) {
+                assert_("Please provide an output format");
             }
 
-            assert_("File (%s) is not a valid mach-o", name);
+            i++;
+            if (!rmaslr::parse_report_format(argv[i], report_format)) {
+                assert_("%s is not a valid output format (text, ndjson or csv)", argv[i]);
+            }
+        } else if (strcmp(option, "watch") == 0) {
+            if (last_argument) {
+                assert_("Please provide a directory to watch");
+            }
+
+            if (binary_path || recursive) {
+                assert_("Cannot watch directories and select an application or binary, or run recursively, at the same time");
+            }
+
+            watching = true;
+
+            i++;
+            for (; i < argc; i++) {
+                const char *path = argv[i];
+                if (path[0] == '-') {
+                    break;
+                }
+
+                struct stat sbuf;
+                if (stat(path, &sbuf) != 0 || !S_ISDIR(sbuf.st_mode)) {
+                    assert_("%s is not a directory", path);
+                }
+
+                watch_paths.push_back(path);
+            }
+
+            i--;
+        } else if (strcmp(option, "journal") == 0) {
+            if (last_argument) {
+                assert_("Please provide a path for the journal");
+            }
+
+            i++;
+            journal_path = argv[i];
+        } else if (strcmp(option, "o") == 0 || strcmp(option, "output") == 0) {
+            if (last_argument) {
+                assert_("Please provide an output path");
+            }
+
+            i++;
+            output_path = argv[i];
+        } else if (strcmp(option, "restore") == 0) {
+            if (binary_path || recursive || watching) {
+                assert_("Cannot restore from the journal and select an application or binary, or run recursively, at the same time");
+            }
+
+            restoring = true;
+        } else if (strcmp(option, "dedup") == 0) {
+            if (last_argument) {
+                assert_("Please provide a dedup policy");
+            }
+
+            i++;
+            if (strcmp(argv[i], "edit") == 0) {
+                batch_options.dedup = rmaslr::dedup_policy::edit;
+            } else if (strcmp(argv[i], "link") == 0) {
+                batch_options.dedup = rmaslr::dedup_policy::link;
+            } else {
+                assert_("%s is not a valid dedup policy (edit or link)", argv[i]);
+            }
+        } else if (strcmp(option, "deep") == 0) {
+            deep = true;
+        } else if (strcmp(option, "io-uring") == 0) {
+            batch_options.io_uring = true;
+        } else if (strcmp(option, "j") == 0 || strcmp(option, "jobs") == 0) {
+            if (last_argument) {
+                assert_("Please provide a number of jobs");
+            }
+
+            i++;
+
+            char *end = nullptr;
+            auto jobs = strtoul(argv[i], &end, 10);
+
+            if (!jobs || *end != '\0') {
+                assert_("%s is not a valid number of jobs", argv[i]);
+            }
+
+            batch_options.jobs = static_cast<unsigned int>(jobs);
+        } else {
+            assert_("Unrecognized option %s", argument);
         }
     }
 
-    auto has_aslr = [](struct mach_header header, uint32_t *flags = nullptr) {
-        uint32_t flags_ = rmaslr::swap(header.magic, header.flags);
-        if (flags) {
-            *flags = flags_;
+    stats_json = report_format != rmaslr::report_format::text;
+
+    //every target stands for its whole bundle, the executables of it and of the bundles nested inside run like -r with one report.
+    //each bundle is a root for -o
+    if (deep) {
+        if (recursive || watching) {
+            assert_("Cannot process bundles with --deep and run recursively or watch directories at the same time");
         }
 
-        return (flags_ & MH_PIE) > 0;
-    };
+        if (!binary_path) {
+            assert_("Please provide an application, or a binary inside its bundle, to process with --deep");
+        }
 
-    auto remove_aslr = [&file, &name, &has_aslr](long offset, struct mach_header header, const NXArchInfo *archInfo = nullptr) {
-        uint32_t flags;
-        bool aslr = has_aslr(header, &flags);
+        //-a only sets binary_path
+        if (binary_paths.empty()) {
+            binary_paths.push_back(binary_path);
+        }
 
-        if (!aslr) {
-            if (archInfo) {
-                fprintf(stdout, "Architecture (%s) does not contain ASLR\n", archInfo->name);
-            } else {
-                if (rmaslr::options::application()) {
-                    error("Application (%s) does not contain ASLR", name);
-                } else {
-                    error("File (%s) does not contain ASLR", name);
-                }
+        for (const auto& path : binary_paths) {
+            auto bundle = rmaslr::find_bundle_directory(path);
+            if (bundle.empty()) {
+                assert_("File at path (%s) is not in an application's bundle", path.c_str());
             }
 
-            return false;
+            batch_roots.emplace_back(bundle, batch_paths.size());
+            for (auto& executable : rmaslr::order_by_locality(rmaslr::find_bundle_executables(bundle, batch_options.jobs), batch_options.jobs)) {
+                batch_paths.push_back(std::move(executable));
+            }
         }
 
-        //ask user if should remove ASLR for arm64
-        int32_t cputype = rmaslr::swap(header.magic, header.cputype);
-        if (cputype == CPU_TYPE_ARM64) {
-            std::string question = rmaslr::formatted_string("Removing ASLR on a 64-bit arm %s (%s) can result in it crashing. Are you sure you want to continue (y/n): ", rmaslr::options::application() ? "application" : "file", name);
-            std::string result = rmaslr::request_input<std::string>(question, { "y", "n" });
+        binary_path = nullptr;
+        recursive = true;
+    } else if (binary_paths.size() > 1 || files_from) {
+        //more than one target runs like -r over exactly those files, each its own root for -o,
+        //read in the order their headers are laid out on disk
+        for (auto& path : rmaslr::order_by_locality(binary_paths, batch_options.jobs)) {
+            batch_roots.emplace_back(path, batch_paths.size());
+            batch_paths.push_back(std::move(path));
+        }
 
-            if (result == "n" || result == "N") {
-                return false;
-            }
+        binary_path = nullptr;
+        recursive = true;
+    }
+    if (journal_path.empty()) {
+        journal_path = rmaslr::default_journal_path();
+    }
+
+    if (restoring) {
+        if (binary_path || recursive || watching) {
+            assert_("Cannot restore from the journal and select an application or binary, or run recursively, at the same time");
         }
 
-        flags &= ~MH_PIE;
-        header.flags = rmaslr::swap(header.magic, flags);
+        if (journal_path.empty()) {
+            assert_("Unable to find the journal, please provide its path with --journal");
+        }
 
-        file.seek(offset, rmaslr::file::seek_type::origin);
-        file.write<struct mach_header>(header);
+        return rmaslr::restore_journal(journal_path, batch_options.jobs) ? 0 : -1;
+    }
 
-        if (archInfo) {
-            fprintf(stdout, "Removed ASLR for architecture \"%s\"\n", archInfo->name);
-        } else {
-            fprintf(stdout, "Successfully Removed ASLR!\n");
+    //a dyld shared cache is only ever checked, every image in it is reported from the headers the cache maps
+    if (binary_path && !recursive && rmaslr::is_shared_cache(binary_path)) {
+        if (rmaslr::options::display_archs()) {
+            assert_("Cannot print the architectures of a dyld shared cache, check it with -c instead");
         }
 
-        return true;
-    };
+        if (!rmaslr::options::check_aslr() || output_path) {
+            assert_("A dyld shared cache can only be checked, its images are signed as part of it. Please run it with -c instead");
+        }
 
-    auto architectures = std::vector<const NXArchInfo *>();
-    auto headers = std::map<long, struct mach_header>();
+        batch_options.architectures = default_architectures;
+        rmaslr::report report(report_format, batch_options);
 
-    if (is_fat) {
-        file.seek(0x0, rmaslr::file::seek_type::origin);
-        struct fat_header fat = file.read<struct fat_header>();
+        for (const auto& result : rmaslr::check_shared_cache(binary_path, batch_options)) {
+            report.add(result);
+        }
 
-        uint32_t architectures_count = rmaslr::swap(magic, fat.nfat_arch);
-        if (!architectures_count) {
-            if (rmaslr::options::application()) {
-                assert_("Application (%s)'s executable cannot have 0 architectures", name);
+        return report.finish() ? 0 : -1;
+    }
+
+    //an .ipa has its executable patched inside the archive, without the journal, and is written to -o itself
+    if (binary_path && !recursive && rmaslr::is_ipa(binary_path)) {
+        if (rmaslr::options::display_archs()) {
+            assert_("Cannot print the architectures of an .ipa, check it with -c instead");
+        }
+
+        auto output = std::string();
+        if (output_path) {
+            if (rmaslr::options::check_aslr()) {
+                assert_("Cannot write to an output path while checking, printing architectures or watching directories");
             }
 
-            assert_("File (%s) cannot have 0 architectures", name);
+            struct stat sbuf;
+            bool output_is_directory = stat(output_path, &sbuf) == 0 && S_ISDIR(sbuf.st_mode);
+
+            output = output_is_directory ? std::string(output_path) + "/" + find_last_component(binary_path) : std::string(output_path);
         }
 
-        if (magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64) {
-            if (architectures_count * sizeof(struct fat_arch_64) > sbuf.st_size) {
-                if (rmaslr::options::application()) {
-                    assert_("Application (%s)'s executable is too small to contain %d architectures", name, architectures_count);
-                }
+        batch_options.remove_aslr = !rmaslr::options::check_aslr();
+        batch_options.architectures = default_architectures;
+
+        if (batch_options.remove_aslr) {
+            std::string result = rmaslr::request_input<std::string>("Removing ASLR on 64-bit arm files can result in them crashing. Do you want to remove it from 64-bit arm files as well (y/n): ", { "y", "n" });
+            batch_options.allow_arm64 = result == "y";
+        }
+
+        rmaslr::report report(report_format, batch_options);
+        report.add(rmaslr::process_ipa(binary_path, batch_options, output));
 
-                assert_("File (%s) is too small to contain %d architectures", name, architectures_count);
+        return report.finish() ? 0 : -1;
+    }
+
+    //patched copies are written there instead, the originals are left untouched
+    if (output_path) {
+        if (rmaslr::options::check_aslr() || rmaslr::options::display_archs() || watching) {
+            assert_("Cannot write to an output path while checking, printing architectures or watching directories");
+        }
+
+        struct stat sbuf;
+        bool output_is_directory = stat(output_path, &sbuf) == 0 && S_ISDIR(sbuf.st_mode);
+
+        if (recursive) {
+            if (!output_is_directory) {
+                assert_("Output path (%s) must be an existing directory when running recursively", output_path);
             }
 
-            long current_offset = file.position();
-            for (uint32_t i = 0; i < architectures_count; i++) {
-                struct fat_arch_64 arch = file.read<struct fat_arch_64>();
+            //every path given to -r is copied into the output directory under its own name, like cp -R
+            auto output_paths = std::vector<std::string>(batch_paths.size());
+            for (size_t i = 0; i < batch_roots.size(); i++) {
+                std::string root = batch_roots[i].first;
+                while (root.length() > 1 && root.back() == '/') {
+                    root.pop_back();
+                }
 
-                current_offset += sizeof(struct fat_arch_64);
-                long header_offset = static_cast<long>(rmaslr::swap(magic, arch.offset));
+                auto prefix = std::string(output_path) + "/" + find_last_component(root.c_str());
+                size_t end = i + 1 < batch_roots.size() ? batch_roots[i + 1].second : batch_paths.size();
 
-                const NXArchInfo *archInfo = NXGetArchInfoFromCpuType(rmaslr::swap(magic, arch.cputype), rmaslr::swap(magic, arch.cpusubtype));
-                if (!archInfo) {
-                    assert_("Architecture at offset 0x%.16lX is not valid", current_offset);
+                for (size_t index = batch_roots[i].second; index < end; index++) {
+                    output_paths[index] = prefix + batch_paths[index].substr(root.length());
                 }
+            }
 
-                if (rmaslr::options::display_archs()) {
-                    architectures.push_back(archInfo);
+            //targets with the same name would be cloned over each other, leaving one patched copy for both
+            auto unique_paths = std::map<std::string, size_t>();
+            for (size_t index = 0; index < output_paths.size(); index++) {
+                auto inserted = unique_paths.emplace(output_paths[index], index);
+                if (!inserted.second) {
+                    assert_("Files at paths (%s) and (%s) would both be written to path (%s), please give them separate output directories", batch_paths[inserted.first->second].c_str(), batch_paths[index].c_str(), output_paths[index].c_str());
+                }
+            }
 
-                    if (!rmaslr::options::check_aslr()) {
-                        continue;
-                    }
+            std::atomic<size_t> failed(0);
+            rmaslr::parallel_for(batch_paths.size(), batch_options.jobs, [&](size_t index) {
+                if (!rmaslr::clone_file(batch_paths[index], output_paths[index])) {
+                    fprintf(stderr, "\x1B[31mError:\x1B[0m Unable to copy file at path (%s) to path (%s), errno=%d(%s)\n", batch_paths[index].c_str(), output_paths[index].c_str(), errno, strerror(errno));
+                    failed++;
                 }
+            });
 
-                auto it = default_architectures.end();
-                if (default_architectures.size()) {
-                    for (it = default_architectures.begin(); it != default_architectures.end(); it++) {
-                        if (*it != archInfo) {
-                            continue;
-                        }
+            if (failed) {
+                assert_("Unable to copy %ld files to output path (%s)", failed.load(), output_path);
+            }
 
-                        break;
-                    }
+            batch_paths = std::move(output_paths);
+        } else if (binary_path) {
+            auto path = output_is_directory ? std::string(output_path) + "/" + find_last_component(binary_path) : std::string(output_path);
+            if (!rmaslr::clone_file(binary_path, path)) {
+                assert_("Unable to copy file at path (%s) to path (%s), errno=%d(%s)", binary_path, path.c_str(), errno, strerror(errno));
+            }
 
-                    //make sure that the architecture was actually found
-                    if (it == default_architectures.end()) {
-                        continue;
-                    }
-                } else if (default_architectures_original_size != 0) {
-                    //make sure not to remove aslr when default_architectures has a size less than architecture count in file,
-                    //as count would reach 0, and might remove aslr from a non-confirmed architecture
-                    continue;
-                }
+            binary_path = strdup(path.c_str());
+        }
+    }
 
-                //basic validation
-                if (header_offset < current_offset) {
-                    if (rmaslr::options::application()) {
-                        assert_("Application (%s) executable's architecture #%d is placed before its declaration", name, i + 1);
-                    }
+    //only opened when something may be written, journaling is skipped when there is nowhere to keep it
+    rmaslr::journal journal;
+    if (!rmaslr::options::check_aslr() && !rmaslr::options::display_archs() && !journal_path.empty()) {
+        if (!journal.open(journal_path)) {
+            assert_("Unable to open journal at path (%s), errno=%d(%s)", journal_path.c_str(), errno, strerror(errno));
+        }
 
-                    assert_("File (%s) architecture #%d is placed before its declaration", name, i + 1);
-                }
+        batch_options.journal = &journal;
+    }
 
-                if (header_offset > sbuf.st_size) {
-                    if (rmaslr::options::application()) {
-                        assert_("Application (%s) executable's architecture #%d is placed past end of file", name, i + 1);
-                    }
+    if (recursive || watching) {
+        if (rmaslr::options::display_archs()) {
+            assert_("Cannot print architectures while running recursively");
+        }
 
-                    assert_("File (%s) architecture #%d is placed past end of file", name, i + 1);
-                }
+        batch_options.remove_aslr = !rmaslr::options::check_aslr();
+        batch_options.architectures = default_architectures;
 
-                file.seek(header_offset, rmaslr::file::seek_type::origin);
-                struct mach_header header = file.read<struct mach_header>();;
+        //asked once up front, as files are processed concurrently
+        if (batch_options.remove_aslr) {
+            if (prompts_unavailable) {
+                assert_("Unable to ask whether to remove ASLR from 64-bit arm files, the list of files was read from stdin and there is no terminal");
+            }
 
-                headers.emplace(header_offset, header);
-                file.seek(current_offset, rmaslr::file::seek_type::origin);
+            std::string result = rmaslr::request_input<std::string>("Removing ASLR on 64-bit arm files can result in them crashing. Do you want to remove it from 64-bit arm files as well (y/n): ", { "y", "n" });
+            batch_options.allow_arm64 = result == "y";
+        }
+
+        rmaslr::report report(report_format, batch_options);
+        if (watching) {
+            if (!rmaslr::watch(watch_paths, batch_options, report)) {
+                return -1;
             }
         } else {
-            if (architectures_count * sizeof(struct fat_arch) > sbuf.st_size) {
-                if (rmaslr::options::application()) {
-                    assert_("Application (%s)'s executable is too small to contain %d architectures", name, architectures_count);
-                }
+            rmaslr::process_files(batch_paths, batch_options, report);
+        }
+
+        return report.finish() ? 0 : -1;
+    }
+
+    if (!binary_path) {
+        assert_("Unable to get path");
+    }
+
+    //machine-readable -c and -archs write the same records as -r
+    if (report_format != rmaslr::report_format::text && (rmaslr::options::check_aslr() || rmaslr::options::display_archs())) {
+        if (!rmaslr::options::display_archs()) {
+            batch_options.architectures = default_architectures;
+        }
+
+        auto result = rmaslr::process_file(binary_path, batch_options);
+        if (result.status == rmaslr::file_status::skipped) {
+            result.status = rmaslr::file_status::failed;
+            result.error = "is not a valid mach-o";
+        }
 
-                assert_("File (%s) is too small to contain %d architectures", name, architectures_count);
+        rmaslr::report report(report_format, batch_options);
+        report.add(result);
+
+        return report.finish() ? 0 : -1;
+    }
+
+    //only open for writing when ASLR is actually going to be removed
+    bool read_only = rmaslr::options::check_aslr() || rmaslr::options::display_archs();
+
+    auto file = rmaslr::file(binary_path, !read_only);
+    if (!file.is_open()) {
+        error("Unable to open file at path (\"%s\"), errno=%d(%s)", binary_path, file.error_number(), strerror(file.error_number()));
+    }
+
+    auto slices = std::vector<rmaslr::slice>();
+    uint32_t failing_index = 0;
+
+    auto read_timer = rmaslr::stats::timer(rmaslr::stats::stage::read);
+    if (rmaslr::stats::enabled()) {
+        rmaslr::stats::add(rmaslr::stats::counter::files);
+    }
+
+    switch (rmaslr::parse_slices(file, slices, &failing_index)) {
+        case rmaslr::parse_status::ok:
+            break;
+        case rmaslr::parse_status::not_macho:
+            if (rmaslr::options::application()) {
+                assert_("Application (%s)'s executable is not a valid mach-o", name);
             }
 
-            long current_offset = file.position();
-            for (uint32_t i = 0; i < architectures_count; i++) {
-                struct fat_arch arch = file.read<struct fat_arch>();
-                long header_offset = static_cast<long>(rmaslr::swap(magic, arch.offset));
+            assert_("File (%s) is not a valid mach-o", name);
+        case rmaslr::parse_status::no_architectures:
+            if (rmaslr::options::application()) {
+                assert_("Application (%s)'s executable cannot have 0 architectures", name);
+            }
 
-                const NXArchInfo *archInfo = NXGetArchInfoFromCpuType(rmaslr::swap(magic, arch.cputype), rmaslr::swap(magic, arch.cpusubtype));
-                if (!archInfo) {
-                    assert_("Architecture at offset 0x%.8lX is not valid", current_offset);
-                }
+            assert_("File (%s) cannot have 0 architectures", name);
+        case rmaslr::parse_status::too_small: {
+            uint32_t architectures_count = rmaslr::fat_architectures_count(file);
+            if (rmaslr::options::application()) {
+                assert_("Application (%s)'s executable is too small to contain %d architectures", name, architectures_count);
+            }
 
-                current_offset += sizeof(struct fat_arch);
+            assert_("File (%s) is too small to contain %d architectures", name, architectures_count);
+        }
+        case rmaslr::parse_status::placed_before_declaration:
+            if (rmaslr::options::application()) {
+                assert_("Application (%s) executable's architecture #%d is placed before its declaration", name, failing_index + 1);
+            }
 
-                if (rmaslr::options::display_archs()) {
-                    architectures.push_back(archInfo);
+            assert_("File (%s) architecture #%d is placed before its declaration", name, failing_index + 1);
+        case rmaslr::parse_status::placed_past_end:
+            if (rmaslr::options::application()) {
+                assert_("Application (%s) executable's architecture #%d is placed past end of file", name, failing_index + 1);
+            }
 
-                    if (!rmaslr::options::check_aslr()) {
-                        continue;
-                    }
-                }
+            assert_("File (%s) architecture #%d is placed past end of file", name, failing_index + 1);
+    }
 
-                auto it = default_architectures.end();
-                if (default_architectures.size()) {
-                    for (it = default_architectures.begin(); it != default_architectures.end(); it++) {
-                        if (*it != archInfo) {
-                            continue;
-                        }
+    for (auto& slice : slices) {
+        rmaslr::inspect_load_commands(file, slice);
+    }
 
-                        break;
-                    }
+    read_timer.stop();
+    bool is_fat = rmaslr::is_fat_magic(file.magic());
 
-                    //make sure that the architecture was actually found
-                    if (it == default_architectures.end()) {
-                        continue;
-                    }
-                } else if (default_architectures_original_size != 0) {
-                    //make sure not to remove aslr when default_architectures has a size less than architecture count in file,
-                    //as count would reach 0, and might remove aslr from a non-confirmed architecture
-                    continue;
+    //set when a slice was patched whose signature could not be updated in place
+    bool needs_signing = false;
+
+    auto remove_aslr = [&file, &name, &needs_signing, &journal, &binary_path](const rmaslr::slice& slice, const rmaslr::architecture *archInfo = nullptr) {
+        if (!rmaslr::has_aslr(slice)) {
+            if (archInfo) {
+                fprintf(stdout, "Architecture (%s) does not contain ASLR\n", archInfo->name);
+            } else {
+                if (rmaslr::options::application()) {
+                    error("Application (%s) does not contain ASLR", name);
+                } else {
+                    error("File (%s) does not contain ASLR", name);
                 }
+            }
 
-                //basic validation
-                if (header_offset < current_offset) {
-                    if (rmaslr::options::application()) {
-                        assert_("Application (%s) executable's architecture #%d is placed before its declaration", name, i + 1);
-                    }
+            return false;
+        }
 
-                    assert_("File (%s) architecture #%d is placed before its declaration", name, i + 1);
+        //decrypted at launch by the kernel, which refuses to once the binary was modified
+        if (slice.encrypted) {
+            if (archInfo) {
+                fprintf(stdout, "Architecture (%s) is encrypted, it would not run once modified\n", archInfo->name);
+            } else {
+                if (rmaslr::options::application()) {
+                    error("Application (%s) is encrypted, it would not run once modified", name);
+                } else {
+                    error("File (%s) is encrypted, it would not run once modified", name);
                 }
+            }
 
-                if (header_offset > sbuf.st_size) {
-                    if (rmaslr::options::application()) {
-                        assert_("Application (%s) executable's architecture #%d is placed past end of file", name, i + 1);
-                    }
+            return false;
+        }
 
-                    assert_("File (%s) architecture #%d is placed past end of file", name, i + 1);
-                }
+        //ask user if should remove ASLR for arm64
+        if (slice.cputype == CPU_TYPE_ARM64) {
+            std::string question = rmaslr::formatted_string("Removing ASLR on a 64-bit arm %s (%s) can result in it crashing. Are you sure you want to continue (y/n): ", rmaslr::options::application() ? "application" : "file", name);
+            std::string result = rmaslr::request_input<std::string>(question, { "y", "n" });
 
-                file.seek(header_offset, rmaslr::file::seek_type::origin);
-                struct mach_header header = file.read<struct mach_header>();
+            if (result == "n" || result == "N") {
+                return false;
+            }
+        }
 
-                headers.emplace(header_offset, header);
-                file.seek(current_offset, rmaslr::file::seek_type::origin);
+        if (journal.is_open()) {
+            journal.append(binary_path, file.stat(), slice.offset, rmaslr::to_file_order(slice, slice.flags), rmaslr::to_file_order(slice, slice.flags & ~MH_PIE));
+            if (!journal.commit()) {
+                error("Unable to write to journal, errno=%d(%s)", errno, strerror(errno));
             }
         }
-    } else {
-        file.seek(0x0, rmaslr::file::seek_type::origin);
-        struct mach_header header = file.read<struct mach_header>();
 
-        auto it = default_architectures.end();
-        if (default_architectures.size()) {
-            const NXArchInfo *archInfo = NXGetArchInfoFromCpuType(rmaslr::swap(header.magic, header.cputype), rmaslr::swap(header.magic, header.cpusubtype));
+        if (!file.write_flags(slice.offset, rmaslr::to_file_order(slice, slice.flags & ~MH_PIE))) {
+            error("Unable to write to file at offset 0x%.16llX, errno=%d(%s)", static_cast<unsigned long long>(slice.offset), errno, strerror(errno));
+        }
+
+        if (archInfo) {
+            fprintf(stdout, "Removed ASLR for architecture \"%s\"\n", archInfo->name);
+        } else {
+            fprintf(stdout, "Successfully Removed ASLR!\n");
+        }
+
+        auto signature = rmaslr::update_signature(file.descriptor(), slice);
+        switch (signature) {
+            case rmaslr::signature_status::none:
+                needs_signing = true;
+                break;
+            case rmaslr::signature_status::updated:
+                fprintf(stdout, "Updated the ad-hoc code signature\n");
+                break;
+            case rmaslr::signature_status::not_adhoc:
+                needs_signing = true;
+                fprintf(stdout, "The code signature is not ad-hoc, so it could not be updated\n");
+
+                break;
+            case rmaslr::signature_status::unsupported:
+            case rmaslr::signature_status::malformed:
+                needs_signing = true;
+                fprintf(stdout, "The code signature could not be updated, it is malformed or uses an unsupported hash\n");
+
+                break;
+            case rmaslr::signature_status::failed:
+                needs_signing = true;
+                fprintf(stdout, "The code signature could not be updated, errno=%d(%s)\n", errno, strerror(errno));
+
+                break;
+        }
+
+        return true;
+    };
+
+    //what the load commands of slice say about patching it, with open wrapping it in parentheses instead of continuing an open list
+    auto print_triage = [](const rmaslr::slice& slice, bool open) {
+        const char *separator = open ? " (" : ", ";
+        if (slice.encrypted) {
+            fprintf(stdout, "%sencrypted", separator);
+            separator = ", ";
+        }
+
+        if (slice.code_signature) {
+            fprintf(stdout, "%scode signed", separator);
+            separator = ", ";
+        }
+
+        if (!rmaslr::is_executable(slice)) {
+            fprintf(stdout, "%snot an executable", separator);
+            separator = ", ";
+        }
 
-            for (it = default_architectures.begin(); it != default_architectures.end(); it++) {
-                if (*it != archInfo) {
+        if (slice.malformed_commands) {
+            fprintf(stdout, "%smalformed load commands", separator);
+            separator = ", ";
+        }
+
+        if (open && separator[0] == ',') {
+            fprintf(stdout, ")");
+        }
+    };
+
+    auto architectures = std::vector<const rmaslr::architecture *>();
+    auto headers = std::vector<rmaslr::slice>();
+
+    if (is_fat) {
+        headers.reserve(slices.size());
+        architectures.reserve(slices.size());
+
+        for (const auto& slice : slices) {
+            const rmaslr::architecture *archInfo = rmaslr::find_architecture(slice.cputype, slice.cpusubtype);
+            if (!archInfo) {
+                assert_("Architecture at offset 0x%.16llX is not valid", static_cast<unsigned long long>(slice.offset));
+            }
+
+            if (rmaslr::options::display_archs()) {
+                architectures.push_back(archInfo);
+
+                if (!rmaslr::options::check_aslr()) {
                     continue;
                 }
+            }
+
+            if (!default_architectures.empty() && !default_architectures.contains(archInfo)) {
+                continue;
+            }
+
+            headers.push_back(slice);
+        }
+    } else {
+        if (!default_architectures.empty()) {
+            const rmaslr::architecture *archInfo = rmaslr::find_architecture(slices.front().cputype, slices.front().cpusubtype);
 
+            if (default_architectures.contains(archInfo)) {
                 if (rmaslr::options::application()) {
                     notice("Application (%s) does not contain multiple architectures, but the executable is of type \"%s\", so program execution will commence", name, archInfo->name);
                 } else {
                     notice("File (%s) does not contain multiple architectures, but the executable is of type \"%s\", so program execution will commence", name, archInfo->name);
                 }
-
-                break;
-            }
-
-            if (it == default_architectures.end()) {
+            } else {
                 if (rmaslr::options::application()) {
                     notice("Application (%s) does not contain multiple architectures, but you can still specify architecture \"%s\" to remove ASLR from the executable", name, archInfo->name);
                 } else {
@@ -976,7 +1188,7 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
             }
         }
 
-        headers.emplace(0x0, header);
+        headers.push_back(slices.front());
     }
 
     if (rmaslr::options::display_archs()) {
@@ -989,16 +1201,18 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
             }
 
             int i = 0;
-            for (const NXArchInfo *archInfo : architectures) {
+            for (const rmaslr::architecture *archInfo : architectures) {
                 fprintf(stdout, "%s", archInfo->name);
                 if (rmaslr::options::check_aslr()) {
-                    bool aslr = has_aslr(headers[i]);
+                    bool aslr = rmaslr::has_aslr(headers[i]);
                     fprintf(stdout, " (%s", aslr ? "contains ASLR" : "does not contain ASLR");
 
                     if (aslr && archInfo->cputype == CPU_TYPE_ARM64) {
                         fprintf(stdout, ", removing it can cause crashes");
                     }
 
+                    print_triage(headers[i], false);
+
                     i++;
                     fprintf(stdout, ")");
                 }
@@ -1017,14 +1231,9 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
     }
 
     if (rmaslr::options::check_aslr()) {
-        for (const auto& item : headers) {
-            struct mach_header header = item.second;
-
-            uint32_t cputype = rmaslr::swap(header.magic, header.cputype);
-            uint32_t cpusubtype = rmaslr::swap(header.magic, header.cpusubtype);
-
-            const NXArchInfo *archInfo = NXGetArchInfoFromCpuType(cputype, cpusubtype);
-            bool aslr = has_aslr(header);
+        for (const auto& slice : headers) {
+            const rmaslr::architecture *archInfo = rmaslr::find_architecture(slice.cputype, slice.cpusubtype);
+            bool aslr = rmaslr::has_aslr(slice);
 
             if (headers.size() > 1) {
                 fprintf(stdout, "Architecture (%s) %s ASLR", archInfo->name, (aslr ? "contains" : "does not contain"));
@@ -1032,8 +1241,12 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
                 fprintf(stdout, "Application (%s) %s ASLR", name, (aslr ? "contains" : "does not contain"));
             }
 
-            if (aslr && cputype == CPU_TYPE_ARM64) {
-                fprintf(stdout, " (Removing ASLR can cause crashes)");
+            if (aslr && slice.cputype == CPU_TYPE_ARM64) {
+                fprintf(stdout, " (Removing ASLR can cause crashes");
+                print_triage(slice, false);
+                fprintf(stdout, ")");
+            } else {
+                print_triage(slice, true);
             }
 
             fprintf(stdout, "\n");
@@ -1045,32 +1258,24 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
     bool removed_aslr = false;
 
     auto size = headers.size();
-    for (const auto& item : headers) {
-        long offset = item.first;
-        struct mach_header header = item.second;
-
-        uint32_t cputype = rmaslr::swap(header.magic, header.cputype);
-        uint32_t cpusubtype = rmaslr::swap(header.magic, header.cpusubtype);
-
+    for (const auto& slice : headers) {
         bool is_thin = size < 2;
-        const NXArchInfo *archInfo = NXGetArchInfoFromCpuType(cputype, cpusubtype);
+        const rmaslr::architecture *archInfo = rmaslr::find_architecture(slice.cputype, slice.cpusubtype);
 
-        if (is_thin && !default_architectures.size()) { //also displays fat files with less than 2 archs as non-fat
+        if (is_thin && default_architectures.empty()) { //also displays fat files with less than 2 archs as non-fat
             archInfo = nullptr;
         }
 
-        bool removed_aslr_ = remove_aslr(offset, header, archInfo);
+        bool removed_aslr_ = remove_aslr(slice, archInfo);
         if (!removed_aslr && removed_aslr_) {
             removed_aslr = removed_aslr_;
         }
 
-        auto iter = std::find(default_architectures.begin(), default_architectures.end(), archInfo);
-        if (iter != default_architectures.end()) {
-            default_architectures.erase(iter);
+        if (default_architectures.contains(archInfo)) {
+            default_architectures.erase(archInfo);
         }
     }
-
-    if (removed_aslr) {
+    if (removed_aslr && needs_signing) {
         if (rmaslr::options::application()) {
             notice("Application (%s) may not run til you have signed its executable (at path %s) (preferably with ldid)", name, binary_path);
         } else {
@@ -1078,27 +1283,17 @@ int main(int argc, const char * argv[], const char * envp[]) noexcept {
         }
     }
 
-    if (default_architectures.size()) {
-        const NXArchInfo * archInfo = default_architectures.front();
-        char const * architectures = archInfo->name;
-
-        if (default_architectures.size() > 1) {
-            //only create std::string on demand to allow easy appending of string
-
-            //show the first element, and then add comma
-            //then add the rest via for loop, this makes sure
-            //there isn't an extra comma
-            std::string architectures_ = architectures;
-            default_architectures.erase(default_architectures.begin());
-
-            for (const auto& archInfo : default_architectures) {
-                architectures_.append(", ");
-                architectures_.append(archInfo->name);
+    if (!default_architectures.empty()) {
+        //the ones never found, comma separated
+        std::string architectures;
+        default_architectures.for_each([&architectures](const rmaslr::architecture& architecture) {
+            if (!architectures.empty()) {
+                architectures.append(", ");
             }
 
-            architectures = strdup(architectures_.c_str());
-        }
+            architectures.append(architecture.name);
+        });
 
-        assert_("Unable to find & remove ASLR from architecture(s) \"%s\"", architectures);
+        assert_("Unable to find & remove ASLR from architecture(s) \"%s\"", architectures.c_str());
     }
 }
@@ -0,0 +1,474 @@
+#include "plist.h"
+
+static void append_utf8(std::string& string, uint32_t code_point) noexcept {
+    if (code_point < 0x80) {
+        string.append(1, static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        string.append(1, static_cast<char>(0xc0 | (code_point >> 6)));
+        string.append(1, static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else if (code_point < 0x10000) {
+        string.append(1, static_cast<char>(0xe0 | (code_point >> 12)));
+        string.append(1, static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+        string.append(1, static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else {
+        string.append(1, static_cast<char>(0xf0 | (code_point >> 18)));
+        string.append(1, static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+        string.append(1, static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+        string.append(1, static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+}
+
+//walks the elements of an XML property list in place, only as much of XML as plists use is understood
+class xml_reader {
+public:
+    xml_reader(const char *begin, const char *end) noexcept : position_(begin), end_(end) {}
+
+    struct tag {
+        std::string name;
+
+        bool closing = false;      //</name>
+        bool self_closing = false; //<name/>
+    };
+
+    //the next tag, skipping text, the xml declaration, doctype and comments. false at the end or on malformed input
+    bool next_tag(tag& tag) noexcept {
+        for (;;) {
+            position_ = static_cast<const char *>(memchr(position_, '<', static_cast<size_t>(end_ - position_)));
+            if (!position_) {
+                position_ = end_;
+                return false;
+            }
+
+            if (starts_with("<!--")) {
+                if (!skip_past("-->")) {
+                    return false;
+                }
+
+                continue;
+            }
+
+            if (starts_with("<?") || starts_with("<!")) {
+                if (!skip_past(">")) {
+                    return false;
+                }
+
+                continue;
+            }
+
+            break;
+        }
+
+        position_++;
+
+        tag = xml_reader::tag();
+        if (position_ < end_ && *position_ == '/') {
+            tag.closing = true;
+            position_++;
+        }
+
+        const char *name = position_;
+        while (position_ < end_ && !isspace(static_cast<unsigned char>(*position_)) && *position_ != '>' && *position_ != '/') {
+            position_++;
+        }
+
+        tag.name.assign(name, static_cast<size_t>(position_ - name));
+
+        //attributes, such as <plist version="1.0">, are skipped
+        const char *close = static_cast<const char *>(memchr(position_, '>', static_cast<size_t>(end_ - position_)));
+        if (!close) {
+            return false;
+        }
+
+        tag.self_closing = close[-1] == '/';
+        position_ = close + 1;
+
+        return !tag.name.empty();
+    }
+
+    //the text up to the closing tag of name, with entities decoded
+    bool read_text(const char *name, std::string& text) noexcept {
+        const char *begin = position_;
+        auto closing = std::string("</") + name + ">";
+
+        if (!skip_past(closing.c_str())) {
+            return false;
+        }
+
+        const char *end = position_ - closing.length();
+
+        text.clear();
+        for (const char *it = begin; it < end; it++) {
+            //everything up to the next entity is copied at once
+            auto entity_start = static_cast<const char *>(memchr(it, '&', static_cast<size_t>(end - it)));
+            if (!entity_start) {
+                text.append(it, static_cast<size_t>(end - it));
+                break;
+            }
+
+            text.append(it, static_cast<size_t>(entity_start - it));
+            it = entity_start;
+
+            const char *semicolon = static_cast<const char *>(memchr(it, ';', static_cast<size_t>(position_ - it)));
+            if (!semicolon) {
+                return false;
+            }
+
+            auto entity = std::string(it + 1, static_cast<size_t>(semicolon - it - 1));
+            if (entity == "amp") {
+                text.append(1, '&');
+            } else if (entity == "lt") {
+                text.append(1, '<');
+            } else if (entity == "gt") {
+                text.append(1, '>');
+            } else if (entity == "quot") {
+                text.append(1, '"');
+            } else if (entity == "apos") {
+                text.append(1, '\'');
+            } else if (entity.length() > 1 && entity[0] == '#') {
+                bool hex = entity[1] == 'x';
+                append_utf8(text, static_cast<uint32_t>(strtoul(&entity[hex ? 2 : 1], nullptr, hex ? 16 : 10)));
+            } else {
+                return false;
+            }
+
+            it = semicolon;
+        }
+
+        return true;
+    }
+
+    //skips the rest of an element whose opening tag was just read, including any elements nested in it
+    bool skip_element(const tag& opening) noexcept {
+        if (opening.self_closing) {
+            return true;
+        }
+
+        size_t depth = 1;
+
+        tag tag;
+        while (depth && next_tag(tag)) {
+            if (tag.closing) {
+                depth--;
+            } else if (!tag.self_closing) {
+                depth++;
+            }
+        }
+
+        return depth == 0;
+    }
+private:
+    const char *position_;
+    const char *end_;
+
+    inline bool starts_with(const char *prefix) const noexcept {
+        size_t length = strlen(prefix);
+        return static_cast<size_t>(end_ - position_) >= length && memcmp(position_, prefix, length) == 0;
+    }
+
+    //moves past the next occurrence of string
+    bool skip_past(const char *string) noexcept {
+        size_t length = strlen(string);
+        while (static_cast<size_t>(end_ - position_) >= length) {
+            auto first = static_cast<const char *>(memchr(position_, string[0], static_cast<size_t>(end_ - position_) - length + 1));
+            if (!first) {
+                break;
+            }
+
+            position_ = first;
+            if (memcmp(position_, string, length) == 0) {
+                position_ += length;
+                return true;
+            }
+
+            position_++;
+        }
+
+        position_ = end_;
+        return false;
+    }
+};
+
+
+//reads objects of a binary property list (bplist00) in place. every offset and reference is checked against the file
+class bplist_reader {
+public:
+    bplist_reader(const uint8_t *data, uint64_t size) noexcept : data_(data), size_(size) {}
+
+    //reads the trailer, false if data is not a binary property list or its offset table is out of range
+    bool open() noexcept {
+        if (size_ < 8 + 32 || memcmp(data_, "bplist00", 8) != 0) {
+            return false;
+        }
+
+        const uint8_t *trailer = &data_[size_ - 32];
+
+        offset_size_ = trailer[6];
+        reference_size_ = trailer[7];
+
+        objects_count_ = read_integer(&trailer[8], 8);
+        top_object_ = read_integer(&trailer[16], 8);
+        table_offset_ = read_integer(&trailer[24], 8);
+
+        if (!offset_size_ || offset_size_ > 8 || !reference_size_ || reference_size_ > 8) {
+            return false;
+        }
+
+        //the offset table is between the objects and the trailer
+        uint64_t table_end = size_ - 32;
+        if (table_offset_ < 8 || table_offset_ > table_end || objects_count_ > (table_end - table_offset_) / offset_size_) {
+            return false;
+        }
+
+        return top_object_ < objects_count_;
+    }
+
+    inline uint64_t top_object() const noexcept {
+        return top_object_;
+    }
+
+    //the references to the keys and values of the dictionary object, false if it is not one
+    bool dictionary(uint64_t object, uint64_t& count, uint64_t& keys) const noexcept {
+        uint64_t offset = 0;
+        uint8_t marker = 0;
+
+        if (!object_marker(object, offset, marker) || (marker >> 4) != 0xd || !object_length(marker, offset, count)) {
+            return false;
+        }
+
+        //keys, then values
+        if (count > (table_offset_ - offset) / reference_size_ / 2) {
+            return false;
+        }
+
+        keys = offset;
+        return true;
+    }
+
+    //the reference at index of a list of them starting at offset
+    inline uint64_t reference(uint64_t offset, uint64_t index) const noexcept {
+        return read_integer(&data_[offset + index * reference_size_], reference_size_);
+    }
+
+    //object as utf-8, false if it is not a string
+    bool string(uint64_t object, std::string& string) const noexcept {
+        uint64_t offset = 0;
+        uint8_t marker = 0;
+        uint64_t length = 0;
+
+        if (!object_marker(object, offset, marker) || !object_length(marker, offset, length)) {
+            return false;
+        }
+
+        switch (marker >> 4) {
+            case 0x5: //ascii
+                if (length > table_offset_ - offset) {
+                    return false;
+                }
+
+                string.assign(reinterpret_cast<const char *>(&data_[offset]), static_cast<size_t>(length));
+                return true;
+            case 0x6: { //utf-16 big-endian, length is in code units
+                if (length > (table_offset_ - offset) / 2) {
+                    return false;
+                }
+
+                string.clear();
+                for (uint64_t i = 0; i < length; i++) {
+                    uint32_t unit = static_cast<uint32_t>(read_integer(&data_[offset + i * 2], 2));
+                    if (unit >= 0xd800 && unit < 0xdc00 && i + 1 < length) {
+                        uint32_t low = static_cast<uint32_t>(read_integer(&data_[offset + (i + 1) * 2], 2));
+                        if (low >= 0xdc00 && low < 0xe000) {
+                            unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                            i++;
+                        }
+                    }
+
+                    append_utf8(string, unit);
+                }
+
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+private:
+    const uint8_t *data_;
+    uint64_t size_;
+
+    uint8_t offset_size_ = 0;
+    uint8_t reference_size_ = 0;
+
+    uint64_t objects_count_ = 0;
+    uint64_t top_object_ = 0;
+    uint64_t table_offset_ = 0;
+
+    static inline uint64_t read_integer(const uint8_t *data, uint8_t size) noexcept {
+        uint64_t value = 0;
+        for (uint8_t i = 0; i < size; i++) {
+            value = (value << 8) | data[i];
+        }
+
+        return value;
+    }
+
+    //the marker byte of object and the offset just past it
+    bool object_marker(uint64_t object, uint64_t& offset, uint8_t& marker) const noexcept {
+        if (object >= objects_count_) {
+            return false;
+        }
+
+        offset = read_integer(&data_[table_offset_ + object * offset_size_], offset_size_);
+        if (offset < 8 || offset >= table_offset_) {
+            return false;
+        }
+
+        marker = data_[offset++];
+        return true;
+    }
+
+    //the count in marker's low nibble, or when that is 0xf the integer object following it
+    bool object_length(uint8_t marker, uint64_t& offset, uint64_t& length) const noexcept {
+        length = marker & 0xf;
+        if (length != 0xf) {
+            return true;
+        }
+
+        if (offset >= table_offset_ || (data_[offset] >> 4) != 0x1) {
+            return false;
+        }
+
+        auto size = static_cast<uint8_t>(1u << (data_[offset] & 0xf));
+        offset++;
+
+        if (size > 8 || size > table_offset_ - offset) {
+            return false;
+        }
+
+        length = read_integer(&data_[offset], size);
+        offset += size;
+
+        return true;
+    }
+};
+
+//whether key is one of keys and was not seen before
+static bool is_wanted(const std::string& key, const std::vector<const char *>& keys, const std::map<std::string, std::string>& strings) noexcept {
+    for (const char *wanted : keys) {
+        if (key == wanted) {
+            return strings.find(key) == strings.end();
+        }
+    }
+
+    return false;
+}
+
+static bool read_binary_strings(const uint8_t *data, uint64_t size, const std::vector<const char *>& keys, std::map<std::string, std::string>& strings) noexcept {
+    auto reader = bplist_reader(data, size);
+    if (!reader.open()) {
+        return false;
+    }
+
+    uint64_t count = 0;
+    uint64_t references = 0;
+
+    if (!reader.dictionary(reader.top_object(), count, references)) {
+        return false;
+    }
+
+    auto key = std::string();
+    auto value = std::string();
+
+    size_t found = 0;
+    for (uint64_t i = 0; i < count && found < keys.size(); i++) {
+        if (!reader.string(reader.reference(references, i), key) || !is_wanted(key, keys, strings)) {
+            continue;
+        }
+
+        if (reader.string(reader.reference(references, count + i), value)) {
+            strings[key] = value;
+        }
+
+        found++;
+    }
+
+    return true;
+}
+
+static bool read_xml_strings(const char *begin, const char *end, const std::vector<const char *>& keys, std::map<std::string, std::string>& strings) noexcept {
+    auto reader = xml_reader(begin, end);
+
+    xml_reader::tag tag;
+    if (!reader.next_tag(tag) || tag.name != "plist" || tag.closing) {
+        return false;
+    }
+
+    if (!reader.next_tag(tag) || tag.name != "dict" || tag.closing) {
+        return false;
+    }
+
+    if (tag.self_closing) {
+        return true;
+    }
+
+    auto key = std::string();
+    size_t found = 0;
+
+    while (found < keys.size()) {
+        if (!reader.next_tag(tag)) {
+            return false;
+        }
+
+        if (tag.closing) {
+            return tag.name == "dict";
+        }
+
+        if (tag.name != "key" || tag.self_closing || !reader.read_text("key", key)) {
+            return false;
+        }
+
+        if (!reader.next_tag(tag) || tag.closing) {
+            return false;
+        }
+
+        //only the values asked for are decoded
+        bool wanted = is_wanted(key, keys, strings);
+        if (wanted) {
+            found++;
+        }
+
+        if (!wanted || tag.name != "string") {
+            if (!reader.skip_element(tag)) {
+                return false;
+            }
+
+            continue;
+        }
+
+        auto& value = strings[key];
+        if (!tag.self_closing && !reader.read_text("string", value)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool rmaslr::read_plist_strings(const uint8_t *data, uint64_t size, const std::vector<const char *>& keys, std::map<std::string, std::string>& strings) noexcept {
+    auto timer = stats::timer(stats::stage::plist);
+    if (size >= 8 && memcmp(data, "bplist", 6) == 0) {
+        return read_binary_strings(data, size, keys, strings);
+    }
+
+    auto begin = reinterpret_cast<const char *>(data);
+    return read_xml_strings(begin, begin + size, keys, strings);
+}
+
+bool rmaslr::read_plist_strings(const std::string& path, const std::vector<const char *>& keys, std::map<std::string, std::string>& strings) noexcept {
+    auto file = rmaslr::file(path.c_str());
+    if (!file.is_open() || !file.size()) {
+        return false;
+    }
+
+    return read_plist_strings(file.at<uint8_t>(0, file.size()), file.size(), keys, strings);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "rmaslr.h"
+
+namespace rmaslr {
+    //the string values of keys in the top-level dictionary of a property list, XML or binary (bplist00), read in place.
+    //parsing stops as soon as every key was found, keys that are missing or whose value is not a string are left out of strings.
+    //false if data is not a property list whose top-level object is a dictionary
+    bool read_plist_strings(const uint8_t *data, uint64_t size, const std::vector<const char *>& keys, std::map<std::string, std::string>& strings) noexcept;
+
+    //the same, for the file at path, which is mapped rather than read
+    bool read_plist_strings(const std::string& path, const std::vector<const char *>& keys, std::map<std::string, std::string>& strings) noexcept;
+}
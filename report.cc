@@ -0,0 +1,439 @@
+#include <map>
+#include <mutex>
+
+#include "report.h"
+
+#define REPORT_BUFFER_SIZE 0x10000
+
+static const char *architecture_name(cpu_type_t cputype, cpu_subtype_t cpusubtype) noexcept {
+    const rmaslr::architecture *architecture = rmaslr::find_architecture(cputype, cpusubtype);
+    if (!architecture) {
+        return "unknown";
+    }
+
+    return architecture->name;
+}
+
+static const char *action_name(rmaslr::slice_action action) noexcept {
+    switch (action) {
+        case rmaslr::slice_action::none:
+            return "none";
+        case rmaslr::slice_action::removed:
+            return "removed";
+        case rmaslr::slice_action::not_present:
+            return "not_present";
+        case rmaslr::slice_action::declined:
+            return "declined";
+        case rmaslr::slice_action::encrypted:
+            return "encrypted";
+    }
+
+    return "none";
+}
+
+static const char *signature_name(rmaslr::signature_status status) noexcept {
+    switch (status) {
+        case rmaslr::signature_status::none:
+            return "none";
+        case rmaslr::signature_status::updated:
+            return "updated";
+        case rmaslr::signature_status::not_adhoc:
+            return "not_adhoc";
+        case rmaslr::signature_status::unsupported:
+            return "unsupported";
+        case rmaslr::signature_status::malformed:
+            return "malformed";
+        case rmaslr::signature_status::failed:
+            return "failed";
+    }
+
+    return "none";
+}
+
+//what -c found in the load commands of slice, empty for a plain unsigned executable
+static std::string describe_triage(const rmaslr::slice_result& slice) noexcept {
+    auto traits = std::vector<const char *>();
+    if (slice.encrypted) {
+        traits.push_back("encrypted");
+    }
+
+    if (slice.code_signature) {
+        traits.push_back("code signed");
+    }
+
+    if (slice.filetype != MH_EXECUTE) {
+        traits.push_back("not an executable");
+    }
+
+    auto description = std::string();
+    for (size_t i = 0; i < traits.size(); i++) {
+        description.append(i ? ", " : " (");
+        description.append(traits[i]);
+    }
+
+    if (!description.empty()) {
+        description.append(1, ')');
+    }
+
+    return description;
+}
+
+bool rmaslr::parse_report_format(const char *name, report_format& format) noexcept {
+    if (strcmp(name, "text") == 0) {
+        format = report_format::text;
+    } else if (strcmp(name, "ndjson") == 0) {
+        format = report_format::ndjson;
+    } else if (strcmp(name, "csv") == 0) {
+        format = report_format::csv;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+rmaslr::report::report(report_format format, const batch_options& options, int descriptor) noexcept : format_(format), options_(options), descriptor_(descriptor) {
+    buffer_.reserve(REPORT_BUFFER_SIZE * 2);
+    if (format_ == report_format::csv) {
+        buffer_.append("path,arch,cputype,cpusubtype,offset,pie,filetype,encrypted,signed,action,signature,duplicate_of,error\n");
+    }
+}
+
+rmaslr::report::~report() noexcept {
+    flush();
+}
+
+void rmaslr::report::flush() noexcept {
+    const char *data = buffer_.data();
+    size_t size = buffer_.size();
+
+    while (size) {
+        ssize_t written = write(descriptor_, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            //reader went away, nothing more can be written
+            break;
+        }
+
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    buffer_.clear();
+}
+
+void rmaslr::report::append_string(const std::string& string) noexcept {
+    if (format_ == report_format::csv) {
+        if (string.find_first_of(",\"\r\n") == std::string::npos) {
+            buffer_.append(string);
+            return;
+        }
+
+        buffer_.append(1, '"');
+        for (char character : string) {
+            if (character == '"') {
+                buffer_.append(1, '"');
+            }
+
+            buffer_.append(1, character);
+        }
+
+        buffer_.append(1, '"');
+        return;
+    }
+
+    buffer_.append(1, '"');
+    for (char character : string) {
+        switch (character) {
+            case '"':
+                buffer_.append("\\\"");
+                break;
+            case '\\':
+                buffer_.append("\\\\");
+                break;
+            case '\n':
+                buffer_.append("\\n");
+                break;
+            case '\r':
+                buffer_.append("\\r");
+                break;
+            case '\t':
+                buffer_.append("\\t");
+                break;
+            default:
+                if (static_cast<unsigned char>(character) < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%.4x", static_cast<unsigned char>(character));
+
+                    buffer_.append(escaped);
+                } else {
+                    buffer_.append(1, character);
+                }
+
+                break;
+        }
+    }
+
+    buffer_.append(1, '"');
+}
+
+void rmaslr::report::append_number(uint64_t number) noexcept {
+    char string[21];
+    snprintf(string, sizeof(string), "%llu", static_cast<unsigned long long>(number));
+
+    buffer_.append(string);
+}
+
+void rmaslr::report::add_record(const file_result& result, const slice_result *slice) noexcept {
+    if (format_ == report_format::csv) {
+        append_string(result.path);
+        if (slice) {
+            buffer_.append(1, ',');
+            append_string(architecture_name(slice->cputype, slice->cpusubtype));
+            buffer_.append(1, ',');
+            append_number(static_cast<uint32_t>(slice->cputype));
+            buffer_.append(1, ',');
+            append_number(static_cast<uint32_t>(slice->cpusubtype));
+            buffer_.append(1, ',');
+            append_number(slice->offset);
+            buffer_.append(1, ',');
+            buffer_.append(slice->flags & MH_PIE ? "true" : "false");
+            buffer_.append(1, ',');
+            append_number(slice->filetype);
+            buffer_.append(1, ',');
+            buffer_.append(slice->encrypted ? "true" : "false");
+            buffer_.append(1, ',');
+            buffer_.append(slice->code_signature ? "true" : "false");
+            buffer_.append(1, ',');
+            buffer_.append(action_name(slice->action));
+            buffer_.append(1, ',');
+            buffer_.append(signature_name(slice->signature));
+            buffer_.append(1, ',');
+            append_string(result.duplicate_of);
+            buffer_.append(",\n");
+        } else {
+            buffer_.append(",,,,,,,,,,,");
+            append_string(result.duplicate_of);
+            buffer_.append(1, ',');
+            append_string(result.error);
+            buffer_.append(1, '\n');
+        }
+
+        return;
+    }
+
+    buffer_.append("{\"path\":");
+    append_string(result.path);
+
+    if (!result.duplicate_of.empty()) {
+        buffer_.append(",\"duplicate_of\":");
+        append_string(result.duplicate_of);
+    }
+
+    if (slice) {
+        buffer_.append(",\"arch\":");
+        append_string(architecture_name(slice->cputype, slice->cpusubtype));
+        buffer_.append(",\"cputype\":");
+        append_number(static_cast<uint32_t>(slice->cputype));
+        buffer_.append(",\"cpusubtype\":");
+        append_number(static_cast<uint32_t>(slice->cpusubtype));
+        buffer_.append(",\"offset\":");
+        append_number(slice->offset);
+        buffer_.append(",\"pie\":");
+        buffer_.append(slice->flags & MH_PIE ? "true" : "false");
+        buffer_.append(",\"filetype\":");
+        append_number(slice->filetype);
+        buffer_.append(",\"encrypted\":");
+        buffer_.append(slice->encrypted ? "true" : "false");
+        buffer_.append(",\"signed\":");
+        buffer_.append(slice->code_signature ? "true" : "false");
+        buffer_.append(",\"action\":\"");
+        buffer_.append(action_name(slice->action));
+        buffer_.append("\",\"signature\":\"");
+        buffer_.append(signature_name(slice->signature));
+        buffer_.append("\"}\n");
+    } else {
+        buffer_.append(",\"error\":");
+        append_string(result.error);
+        buffer_.append("}\n");
+    }
+}
+
+void rmaslr::report::add_text(const file_result& result) noexcept {
+    if (result.status == file_status::failed) {
+        //kept in order with the lines before it
+        flush();
+        fprintf(stderr, "\x1B[31mError:\x1B[0m File (%s) %s\n", result.path.c_str(), result.error.c_str());
+
+        return;
+    }
+
+    bool is_thin = result.slices.size() < 2;
+    for (const auto& slice : result.slices) {
+        bool aslr = (slice.flags & MH_PIE) > 0;
+
+        const char *name = architecture_name(slice.cputype, slice.cpusubtype);
+        switch (slice.action) {
+            case slice_action::none:
+                if (is_thin) {
+                    buffer_.append(formatted_string("File (%s) %s ASLR%s\n", result.path.c_str(), aslr ? "contains" : "does not contain", describe_triage(slice).c_str()).c_str());
+                } else {
+                    buffer_.append(formatted_string("File (%s) architecture (%s) %s ASLR%s\n", result.path.c_str(), name, aslr ? "contains" : "does not contain", describe_triage(slice).c_str()).c_str());
+                }
+
+                break;
+            case slice_action::removed: {
+                const char *signature = "";
+                if (slice.signature == signature_status::updated) {
+                    signature = ", updated its ad-hoc signature";
+                } else if (slice.code_signature) {
+                    signature = ", its code signature is no longer valid";
+                }
+
+                if (is_thin) {
+                    buffer_.append(formatted_string("Removed ASLR from file (%s)%s\n", result.path.c_str(), signature).c_str());
+                } else {
+                    buffer_.append(formatted_string("Removed ASLR from file (%s) architecture (%s)%s\n", result.path.c_str(), name, signature).c_str());
+                }
+
+                break;
+            }
+            case slice_action::not_present:
+                break;
+            case slice_action::declined:
+                buffer_.append(formatted_string("Skipped file (%s) architecture (%s), removal of ASLR on 64-bit arm was not confirmed\n", result.path.c_str(), name).c_str());
+                break;
+            case slice_action::encrypted:
+                buffer_.append(formatted_string("Skipped file (%s) architecture (%s), it is encrypted and would not run once modified\n", result.path.c_str(), name).c_str());
+                break;
+        }
+    }
+}
+
+void rmaslr::report::add(const file_result& result) noexcept {
+    files_++;
+    if (!result.duplicate_of.empty()) {
+        duplicates_++;
+        reclaimed_ += result.reclaimed;
+    }
+
+    if (result.status == file_status::skipped) {
+        skipped_++;
+        return;
+    }
+
+    if (result.status == file_status::failed) {
+        failed_++;
+    } else {
+        bool contains_aslr = false;
+        bool removed_aslr = false;
+        bool needs_signing = false;
+
+        for (const auto& slice : result.slices) {
+            if (slice.flags & MH_PIE) {
+                contains_aslr = true;
+            }
+
+            if (slice.action == slice_action::removed) {
+                removed_aslr = true;
+                needs_signing |= slice.signature != signature_status::updated;
+            }
+        }
+
+        if (needs_signing) {
+            needs_signing_++;
+        }
+
+        if (contains_aslr) {
+            contain_aslr_++;
+        }
+
+        if (removed_aslr) {
+            removed_aslr_++;
+        }
+    }
+
+    if (format_ == report_format::text) {
+        add_text(result);
+    } else if (result.status == file_status::failed) {
+        add_record(result, nullptr);
+    } else {
+        for (const auto& slice : result.slices) {
+            add_record(result, &slice);
+        }
+    }
+
+    if (buffer_.size() >= REPORT_BUFFER_SIZE) {
+        flush();
+    }
+}
+
+bool rmaslr::report::finish() noexcept {
+    if (format_ != report_format::text) {
+        flush();
+        return failed_ == 0;
+    }
+
+    size_t macho_files = files_ - skipped_ - failed_;
+    if (options_.remove_aslr) {
+        buffer_.append(formatted_string("Processed %ld files (%ld not mach-o, %ld failed): removed ASLR from %ld, %ld did not contain ASLR\n", files_, skipped_, failed_, removed_aslr_, macho_files - contain_aslr_).c_str());
+    } else {
+        buffer_.append(formatted_string("Processed %ld files (%ld not mach-o, %ld failed): %ld contain ASLR, %ld do not contain ASLR\n", files_, skipped_, failed_, contain_aslr_, macho_files - contain_aslr_).c_str());
+    }
+
+    if (duplicates_) {
+        if (reclaimed_) {
+            buffer_.append(formatted_string("%ld files were duplicates and were not parsed again, %llu bytes freed by replacing copies with hard links\n", duplicates_, static_cast<unsigned long long>(reclaimed_)).c_str());
+        } else {
+            buffer_.append(formatted_string("%ld files were duplicates and were not parsed again\n", duplicates_).c_str());
+        }
+    }
+
+    flush();
+    if (needs_signing_) {
+        notice("%ld files may not run til you have signed them (preferably with ldid)", needs_signing_);
+    }
+
+    return failed_ == 0;
+}
+
+void rmaslr::process_files(const std::vector<std::string>& paths, const batch_options& options, report& report) {
+    std::mutex mutex;
+
+    //results that finished before one at a lower index, usually only a few
+    auto pending = std::map<size_t, file_result>();
+
+    //paths are handed over a window at a time, so a slow file holds back at most a window of results. a multiple of the journal's
+    //groups of 256, and large enough that waiting on the slowest file of a window is rare. dedup needs every path at once
+    unsigned int jobs = options.jobs ? options.jobs : std::max(std::thread::hardware_concurrency(), 1u);
+
+    size_t window = options.io_uring ? std::max(options.queue_depth, 1u) * static_cast<size_t>(16) : jobs * static_cast<size_t>(256);
+    if (options.dedup != dedup_policy::none) {
+        window = paths.size();
+    }
+
+    auto window_paths = std::vector<std::string>();
+    for (size_t first = 0; first < paths.size(); first += window) {
+        window_paths.assign(paths.begin() + first, paths.begin() + std::min(paths.size(), first + window));
+        size_t next = 0;
+
+        process_files(window_paths, options, [&](size_t index, file_result&& result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (index != next) {
+                pending.emplace(index, std::move(result));
+                return;
+            }
+
+            report.add(result);
+            next++;
+
+            for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it)) {
+                report.add(it->second);
+                next++;
+            }
+        });
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "batch.h"
+
+namespace rmaslr {
+    enum class report_format {
+        text,
+        ndjson,
+        csv
+    };
+
+    //returns false if name is not text, ndjson or csv
+    bool parse_report_format(const char *name, report_format& format) noexcept;
+
+    //writes results as they are added, buffering output and writing it out every 64 KiB so memory use stays constant.
+    //text is the human-readable output of -r. ndjson and csv write one record per slice
+    //(path, arch, cputype, cpusubtype, offset, pie, filetype, encrypted, signed, action, signature, duplicate_of), and a record with only path, duplicate_of and error for files that failed
+    class report {
+    public:
+        report(report_format format, const batch_options& options, int descriptor = STDOUT_FILENO) noexcept;
+
+        report(const report&) = delete;
+        report& operator=(const report&) = delete;
+
+        ~report() noexcept;
+
+        void add(const file_result& result) noexcept;
+
+        //writes out everything buffered so far
+        void flush() noexcept;
+
+        //flushes, and for text prints the summary. returns false if any file failed
+        bool finish() noexcept;
+    private:
+        report_format format_;
+        const batch_options& options_;
+
+        int descriptor_;
+        std::string buffer_;
+
+        size_t files_ = 0;
+        size_t skipped_ = 0;
+        size_t failed_ = 0;
+
+        size_t contain_aslr_ = 0;
+        size_t removed_aslr_ = 0;
+        size_t needs_signing_ = 0; //removed ASLR from, without a signature that could be updated
+
+        size_t duplicates_ = 0;
+        uint64_t reclaimed_ = 0;
+
+        void add_text(const file_result& result) noexcept;
+        void add_record(const file_result& result, const slice_result *slice) noexcept;
+
+        void append_string(const std::string& string) noexcept;
+        void append_number(uint64_t number) noexcept;
+    };
+
+    //processes paths like process_files, adding every result to report in the order of paths as soon as all before it are done.
+    //paths are handed to process_files in windows of 256 files per job (16 per io_uring queue entry), to bound the results held back
+    void process_files(const std::vector<std::string>& paths, const batch_options& options, report& report);
+}
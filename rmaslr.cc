@@ -1,16 +1,8 @@
-#include "rmaslr.h"
-
-bool std::is_in_map(const std::vector<std::map<const char *, std::string>>& vector, const std::string& value) noexcept {
-    for (const auto& item : vector) {
-        for (const auto& item_ : item) {
-            if (item_.second == value) {
-                return true;
-            }
-        }
-    }
+#include <dirent.h>
+#include <dlfcn.h>
 
-    return false;
-}
+#include "plist.h"
+#include "rmaslr.h"
 
 std::string std::find_last_component(const std::string& string) noexcept {
     auto pos = string.find_last_of('/');
@@ -44,69 +36,37 @@ bool std::case_compare(const std::string& first, const std::string& second) noex
     return first_size < second_size;
 }
 
-std::string rmaslr::platform::get_platform() noexcept {
+const std::string& rmaslr::platform::get_platform() noexcept {
     static std::string platform = load_from_filesystem();
     return platform;
 }
 
 std::string rmaslr::platform::load_from_filesystem() noexcept {
+    auto timer = stats::timer(stats::stage::platform);
     const char *path = "/System/Library/CoreServices/SystemVersion.plist";
+
     if (access(path, F_OK) != 0) {
+#ifdef __APPLE__
         error("platform::load_from_filesystem(); File does not exists at path (\"%s\"), possibly corrupted or not unix/linux system", path);
+#else
+        //neither macosx nor iphoneos
+        return std::string();
+#endif
     }
 
-    CFStringRef pathString = CFStringCreateWithCString(kCFAllocatorDefault, path, kCFStringEncodingUTF8);
-    if (!pathString) {
-        error("platform::load_from_filesystem(); Unable to allocate CFStringRef, errno=%d(%s)", errno, strerror(errno));
-    }
-
-    CFURLRef pathURL = CFURLCreateWithFileSystemPath(kCFAllocatorDefault, pathString, kCFURLPOSIXPathStyle, false);
-    if (!pathURL) {
-        error("platform::load_from_filesystem(); Unable to allocate CFURLRef, errno=%d(%s)", errno, strerror(errno));
-    }
-
-    CFReadStreamRef pathStream = CFReadStreamCreateWithFile(kCFAllocatorDefault, pathURL);
-    if (!pathStream) {
-        error("platform::load_from_filesystem(); Unable to create CFReadStream from file (\"%s\"), errno=%d(%s)", path, errno, strerror(errno));
-    }
-
-    CFReadStreamOpen(pathStream);
-
-    CFErrorRef pathError = nullptr;
-    CFDictionaryRef pathPlist = (CFDictionaryRef)CFPropertyListCreateWithStream(kCFAllocatorDefault, pathStream, 0, kCFPropertyListImmutable, nullptr, &pathError);
-
-    if (pathError) {
-        const char *error_string = CFStringGetCStringPtr(CFErrorCopyDescription(pathError), kCFStringEncodingUTF8);
-        error("platform::load_from_filesystem(); Failed to open property list at path (\"%s\"), with error: \"%s\"", path, error_string);
-    }
-
-    if (!pathPlist) {
-        error("platform::load_from_filesystem(); Failed to open property list at path (\"%s\"), errno=%d(%s)", path, errno, strerror(errno));
-    }
-
-    if (CFGetTypeID(pathPlist) != CFDictionaryGetTypeID()) {
-        error("platform::load_from_filesystem(); Property list at path (\"%s\") is not a dictionary", path);
-    }
+    static const auto keys = std::vector<const char *>({ "ProductName" });
 
-    CFStringRef operatingSystemKey = CFStringCreateWithCString(kCFAllocatorDefault, "ProductName", kCFStringEncodingUTF8);
-    if (!operatingSystemKey) {
-        error("platform::load_from_filesystem(); Unable to allocate buffer for storing key (\"PlatformName\"), errno=%d(%s)", errno, strerror(errno));
+    auto strings = std::map<std::string, std::string>();
+    if (!read_plist_strings(path, keys, strings)) {
+        error("platform::load_from_filesystem(); Failed to open property list at path (\"%s\")", path);
     }
 
-    if (!CFDictionaryContainsKey(pathPlist, operatingSystemKey)) {
-        error("platform::load_from_filesystem(); Unable to find key (\"ProductName\") in dictionary", errno, strerror(errno));
+    auto platform = strings.find("ProductName");
+    if (platform == strings.end()) {
+        error("platform::load_from_filesystem(); Unable to find key (\"ProductName\") in dictionary");
     }
 
-    CFStringRef platform = (CFStringRef)CFDictionaryGetValue(pathPlist, operatingSystemKey);
-    if (!platform) {
-        error("platform::load_from_filesystem(); Unable to get value for key (\"PlatformName\")", errno, strerror(errno));
-    }
-
-    if (CFGetTypeID(platform) != CFStringGetTypeID()) {
-        error("platform::load_from_filesystem(); Platform from path (\"%s\") is not a string", path);
-    }
-
-    return CFStringGetCStringPtr(platform, kCFStringEncodingUTF8);
+    return platform->second;
 }
 
 size_t rmaslr::get_size(size_t size) noexcept {
@@ -124,25 +84,6 @@ size_t rmaslr::get_size(size_t size) noexcept {
     return length;
 }
 
-uint32_t rmaslr::swap(uint32_t magic, uint32_t value) noexcept {
-    if (magic == MH_CIGAM || magic == MH_CIGAM_64 || magic == FAT_CIGAM || magic == FAT_CIGAM_64) {
-        value = ((value >> 8) & 0x00ff00ff) | ((value << 8) & 0xff00ff00);
-        value = ((value >> 16) & 0x0000ffff) | ((value << 16) & 0xffff0000);
-    }
-
-    return value;
-}
-
-uint64_t rmaslr::swap(uint32_t magic, uint64_t value) noexcept {
-    if (magic == MH_CIGAM || magic == MH_CIGAM_64 || magic == FAT_CIGAM || magic == FAT_CIGAM_64) {
-        value = (value & 0x00000000ffffffff) << 32 | (value & 0xffffffff00000000) >> 32;
-        value = (value & 0x0000ffff0000ffff) << 16 | (value & 0xffff0000ffff0000) >> 16;
-        value = (value & 0x00ff00ff00ff0ff) << 8  | (value & 0xff00ff00ff00ff00) >> 8;
-    }
-
-    return value;
-}
-
 std::string rmaslr::formatted_string(const char *string, ...) noexcept {
     va_list list;
 
@@ -153,160 +94,506 @@ std::string rmaslr::formatted_string(const char *string, ...) noexcept {
     std::string formatted(size + 1, '\0'); //+ 1 for null-byte
 
     va_start(list, string);
-    vsprintf(const_cast<char *>(formatted.data()), string, list);
+    vsprintf(&formatted[0], string, list);
     va_end(list);
 
+    formatted.resize(size);
     return formatted;
 }
 
-std::map<const char *, std::string> rmaslr::parse_application_container(const std::string &path) noexcept {
+bool rmaslr::parse_application_container(const std::string &path, rmaslr::application& information) noexcept {
+    auto span = trace::span("parse_application_container", path.c_str());
     std::string name = std::find_last_component(path);
 
-    auto information = std::map<const char *, std::string>();
     auto pos = name.find(".app");
 
     if (pos == std::string::npos) {
-        return information;
+        return false;
     }
 
     if (pos == 0 || pos != (name.length() - (sizeof(".app") - 1))) {
-        return information;
+        return false;
     }
 
     std::string infoPath = path + "/Contents/Info.plist";
-    if (access(infoPath.c_str(), F_OK) != 0) {
-        return information;
+    static const auto keys = std::vector<const char *>({ "CFBundleExecutable", "CFBundleName", "CFBundleIdentifier" });
+
+    auto strings = std::map<std::string, std::string>();
+    if (!read_plist_strings(infoPath, keys, strings)) {
+        return false;
     }
 
-    CFStringRef pathString = CFStringCreateWithCString(kCFAllocatorDefault, infoPath.c_str(), kCFStringEncodingUTF8);
-    if (!pathString) {
-        return information;
+    information = application();
+    information.container_name = name.substr(0, pos);
+
+    auto executable_name = strings.find("CFBundleExecutable");
+    if (executable_name != strings.end()) {
+        information.executable_name = executable_name->second;
+        information.executable_path = path + "/Contents/MacOS/" + executable_name->second;
     }
 
-    CFURLRef pathURL = CFURLCreateWithFileSystemPath(kCFAllocatorDefault, pathString, kCFURLPOSIXPathStyle, false);
-    if (!pathString) {
-        return information;
+    auto display_name = strings.find("CFBundleName");
+    if (display_name != strings.end()) {
+        information.display_name = display_name->second;
     }
 
-    CFReadStreamRef pathStream = CFReadStreamCreateWithFile(kCFAllocatorDefault, pathURL);
-    if (!pathStream) {
-        return information;
+    auto bundle_identifier = strings.find("CFBundleIdentifier");
+    if (bundle_identifier != strings.end()) {
+        information.bundle_identifier = bundle_identifier->second;
     }
 
-    CFReadStreamOpen(pathStream);
+    return true;
+}
 
-    CFErrorRef pathError = nullptr;
-    CFPropertyListRef pathPlist = CFPropertyListCreateWithStream(kCFAllocatorDefault, pathStream, 0, kCFPropertyListImmutable, nullptr, &pathError);
+std::vector<std::string> rmaslr::find_application_containers(const std::string& directory) noexcept {
+    auto span = trace::span("enumerate_applications", directory.c_str());
+    auto paths = std::vector<std::string>();
 
-    if (pathError) {
-        return information;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        return paths;
     }
 
-    if (!pathPlist) {
-        return information;
+    std::string prefix = directory;
+    if (prefix.back() != '/') {
+        prefix.append(1, '/');
     }
 
-    if (CFGetTypeID(pathPlist) != CFDictionaryGetTypeID()) {
-        return information;
+    struct dirent *dir_entry = nullptr;
+    while ((dir_entry = readdir(dir))) {
+        //cheap check before handing the entry to a worker, parse_application_container() validates the rest
+        size_t length = strlen(dir_entry->d_name);
+        if (length <= sizeof(".app") - 1 || strcmp(&dir_entry->d_name[length - (sizeof(".app") - 1)], ".app") != 0) {
+            continue;
+        }
+
+        paths.push_back(prefix + dir_entry->d_name);
     }
 
-    information = {
-        { "bundleIdentifier", "" },
-        { "containerName", name.substr(0, pos) },
-        { "displayName", "" },
-        { "executableName", "" },
-        { "executablePath", ""}
-    };
+    closedir(dir);
+    return paths;
+}
 
-    CFStringRef applicationKey = CFStringCreateWithCString(kCFAllocatorDefault, "CFBundleName", kCFStringEncodingUTF8);
-    CFStringRef identifierKey = CFStringCreateWithCString(kCFAllocatorDefault, "CFBundleIdentifier", kCFStringEncodingUTF8);
-    CFStringRef executableKey = CFStringCreateWithCString(kCFAllocatorDefault, "CFBundleExecutable", kCFStringEncodingUTF8);
+rmaslr::application_list rmaslr::parse_application_containers(const std::string& directory, unsigned int jobs) noexcept {
+    auto paths = find_application_containers(directory);
 
-    CFDictionaryRef info = (CFDictionaryRef)pathPlist;
-    if (CFDictionaryContainsKey(info, executableKey)) {
-        CFStringRef executableName = (CFStringRef)CFDictionaryGetValue(info, executableKey);
-        if (executableName) {
-            if (CFGetTypeID(executableName) == CFStringGetTypeID()) {
-                const char *executable_name = CFStringGetCStringPtr(executableName, kCFStringEncodingUTF8);
-                information["executableName"] = executable_name;
+    auto results = std::vector<application>(paths.size());
+    auto parsed = std::vector<char>(paths.size(), false);
 
-                std::string executablePath = path + "/Contents/MacOS/";
-                executablePath += executable_name;
+    parallel_for(paths.size(), jobs, [&](size_t index) {
+        parsed[index] = parse_application_container(paths[index], results[index]);
+    });
 
-                information["executablePath"] = executablePath;
-            }
+    auto applications = application_list();
+    for (size_t i = 0; i < results.size(); i++) {
+        if (!parsed[i]) {
+            continue;
         }
+
+        applications.add(results[i]);
+    }
+
+    return applications;
+}
+
+rmaslr::springboard::load_status rmaslr::springboard::load() noexcept {
+    auto timer = stats::timer(stats::stage::springboard);
+#ifndef __APPLE__
+    return load_status::missing_framework;
+#else
+    static void *handle = nullptr;
+    if (handle) {
+        return load_status::ok;
+    }
+
+    //only the three functions below are used, the rest of the framework is bound as it's called
+    void *handle_ = dlopen("/System/Library/PrivateFrameworks/SpringBoardServices.framework/SpringBoardServices", RTLD_LAZY);
+    if (!handle_) {
+        return load_status::missing_framework;
+    }
+
+    SBSCopyApplicationDisplayIdentifiers = (CFArrayRef(*)(bool, bool))dlsym(handle_, "SBSCopyApplicationDisplayIdentifiers");
+    SBSCopyLocalizedApplicationNameForDisplayIdentifier = (CFStringRef (*)(CFStringRef))dlsym(handle_, "SBSCopyLocalizedApplicationNameForDisplayIdentifier");
+    SBSCopyExecutablePathForDisplayIdentifier = (CFStringRef (*)(CFStringRef))dlsym(handle_, "SBSCopyExecutablePathForDisplayIdentifier");
+
+    if (!SBSCopyApplicationDisplayIdentifiers || !SBSCopyLocalizedApplicationNameForDisplayIdentifier || !SBSCopyExecutablePathForDisplayIdentifier) {
+        return load_status::missing_functions;
     }
 
-    if (CFDictionaryContainsKey(info, applicationKey)) {
-        CFStringRef applicationName = (CFStringRef)CFDictionaryGetValue(info, applicationKey);
-        if (applicationName) {
-            if (CFGetTypeID(applicationName) == CFStringGetTypeID()) {
-                information["displayName"] = CFStringGetCStringPtr(applicationName, kCFStringEncodingUTF8);
+    handle = handle_;
+    return load_status::ok;
+#endif
+}
+
+rmaslr::file::file(const char *path, bool writable) noexcept : descriptor_(open(path, writable ? O_RDWR : O_RDONLY)) {
+    auto timer = stats::timer(stats::stage::open);
+    stats::add_syscalls(1);
+
+    if (descriptor_ < 0) {
+        error_number_ = errno;
+        return;
+    }
+
+    stats::add_syscalls(1);
+    if (fstat(descriptor_, &sbuf_) != 0) {
+        error_number_ = errno;
+
+        close(descriptor_);
+        descriptor_ = -1;
+
+        return;
+    }
+
+    size_ = static_cast<uint64_t>(sbuf_.st_size);
+    if (!size_) {
+        return;
+    }
+
+    //pages are only faulted in as headers are touched, so mapping the whole file costs nothing extra
+    void *map = mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor_, 0);
+    stats::add_syscalls(1);
+
+    if (map == MAP_FAILED) {
+        error_number_ = errno;
+
+        close(descriptor_);
+        descriptor_ = -1;
+
+        size_ = 0;
+        return;
+    }
+
+    map_ = static_cast<const uint8_t *>(map);
+    if (stats::enabled()) {
+        stats::add(stats::counter::bytes_mapped, size_);
+    }
+}
+
+rmaslr::file::file(rmaslr::file&& other) noexcept : descriptor_(other.descriptor_), error_number_(other.error_number_), map_(other.map_), size_(other.size_), borrowed_(other.borrowed_), sbuf_(other.sbuf_) {
+    other.descriptor_ = -1;
+    other.map_ = nullptr;
+    other.size_ = 0;
+}
+
+rmaslr::file::file(const uint8_t *data, uint64_t size) noexcept : map_(data), size_(size), borrowed_(true) {
+    sbuf_.st_size = static_cast<off_t>(size);
+}
+
+rmaslr::file::~file() noexcept {
+    if (map_ && !borrowed_) {
+        munmap(const_cast<uint8_t *>(map_), size_);
+        stats::add_syscalls(1);
+    }
+
+    if (descriptor_ >= 0) {
+        close(descriptor_);
+        stats::add_syscalls(1);
+    }
+}
+
+bool rmaslr::file::make_writable(const char *path) noexcept {
+    auto timer = stats::timer(stats::stage::open);
+    stats::add_syscalls(3); //open, fstat and close
+
+    int descriptor = open(path, O_RDWR);
+    if (descriptor < 0) {
+        error_number_ = errno;
+        return false;
+    }
+
+    struct stat sbuf;
+    if (fstat(descriptor, &sbuf) != 0) {
+        error_number_ = errno;
+        close(descriptor);
+
+        return false;
+    }
+
+    if (sbuf.st_dev != sbuf_.st_dev || sbuf.st_ino != sbuf_.st_ino) {
+        error_number_ = ESTALE;
+        close(descriptor);
+
+        return false;
+    }
+
+    close(descriptor_);
+    descriptor_ = descriptor;
+
+    return true;
+}
+
+bool rmaslr::file::write_flags(uint64_t offset, uint32_t flags) const noexcept {
+    if (!header(offset)) {
+        return false;
+    }
+
+    auto span = trace::span("write_flags");
+    auto timer = stats::timer(stats::stage::write);
+    if (stats::enabled()) {
+        stats::add(stats::counter::syscalls);
+        stats::add(stats::counter::bytes_written, sizeof(flags));
+    }
+
+    off_t position = static_cast<off_t>(offset + offsetof(struct mach_header, flags));
+    return pwrite(descriptor_, &flags, sizeof(flags), position) == sizeof(flags);
+}
+
+template <bool swapped>
+static inline void decode_header(rmaslr::slice& slice, bool set_architecture) noexcept {
+    auto view = rmaslr::header_view<swapped>(slice.header);
+    if (set_architecture) {
+        slice.cputype = view.cputype();
+        slice.cpusubtype = view.cpusubtype();
+    }
+
+    slice.filetype = view.filetype();
+    slice.flags = view.flags();
+    slice.swapped = swapped;
+}
+
+void rmaslr::decode_header(slice& slice, bool set_architecture) noexcept {
+    if (is_swapped_magic(slice.header->magic)) {
+        ::decode_header<true>(slice, set_architecture);
+    } else {
+        ::decode_header<false>(slice, set_architecture);
+    }
+}
+
+template <bool swapped>
+static void inspect_load_commands(rmaslr::slice& slice, uint64_t available) noexcept {
+    auto view = rmaslr::header_view<swapped>(slice.header);
+    uint64_t header_size = rmaslr::header_size(slice.header);
+
+    if (available < header_size) {
+        slice.malformed_commands = true;
+        return;
+    }
+
+    //a sizeofcmds past the end of the file is caught by the iterator as soon as a command reaches past it
+    auto commands = reinterpret_cast<const uint8_t *>(slice.header) + header_size;
+    auto iterator = rmaslr::load_command_iterator<swapped>(commands, std::min<uint64_t>(view.sizeofcmds(), available - header_size), view.ncmds());
+
+    bool found_encryption = false;
+    bool found_signature = false;
+
+    while (!found_encryption || !found_signature) {
+        auto command = iterator.next();
+        if (!command) {
+            break;
+        }
+
+        switch (iterator.cmd(command)) {
+            case LC_ENCRYPTION_INFO:
+            case LC_ENCRYPTION_INFO_64: {
+                //cryptid is at the same offset in encryption_info_command_64
+                auto info = iterator.template as<struct encryption_info_command>(command);
+                if (info) {
+                    slice.encrypted = rmaslr::byte_order<swapped>::get(info->cryptid) != 0;
+                }
+
+                found_encryption = true;
+                break;
+            }
+
+            case LC_CODE_SIGNATURE: {
+                auto signature = iterator.template as<struct linkedit_data_command>(command);
+                if (signature) {
+                    slice.code_signature = true;
+                    slice.signature_offset = rmaslr::byte_order<swapped>::get(signature->dataoff);
+                    slice.signature_size = rmaslr::byte_order<swapped>::get(signature->datasize);
+                }
+
+                found_signature = true;
+                break;
             }
         }
     }
 
-    if (CFDictionaryContainsKey(info, identifierKey)) {
-        CFStringRef identifier = (CFStringRef)CFDictionaryGetValue(info, identifierKey);
-        if (identifier) {
-            if (CFGetTypeID(identifier) == CFStringGetTypeID()) {
-                information["bundleIdentifier"] = CFStringGetCStringPtr(identifier, kCFStringEncodingUTF8);
+    slice.malformed_commands = iterator.malformed();
+}
+
+void rmaslr::inspect_load_commands(slice& slice, uint64_t available) noexcept {
+    auto span = trace::span("read_load_commands");
+
+    slice.encrypted = false;
+    slice.code_signature = false;
+    slice.signature_offset = 0;
+    slice.signature_size = 0;
+
+    if (is_swapped_magic(slice.header->magic)) {
+        ::inspect_load_commands<true>(slice, available);
+    } else {
+        ::inspect_load_commands<false>(slice, available);
+    }
+}
+
+//archs holds entries [first, first + count) of the fat_arch table
+template <bool swapped, bool is_64>
+static rmaslr::parse_status parse_fat_archs(const rmaslr::fat_arch_type<is_64> *archs, uint32_t first, uint32_t count, std::vector<rmaslr::slice>& slices, uint32_t *failing_index) noexcept {
+    auto view = rmaslr::fat_view<swapped, is_64>(archs);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = first + i;
+        uint64_t declarations_end = sizeof(struct fat_header) + static_cast<uint64_t>(index + 1) * sizeof(rmaslr::fat_arch_type<is_64>);
+
+        struct rmaslr::slice slice = {};
+
+        slice.offset = view.offset(i);
+        slice.cputype = view.cputype(i);
+        slice.cpusubtype = view.cpusubtype(i);
+
+        if (slice.offset < declarations_end) {
+            if (failing_index) {
+                *failing_index = index;
             }
+
+            return rmaslr::parse_status::placed_before_declaration;
         }
+
+        slices.push_back(slice);
     }
 
-    return information;
+    return rmaslr::parse_status::ok;
 }
 
-rmaslr::file::file(const char *path, const char *mode) : file_(fopen(path, mode)) {
-    if (!file_) {
-        error("rmaslr::file(); Unable to open file at path (\"%s\"), (fopen(path, mode) failed), errno=%d(%s)", path, errno, strerror(errno));
+uint32_t rmaslr::fat_architectures_count(const struct fat_header *header) noexcept {
+    if (!header || !is_fat_magic(header->magic)) {
+        return 0;
     }
 
-    if (::stat(path, &sbuf_) != 0) {
-        error("rmaslr::file(); Unable to gather information on file at path (\"%s\"), (::stat(path, &sbuf_) failed), errno=%d(%s)", path, errno, strerror(errno));
+    if (is_swapped_magic(header->magic)) {
+        return byte_order<true>::get(header->nfat_arch);
     }
+
+    return header->nfat_arch;
 }
 
-rmaslr::file::file(FILE *file) : file_(file) {
-    if (!file) {
-        error("rmaslr::file() : file is null");
+uint32_t rmaslr::fat_architectures_count(const file& file) noexcept {
+    return fat_architectures_count(file.fat_header());
+}
+
+bool rmaslr::is_java_class(const struct fat_header *header) noexcept {
+    if (!header || (header->magic != FAT_MAGIC && header->magic != FAT_CIGAM)) {
+        return false;
     }
 
-    position_ = ftell(file_);
+    return fat_architectures_count(header) > 30;
 }
 
-void rmaslr::file::seek(long position, rmaslr::file::seek_type seek) noexcept {
-    switch (seek) {
-    case seek_type::origin:
-        if (sbuf_.st_size < position) {
-            error("file::seek(); Cannot seek past end of file (position=%ld, size=%lld)", position, sbuf_.st_size);
+rmaslr::parse_status rmaslr::parse_fat_table(const struct fat_header *header, std::vector<slice>& slices, uint32_t *failing_index) noexcept {
+    auto span = trace::span("parse_fat_table");
+    uint32_t architectures_count = fat_architectures_count(header);
+    if (!architectures_count) {
+        return parse_status::no_architectures;
+    }
+
+    slices.reserve(slices.size() + architectures_count);
+
+    //the byte-order of the table is dispatched on once, never per field
+    const void *archs = reinterpret_cast<const uint8_t *>(header) + sizeof(struct fat_header);
+    switch (header->magic) {
+        case FAT_MAGIC:
+            return parse_fat_archs<false, false>(static_cast<const struct fat_arch *>(archs), 0, architectures_count, slices, failing_index);
+        case FAT_CIGAM:
+            return parse_fat_archs<true, false>(static_cast<const struct fat_arch *>(archs), 0, architectures_count, slices, failing_index);
+        case FAT_MAGIC_64:
+            return parse_fat_archs<false, true>(static_cast<const struct fat_arch_64 *>(archs), 0, architectures_count, slices, failing_index);
+        default:
+            break;
+    }
+
+    //FAT_CIGAM_64, the usual case on little-endian hosts. the table is swapped in bulk a chunk at a time
+    const struct fat_arch_64 *archs_64 = static_cast<const struct fat_arch_64 *>(archs);
+    struct fat_arch_64 chunk[32];
+
+    for (uint32_t first = 0; first < architectures_count; first += 32) {
+        uint32_t count = std::min(architectures_count - first, 32u);
+        swap_fat_archs_64(&archs_64[first], chunk, count);
+
+        auto status = parse_fat_archs<false, true>(chunk, first, count, slices, failing_index);
+        if (status != parse_status::ok) {
+            return status;
         }
+    }
+
+    return parse_status::ok;
+}
+
+rmaslr::parse_status rmaslr::parse_slices(const rmaslr::file& file, std::vector<rmaslr::slice>& slices, uint32_t *failing_index) noexcept {
+    if (file.size() < sizeof(struct mach_header_64)) {
+        return parse_status::not_macho;
+    }
+
+    uint32_t magic = file.magic();
+    if (is_macho_magic(magic)) {
+        struct slice slice = {};
+        slice.header = file.header(0x0);
 
-        position_ = position;
-        break;
-    case seek_type::current:
-        if ((sbuf_.st_size - position_) < position) {
-            error("file::seek(); Cannot seek past end of file (position=%ld, size=%lld)", position, sbuf_.st_size);
+        auto span = trace::span("read_header");
+        decode_header(slice, true);
+        slices.push_back(slice);
+
+        return parse_status::ok;
+    }
+
+    if (!is_fat_magic(magic)) {
+        return parse_status::not_macho;
+    }
+
+    if (is_java_class(file.fat_header())) {
+        return parse_status::not_macho;
+    }
+
+    uint32_t architectures_count = fat_architectures_count(file);
+    if (!architectures_count) {
+        return parse_status::no_architectures;
+    }
+
+    bool is_fat_64 = magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64;
+    if (is_fat_64 ? !file.fat_archs_64(architectures_count) : !file.fat_archs(architectures_count)) {
+        return parse_status::too_small;
+    }
+
+    size_t first = slices.size();
+
+    auto status = parse_fat_table(file.fat_header(), slices, failing_index);
+    if (status != parse_status::ok) {
+        slices.resize(first);
+        return status;
+    }
+
+    for (size_t i = first; i < slices.size(); i++) {
+        auto& slice = slices[i];
+        auto span = trace::span("read_header");
+
+        if (slice.offset >= file.size()) {
+            if (failing_index) {
+                *failing_index = static_cast<uint32_t>(i - first);
+            }
+
+            slices.resize(first);
+            return parse_status::placed_past_end;
         }
 
-        position_ += position;
-        break;
-    case seek_type::end:
-        if (sbuf_.st_size < position) {
-            error("file::seek(); Cannot seek past end of file (position=%ld, size=%lld)", position, sbuf_.st_size);
+        //the slices of a universal static library are archives, nothing in them can be patched
+        slice.header = file.header(slice.offset);
+        if (!is_macho_header(slice.header, file.size() - slice.offset)) {
+            slices.resize(first);
+            return parse_status::not_macho;
         }
 
-        position_ = sbuf_.st_size - position;
-        break;
+        decode_header(slice, false);
     }
 
-    if (fseek(file_, position, (int)seek) != 0) {
-        error("file::seek(); Unable to seek to position (%ld), (fseek(file_, position, (int)seek) failed), errno=%d(%s)", position, errno, strerror(errno));
-    }
+    return parse_status::ok;
 }
 
+#ifdef __APPLE__
+CFArrayRef (*rmaslr::springboard::SBSCopyApplicationDisplayIdentifiers)(bool onlyActive, bool debugging) = nullptr;
+
+CFStringRef (*rmaslr::springboard::SBSCopyLocalizedApplicationNameForDisplayIdentifier)(CFStringRef bundle_id) = nullptr;
+CFStringRef (*rmaslr::springboard::SBSCopyExecutablePathForDisplayIdentifier)(CFStringRef bundle_id) = nullptr;
+#endif
+
 bool rmaslr::options::application_ = false;
 bool rmaslr::options::check_aslr_ = false;
 bool rmaslr::options::display_archs_ = false;
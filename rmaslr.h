@@ -1,40 +1,49 @@
-#include <CoreFoundation/CoreFoundation.h>
+#pragma once
 
-#include <mach-o/loader.h>
-#include <mach-o/fat.h>
-#include <mach-o/arch.h>
+#ifdef __APPLE__
+#include <CoreFoundation/CoreFoundation.h>
+#endif
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <cerrno>
+#include <climits>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <thread>
 
 #include <string>
 #include <vector>
 
+#include <fcntl.h>
 #include <unistd.h>
 
+#include "applications.h"
+#include "architecture.h"
+#include "macho.h"
+#include "stats.h"
+#include "trace.h"
+
 #define assert_(str, ...) fprintf(stderr, "\x1B[31mError:\x1B[0m " str "\n", ##__VA_ARGS__); return -1
 
 #define notice(str, ...) fprintf(stdout, "\x1B[33mNotice:\x1B[0m " str "\n", ##__VA_ARGS__);
 #define error(str, ...) fprintf(stderr, "\x1B[31mError:\x1B[0m " str "\n", ##__VA_ARGS__); exit(0)
 
-#if !defined(FAT_MAGIC_64) && !defined(FAT_CIGAM_64)
-struct fat_arch_64 {
-    cpu_type_t cputype;
-    cpu_subtype_t cpusubtype;
-    uint64_t offset;
-    uint64_t size;
-    uint32_t align;
-};
-
-#define FAT_MAGIC_64 0xcafebabf
-#define FAT_CIGAM_64 0xbfbafeca
+//from apple's <sys/cdefs.h>
+#ifndef __printflike
+#define __printflike(fmtarg, firstvararg) __attribute__((__format__(__printf__, fmtarg, firstvararg)))
 #endif
 
-
 namespace std {
-    bool is_in_map(const std::vector<std::map<const char *, std::string>>& vector, const std::string& value) noexcept;
     bool case_compare(const std::string& first, const std::string& second) noexcept;
 
     std::string find_last_component(const std::string& string) noexcept;
@@ -82,16 +91,38 @@ namespace rmaslr {
             return get_platform() == "Mac OS X";
         }
     private:
-        static std::string get_platform() noexcept;
+        //read from SystemVersion.plist on first use, only commands dealing with applications need it
+        static const std::string& get_platform() noexcept;
         static std::string load_from_filesystem() noexcept;
     };
 
+    //private framework used to enumerate applications on iOS, resolved at runtime
+    class springboard {
+    public:
+        enum class load_status {
+            ok,
+            missing_framework,
+            missing_functions
+        };
+
+        //safe to call more than once, the framework is only loaded the first time
+        static load_status load() noexcept;
+
+#ifdef __APPLE__
+        static CFArrayRef (*SBSCopyApplicationDisplayIdentifiers)(bool onlyActive, bool debugging);
+
+        static CFStringRef (*SBSCopyLocalizedApplicationNameForDisplayIdentifier)(CFStringRef bundle_id);
+        static CFStringRef (*SBSCopyExecutablePathForDisplayIdentifier)(CFStringRef bundle_id);
+#endif
+    };
+
     inline bool is_root() noexcept {
         return geteuid() == 0;
     }
 
     template <typename T>
     T request_input(std::string question, std::vector<T> values = std::vector<T>()) {
+        auto span = trace::span("prompt", question.c_str());
         T input;
 
         auto is_valid = [&values](T input) {
@@ -120,6 +151,7 @@ namespace rmaslr {
 
     template <typename T>
     T request_input_ranged(std::string question, std::pair<T, T> range) {
+        auto span = trace::span("prompt", question.c_str());
         T input;
 
         do {
@@ -132,95 +164,237 @@ namespace rmaslr {
 
     size_t get_size(size_t size) noexcept;
 
-    uint32_t swap(uint32_t magic, uint32_t value) noexcept;
-    uint64_t swap(uint32_t magic, uint64_t value) noexcept;
-
-    __attribute__((unused))
-    static inline int32_t swap(uint32_t magic, int32_t value) noexcept {
-        return static_cast<int32_t>(swap(magic, static_cast<uint32_t>(value)));
-    }
-
-    __attribute__((unused))
-    static inline int64_t swap(uint32_t magic, int64_t value) noexcept {
-        return static_cast<int64_t>(swap(magic, static_cast<uint64_t>(value)));
-    }
-
     __printflike(1, 2)
     std::string formatted_string(const char *string, ...) noexcept;
-    std::map<const char *, std::string> parse_application_container(const std::string& path) noexcept;
+    //returns false if path is not an application container with a readable Info.plist
+    bool parse_application_container(const std::string& path, application& information) noexcept;
+
+    //paths of every entry in directory with an .app suffix
+    std::vector<std::string> find_application_containers(const std::string& directory) noexcept;
+
+    //enumerates directory once and parses every application container in it on at most jobs threads (0 picks one per cpu),
+    //results are in directory order
+    application_list parse_application_containers(const std::string& directory, unsigned int jobs = 0) noexcept;
 
+    //read-only view of a mach-o file, mapped once and accessed in place
+    //all accessors are bounds-checked against the size of the file and return nullptr when out of range
     class file {
     public:
-        file(const char *path, const char *mode = "r+");
-        file(FILE *file);
+        file(const char *path, bool writable = false) noexcept;
+        file(file&& other) noexcept;
+
+        //a view of size bytes at data, which the caller owns and keeps alive. it is never open, nothing can be written through it
+        file(const uint8_t *data, uint64_t size) noexcept;
+
+        file(const file&) = delete;
+        file& operator=(const file&) = delete;
 
-        inline ~file() noexcept {
-            fclose(file_);
+        ~file() noexcept;
+
+        //false when the file could not be opened, stat'd or mapped, error_number() then holds the errno of the failing call
+        inline bool is_open() const noexcept {
+            return descriptor_ >= 0;
         }
 
-        inline long position() const noexcept {
-            return position_;
+        inline int error_number() const noexcept {
+            return error_number_;
         }
 
-        enum class seek_type {
-            origin,
-            current,
-            end
-        };
+        inline uint64_t size() const noexcept {
+            return size_;
+        }
 
-        void seek(long position, seek_type seek) noexcept;
+        inline int descriptor() const noexcept {
+            return descriptor_;
+        }
 
-        template<typename T>
-        T read() noexcept {
-            T *buffer = static_cast<T *>(malloc(sizeof(T)));
-            if (!buffer) {
-                error("file::read(); Unable to allocate buffer needed to read data of size %ld, errno=%d(%s)", sizeof(T), errno, strerror(errno));
-            }
+        inline struct stat stat() const noexcept {
+            return sbuf_;
+        }
 
-            if (fread(buffer, sizeof(T), 1, file_) != 1) {
-                error("file::read(); Unable to read from file at offset %.16lX, errno=%d(%s)", position_, errno, strerror(errno));
+        template <typename T>
+        inline const T *at(uint64_t offset, uint64_t count = 1) const noexcept {
+            if (offset > size_ || count > (size_ - offset) / sizeof(T)) {
+                return nullptr;
             }
 
-            position_ += sizeof(T);
-            return *buffer;
+            return reinterpret_cast<const T *>(&map_[offset]);
         }
 
-        template <typename T>
-        inline void write(T buff) {
-            write_to_file<T>::write(*this, buff);
+        inline uint32_t magic() const noexcept {
+            const uint32_t *magic = at<uint32_t>(0x0);
+            return magic ? *magic : 0;
         }
 
-        inline FILE *get_file() const noexcept {
-            return file_;
+        inline const struct fat_header *fat_header() const noexcept {
+            return at<struct fat_header>(0x0);
         }
 
-        inline struct stat stat() const noexcept {
-            return sbuf_;
+        inline const struct fat_arch *fat_archs(uint32_t count) const noexcept {
+            return at<struct fat_arch>(sizeof(struct fat_header), count);
         }
+
+        inline const struct fat_arch_64 *fat_archs_64(uint32_t count) const noexcept {
+            return at<struct fat_arch_64>(sizeof(struct fat_header), count);
+        }
+
+        inline const struct mach_header *header(uint64_t offset) const noexcept {
+            return at<struct mach_header>(offset);
+        }
+
+        //reopens the file for writing, failing if path no longer refers to the file that was mapped
+        bool make_writable(const char *path) noexcept;
+
+        //writes only the 4-byte flags field of the mach_header at offset, flags must already be in the file's byte-order
+        bool write_flags(uint64_t offset, uint32_t flags) const noexcept;
     private:
-        FILE *file_ = nullptr;
-        long position_ = 0x0;
+        int descriptor_ = -1;
+        int error_number_ = 0;
+
+        const uint8_t *map_ = nullptr;
+        uint64_t size_ = 0;
+        bool borrowed_ = false; //map_ belongs to the caller
 
         struct stat sbuf_ = {};
+    };
 
-        template<typename T>
-        struct write_to_file {
-            friend class file;
-            static void write(const file& file, T buff) {
-                if (fwrite(static_cast<void *>(&buff), sizeof(T), 1, file.file_) != 1) {
-                    error("file::write(); Unable to write to file at position (%ld), errno=%d(%s)", file.position_, errno, strerror(errno));
-                }
+    inline bool is_macho_magic(uint32_t magic) noexcept {
+        switch (magic) {
+            case MH_MAGIC:
+            case MH_CIGAM:
+            case MH_MAGIC_64:
+            case MH_CIGAM_64:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    inline bool is_fat_magic(uint32_t magic) noexcept {
+        switch (magic) {
+            case FAT_MAGIC:
+            case FAT_CIGAM:
+            case FAT_MAGIC_64:
+            case FAT_CIGAM_64:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    struct slice {
+        uint64_t offset;
+        const struct mach_header *header;
+
+        cpu_type_t cputype;
+        cpu_subtype_t cpusubtype;
+
+        uint32_t filetype;
+
+        //filetype and flags of header in host byte-order, swapped is true when the header is in the opposite byte-order
+        uint32_t flags;
+        bool swapped;
+
+        //filled in by inspect_load_commands
+        bool encrypted;          //LC_ENCRYPTION_INFO(_64) with a non-zero cryptid
+        bool code_signature;     //LC_CODE_SIGNATURE present
+        bool malformed_commands; //ncmds/sizeofcmds/cmdsize point past the readable data
+
+        //dataoff (relative to offset) and datasize of LC_CODE_SIGNATURE
+        uint32_t signature_offset;
+        uint32_t signature_size;
+    };
+
+    inline bool has_aslr(const slice& slice) noexcept {
+        return (slice.flags & MH_PIE) > 0;
+    }
+
+    inline bool is_executable(const slice& slice) noexcept {
+        return slice.filetype == MH_EXECUTE;
+    }
+
+    //value converted to the byte-order of slice's header, for writing back with file::write_flags
+    inline uint32_t to_file_order(const slice& slice, uint32_t value) noexcept {
+        return slice.swapped ? byte_order<true>::get(value) : value;
+    }
+
+    enum class parse_status {
+        ok,
+        not_macho,
+        no_architectures,
+        too_small,
+        placed_before_declaration,
+        placed_past_end
+    };
+
+    //nfat_arch of a fat file in host byte-order, 0 if file is not fat
+    uint32_t fat_architectures_count(const struct fat_header *header) noexcept;
+    uint32_t fat_architectures_count(const file& file) noexcept;
+
+    //java class files share FAT_MAGIC, with their version (major 45 and up) where nfat_arch is. like file(1), a 32-bit fat header
+    //declaring more than 30 architectures is taken to be one
+    bool is_java_class(const struct fat_header *header) noexcept;
+
+    //whether header, followed by at least available readable bytes, is a whole mach_header or mach_header_64
+    inline bool is_macho_header(const struct mach_header *header, uint64_t available) noexcept {
+        return header && available >= sizeof(struct mach_header) && is_macho_magic(header->magic) && available >= header_size(header);
+    }
+
+    //fills in the filetype, flags and byte-order of slice from slice.header, and its cputype/cpusubtype when set_architecture is true
+    void decode_header(slice& slice, bool set_architecture) noexcept;
+
+    //decodes the offset and architecture of every entry in the fat_arch table following header, leaving their headers unset.
+    //all nfat_arch entries must be readable
+    parse_status parse_fat_table(const struct fat_header *header, std::vector<slice>& slices, uint32_t *failing_index = nullptr) noexcept;
+
+    //collects the header of every slice in a thin or fat file, on failure failing_index is set to the index of the offending architecture.
+    //a java class file, or a fat file with a slice that is not a whole mach-o header (a universal static library), is not_macho
+    parse_status parse_slices(const file& file, std::vector<slice>& slices, uint32_t *failing_index = nullptr) noexcept;
+
+    //walks the load commands of slice, whose header is followed by at least available readable bytes, to find its encryption and
+    //code-signature state. stops as soon as both commands were seen
+    void inspect_load_commands(slice& slice, uint64_t available) noexcept;
+
+    inline void inspect_load_commands(const file& file, slice& slice) noexcept {
+        inspect_load_commands(slice, file.size() - slice.offset);
+    }
+
+    //runs function(index) for every index in [0, count) on at most jobs threads (0 picks one thread per cpu)
+    template <typename F>
+    void parallel_for(size_t count, unsigned int jobs, F function) {
+        if (!jobs) {
+            jobs = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        if (jobs > count) {
+            jobs = static_cast<unsigned int>(count);
+        }
+
+        if (jobs < 2) {
+            for (size_t i = 0; i < count; i++) {
+                function(i);
             }
-        };
 
-        template<typename T>
-        struct write_to_file<T*> {
-            friend class file;
-            static void write(const file& file, T buff) {
-                if (fwrite(static_cast<void *>(buff), sizeof(T), 1, file.file_) != 1) {
-                    error("file::write(); Unable to write to file at position (%ld), errno=%d(%s)", file.position_, errno, strerror(errno));
-                }
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next++; i < count; i = next++) {
+                function(i);
             }
         };
-    };
+
+        auto threads = std::vector<std::thread>();
+        threads.reserve(jobs - 1);
+
+        for (unsigned int i = 1; i < jobs; i++) {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
 }
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstring>
+
+#include "sha.h"
+
+static inline uint32_t rotate_left(uint32_t value, unsigned int count) noexcept {
+    return (value << count) | (value >> (32 - count));
+}
+
+static inline uint32_t rotate_right(uint32_t value, unsigned int count) noexcept {
+    return (value >> count) | (value << (32 - count));
+}
+
+static inline uint32_t load_big_endian(const uint8_t *bytes) noexcept {
+    return static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+}
+
+static inline void store_big_endian(uint8_t *bytes, uint32_t value) noexcept {
+    bytes[0] = static_cast<uint8_t>(value >> 24);
+    bytes[1] = static_cast<uint8_t>(value >> 16);
+    bytes[2] = static_cast<uint8_t>(value >> 8);
+    bytes[3] = static_cast<uint8_t>(value);
+}
+
+//both hashes share the 64-byte block layout and the padding, transform(block) is the only difference
+template <typename F>
+static void update_blocks(uint8_t *block, size_t& block_size, uint64_t& length, const void *data, size_t size, F transform) noexcept {
+    auto bytes = static_cast<const uint8_t *>(data);
+    length += size;
+
+    if (block_size) {
+        size_t count = std::min(size, 64 - block_size);
+        memcpy(&block[block_size], bytes, count);
+
+        block_size += count;
+        bytes += count;
+        size -= count;
+
+        if (block_size < 64) {
+            return;
+        }
+
+        transform(block);
+        block_size = 0;
+    }
+
+    for (; size >= 64; bytes += 64, size -= 64) {
+        transform(bytes);
+    }
+
+    memcpy(block, bytes, size);
+    block_size = size;
+}
+
+template <typename F>
+static void pad_blocks(uint8_t *block, size_t block_size, uint64_t length, F transform) noexcept {
+    block[block_size++] = 0x80;
+    if (block_size > 56) {
+        memset(&block[block_size], 0, 64 - block_size);
+        transform(block);
+
+        block_size = 0;
+    }
+
+    memset(&block[block_size], 0, 56 - block_size);
+
+    uint64_t bits = length * 8;
+    store_big_endian(&block[56], static_cast<uint32_t>(bits >> 32));
+    store_big_endian(&block[60], static_cast<uint32_t>(bits));
+
+    transform(block);
+}
+
+rmaslr::sha1::sha1() noexcept : state_{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 } {}
+
+void rmaslr::sha1::transform(const uint8_t *block) noexcept {
+    uint32_t words[80];
+    for (int i = 0; i < 16; i++) {
+        words[i] = load_big_endian(&block[i * 4]);
+    }
+
+    for (int i = 16; i < 80; i++) {
+        words[i] = rotate_left(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+    }
+
+    uint32_t a = state_[0];
+    uint32_t b = state_[1];
+    uint32_t c = state_[2];
+    uint32_t d = state_[3];
+    uint32_t e = state_[4];
+
+    for (int i = 0; i < 80; i++) {
+        uint32_t f;
+        uint32_t k;
+
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+
+        uint32_t temp = rotate_left(a, 5) + f + e + k + words[i];
+
+        e = d;
+        d = c;
+        c = rotate_left(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+}
+
+void rmaslr::sha1::update(const void *data, size_t size) noexcept {
+    update_blocks(block_, block_size_, length_, data, size, [this](const uint8_t *block) {
+        transform(block);
+    });
+}
+
+void rmaslr::sha1::finish(uint8_t digest[digest_size]) noexcept {
+    pad_blocks(block_, block_size_, length_, [this](const uint8_t *block) {
+        transform(block);
+    });
+
+    for (int i = 0; i < 5; i++) {
+        store_big_endian(&digest[i * 4], state_[i]);
+    }
+}
+
+static const uint32_t sha256_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+rmaslr::sha256::sha256() noexcept : state_{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 } {}
+
+void rmaslr::sha256::transform(const uint8_t *block) noexcept {
+    uint32_t words[64];
+    for (int i = 0; i < 16; i++) {
+        words[i] = load_big_endian(&block[i * 4]);
+    }
+
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotate_right(words[i - 15], 7) ^ rotate_right(words[i - 15], 18) ^ (words[i - 15] >> 3);
+        uint32_t s1 = rotate_right(words[i - 2], 17) ^ rotate_right(words[i - 2], 19) ^ (words[i - 2] >> 10);
+
+        words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+    }
+
+    uint32_t a = state_[0];
+    uint32_t b = state_[1];
+    uint32_t c = state_[2];
+    uint32_t d = state_[3];
+    uint32_t e = state_[4];
+    uint32_t f = state_[5];
+    uint32_t g = state_[6];
+    uint32_t h = state_[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+        uint32_t choice = (e & f) ^ (~e & g);
+        uint32_t temp1 = h + s1 + choice + sha256_constants[i] + words[i];
+
+        uint32_t s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+void rmaslr::sha256::update(const void *data, size_t size) noexcept {
+    update_blocks(block_, block_size_, length_, data, size, [this](const uint8_t *block) {
+        transform(block);
+    });
+}
+
+void rmaslr::sha256::finish(uint8_t digest[digest_size]) noexcept {
+    pad_blocks(block_, block_size_, length_, [this](const uint8_t *block) {
+        transform(block);
+    });
+
+    for (int i = 0; i < 8; i++) {
+        store_big_endian(&digest[i * 4], state_[i]);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rmaslr {
+    //incremental SHA-1 (FIPS 180-4), only used for the page hashes of code signatures
+    class sha1 {
+    public:
+        static constexpr size_t digest_size = 20;
+
+        sha1() noexcept;
+
+        void update(const void *data, size_t size) noexcept;
+        void finish(uint8_t digest[digest_size]) noexcept;
+    private:
+        uint32_t state_[5];
+        uint64_t length_ = 0;
+
+        uint8_t block_[64];
+        size_t block_size_ = 0;
+
+        void transform(const uint8_t *block) noexcept;
+    };
+
+    class sha256 {
+    public:
+        static constexpr size_t digest_size = 32;
+
+        sha256() noexcept;
+
+        void update(const void *data, size_t size) noexcept;
+        void finish(uint8_t digest[digest_size]) noexcept;
+    private:
+        uint32_t state_[8];
+        uint64_t length_ = 0;
+
+        uint8_t block_[64];
+        size_t block_size_ = 0;
+
+        void transform(const uint8_t *block) noexcept;
+    };
+}
@@ -0,0 +1,246 @@
+#include "shared_cache.h"
+
+#define CACHE_MAGIC_PREFIX "dyld_v1"
+
+//later fields of dyld_cache_header, each there only when mapping_offset (where the header ends) is past it
+#define CACHE_SUBCACHES_OFFSET 0x188 //subCacheArrayOffset and subCacheArrayCount
+#define CACHE_IMAGES_OFFSET 0x1c0    //imagesOffset and imagesCount, replacing the ones in cache_header
+#define CACHE_SUBTYPE_OFFSET 0x1c8   //cacheSubType, subcache entries have a file suffix in headers reaching past it
+
+//caches are only built for little-endian architectures, so these are read in place like dyld does
+
+//the start of dyld_cache_header, the same in every version
+struct cache_header {
+    char magic[16];
+
+    uint32_t mapping_offset;
+    uint32_t mapping_count;
+
+    uint32_t images_offset;
+    uint32_t images_count;
+};
+
+struct cache_mapping {
+    uint64_t address;
+    uint64_t size;
+    uint64_t file_offset;
+
+    uint32_t max_protection;
+    uint32_t initial_protection;
+};
+
+struct cache_image {
+    uint64_t address;
+    uint64_t modification_time;
+    uint64_t inode;
+
+    uint32_t path_offset;
+    uint32_t pad;
+};
+
+//a subcache is path.1, path.2, ... in caches where its entry has no suffix
+struct subcache_entry {
+    uint8_t uuid[16];
+    uint64_t vm_offset;
+};
+
+struct subcache_suffixed_entry {
+    uint8_t uuid[16];
+    uint64_t vm_offset;
+
+    char suffix[32];
+};
+
+struct mapping {
+    uint64_t address;
+    uint64_t size;
+    uint64_t file_offset;
+
+    size_t cache; //0 for the main cache, otherwise its subcache's index + 1
+};
+
+static inline bool is_cache_magic(const char *magic) noexcept {
+    return strncmp(magic, CACHE_MAGIC_PREFIX, strlen(CACHE_MAGIC_PREFIX)) == 0;
+}
+
+//the NUL-terminated string at offset, cut short at the end of the file
+static std::string read_string(const rmaslr::file& file, uint64_t offset) noexcept {
+    const char *string = file.at<char>(offset);
+    if (!string) {
+        return std::string();
+    }
+
+    return std::string(string, strnlen(string, static_cast<size_t>(file.size() - offset)));
+}
+
+//appends the mappings of a cache, false if it isn't one or its mapping table is past the end of the file
+static bool add_mappings(const rmaslr::file& cache, size_t index, std::vector<mapping>& mappings) noexcept {
+    auto header = cache.at<cache_header>(0x0);
+    if (!header || !is_cache_magic(header->magic)) {
+        return false;
+    }
+
+    auto table = cache.at<cache_mapping>(header->mapping_offset, header->mapping_count);
+    if (!table) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->mapping_count; i++) {
+        mappings.push_back({ table[i].address, table[i].size, table[i].file_offset, index });
+    }
+
+    return true;
+}
+
+//only a page or two of every image is read, readahead around each would pull in most of a multi-gigabyte cache
+static void advise_random(const rmaslr::file& file) noexcept {
+    auto data = file.at<uint8_t>(0x0, file.size());
+    if (!data || !file.size()) {
+        return;
+    }
+
+    madvise(const_cast<uint8_t *>(data), static_cast<size_t>(file.size()), MADV_RANDOM);
+    rmaslr::stats::add_syscalls(1);
+}
+
+bool rmaslr::is_shared_cache(const std::string& path) noexcept {
+    int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    char magic[sizeof(cache_header::magic)];
+    bool is_cache = pread(descriptor, magic, sizeof(magic), 0) == sizeof(magic) && is_cache_magic(magic);
+
+    close(descriptor);
+    return is_cache;
+}
+
+std::vector<rmaslr::file_result> rmaslr::check_shared_cache(const std::string& path, const batch_options& options) noexcept {
+    auto span = trace::span("check_shared_cache", path.c_str());
+    auto results = std::vector<file_result>();
+
+    auto fail = [&path, &results](std::string error) {
+        results.emplace_back();
+        results.back().path = path;
+        results.back().status = file_status::failed;
+        results.back().error = std::move(error);
+
+        return std::move(results);
+    };
+
+    auto cache = rmaslr::file(path.c_str());
+    if (!cache.is_open()) {
+        return fail(formatted_string("could not be opened, errno=%d(%s)", cache.error_number(), strerror(cache.error_number())));
+    }
+
+    auto mappings = std::vector<mapping>();
+    if (!add_mappings(cache, 0, mappings)) {
+        return fail("is not a dyld shared cache, or its mapping table is past the end of the file");
+    }
+
+    //add_mappings checked that everything before the mapping table, the whole header, is readable
+    auto header = cache.at<cache_header>(0x0);
+
+    uint32_t images_offset = header->images_offset;
+    uint32_t images_count = header->images_count;
+
+    if (header->mapping_offset >= CACHE_IMAGES_OFFSET + 2 * sizeof(uint32_t)) {
+        auto fields = cache.at<uint32_t>(CACHE_IMAGES_OFFSET, 2);
+
+        images_offset = fields[0];
+        images_count = fields[1];
+    }
+
+    auto images = cache.at<cache_image>(images_offset, images_count);
+    if (!images) {
+        return fail("has an image table past the end of the file");
+    }
+
+    //split caches keep the images' contents in subcaches beside the main one, which only has the tables
+    auto subcaches = std::vector<rmaslr::file>();
+    if (header->mapping_offset >= CACHE_SUBCACHES_OFFSET + 2 * sizeof(uint32_t)) {
+        auto fields = cache.at<uint32_t>(CACHE_SUBCACHES_OFFSET, 2);
+
+        bool suffixed = header->mapping_offset > CACHE_SUBTYPE_OFFSET;
+        uint64_t entry_size = suffixed ? sizeof(subcache_suffixed_entry) : sizeof(subcache_entry);
+
+        if (!cache.at<uint8_t>(fields[0], fields[1] * entry_size)) {
+            return fail("has a subcache table past the end of the file");
+        }
+
+        for (uint32_t i = 0; i < fields[1]; i++) {
+            auto suffix = "." + std::to_string(i + 1);
+            if (suffixed) {
+                auto entry = cache.at<subcache_suffixed_entry>(fields[0] + i * entry_size);
+                suffix = std::string(entry->suffix, strnlen(entry->suffix, sizeof(entry->suffix)));
+            }
+
+            auto subcache_path = path + suffix;
+
+            subcaches.emplace_back(subcache_path.c_str());
+            if (!subcaches.back().is_open()) {
+                return fail(formatted_string("has a subcache (%s) that could not be opened, errno=%d(%s)", subcache_path.c_str(), subcaches.back().error_number(), strerror(subcaches.back().error_number())));
+            }
+
+            if (!add_mappings(subcaches.back(), subcaches.size(), mappings)) {
+                return fail(formatted_string("has a subcache (%s) that is not a dyld shared cache", subcache_path.c_str()));
+            }
+        }
+    }
+
+    advise_random(cache);
+    for (const auto& subcache : subcaches) {
+        advise_random(subcache);
+    }
+
+    //nothing in a cache is ever written, its images are signed as part of it
+    auto read_options = options;
+    read_options.remove_aslr = false;
+
+    results.resize(images_count);
+    parallel_for(images_count, options.jobs, [&](size_t index) {
+        auto timer = stats::timer(stats::stage::read);
+        if (stats::enabled()) {
+            stats::add(stats::counter::files);
+        }
+
+        const auto& image = images[index];
+        auto& result = results[index];
+
+        result.path = path + ":" + read_string(cache, image.path_offset);
+
+        auto mapping = std::find_if(mappings.begin(), mappings.end(), [&image](const struct mapping& mapping) {
+            return image.address >= mapping.address && image.address - mapping.address < mapping.size;
+        });
+
+        if (mapping == mappings.end()) {
+            result.status = file_status::failed;
+            result.error = formatted_string("is at address 0x%.16llX, outside every mapping of the cache", static_cast<unsigned long long>(image.address));
+
+            return;
+        }
+
+        const auto& holder = mapping->cache ? subcaches[mapping->cache - 1] : cache;
+        uint64_t mapping_offset = image.address - mapping->address;
+
+        auto slice = rmaslr::slice();
+        slice.offset = mapping->file_offset + mapping_offset;
+        slice.header = holder.header(slice.offset);
+
+        if (!slice.header || !is_macho_magic(slice.header->magic)) {
+            result.status = file_status::failed;
+            result.error = formatted_string("does not have a mach-o header at offset 0x%.16llX", static_cast<unsigned long long>(slice.offset));
+
+            return;
+        }
+
+        //past the end of its mapping belongs to other images
+        decode_header(slice, true);
+        inspect_load_commands(slice, std::min(mapping->size - mapping_offset, holder.size() - slice.offset));
+
+        plan_slices(std::vector<rmaslr::slice>(1, slice), read_options, result);
+    });
+
+    return results;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "batch.h"
+
+namespace rmaslr {
+    //whether the file at path is a dyld shared cache, its magic starting with dyld_v1
+    bool is_shared_cache(const std::string& path) noexcept;
+
+    //checks every image in the dyld shared cache at path, and in the subcaches beside it, without changing anything.
+    //only the cache's header, mapping and image tables and each image's mach header and load commands are read, on at most
+    //options.jobs threads. results are in image-table order, each named path:<install name> with the offset of its header in the
+    //cache file holding it. a cache (or subcache) that can't be read is a single failed result
+    std::vector<file_result> check_shared_cache(const std::string& path, const batch_options& options) noexcept;
+}
@@ -0,0 +1,187 @@
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "stats.h"
+
+//log-linear, 4 buckets per power of two, so a percentile is at most 25% above the samples it stands for
+#define HISTOGRAM_BUCKETS 256
+
+#define STAGES_COUNT static_cast<size_t>(rmaslr::stats::stage::count)
+#define COUNTERS_COUNT static_cast<size_t>(rmaslr::stats::counter::count)
+
+std::atomic<bool> rmaslr::stats::enabled_(false);
+
+static const char *stage_names[] = { "platform", "springboard", "applications", "plist", "open", "read", "write", "signature", "journal" };
+static const char *counter_names[] = { "files", "bytes_read", "bytes_mapped", "bytes_written", "syscalls" };
+
+//only ever written by the thread it belongs to, atomic so reading it from another is never a data race
+struct histogram {
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> max;
+};
+
+struct thread_stats {
+    histogram histograms[STAGES_COUNT];
+    std::atomic<uint64_t> counters[COUNTERS_COUNT];
+};
+
+//a plain load and store, there is only ever one writer
+static inline void increase(std::atomic<uint64_t>& value, uint64_t amount) noexcept {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static inline size_t bucket_index(uint64_t value) noexcept {
+    if (value < 4) {
+        return static_cast<size_t>(value);
+    }
+
+    int msb = 63 - __builtin_clzll(value);
+    return static_cast<size_t>((msb - 1) * 4) + ((value >> (msb - 2)) & 3);
+}
+
+//the largest value that falls in bucket index
+static inline uint64_t bucket_limit(size_t index) noexcept {
+    if (index < 4) {
+        return index;
+    }
+
+    int shift = static_cast<int>(index / 4) - 1;
+    return ((4 + (index % 4)) << shift) + ((1ull << shift) - 1);
+}
+
+//every thread's stats, kept until exit so threads that already finished are still counted.
+//never destroyed, stats are printed from an atexit handler
+static std::mutex registry_mutex;
+static std::vector<std::unique_ptr<thread_stats>> *registry = new std::vector<std::unique_ptr<thread_stats>>();
+
+static thread_stats& local_stats() noexcept {
+    static thread_local thread_stats *stats = nullptr;
+    if (!stats) {
+        stats = new thread_stats();
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry->emplace_back(stats);
+    }
+
+    return *stats;
+}
+
+void rmaslr::stats::enable() noexcept {
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+void rmaslr::stats::record(stage stage, uint64_t nanoseconds) noexcept {
+    auto& histogram = local_stats().histograms[static_cast<size_t>(stage)];
+
+    increase(histogram.buckets[bucket_index(nanoseconds)], 1);
+    increase(histogram.count, 1);
+    increase(histogram.total, nanoseconds);
+
+    if (nanoseconds > histogram.max.load(std::memory_order_relaxed)) {
+        histogram.max.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void rmaslr::stats::add(counter counter, uint64_t value) noexcept {
+    increase(local_stats().counters[static_cast<size_t>(counter)], value);
+}
+
+struct merged_stage {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+
+    //in nanoseconds, of the bucket the sample at fraction falls in, never above max
+    uint64_t percentile(double fraction) const noexcept {
+        auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count - 1)) + 1;
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return std::min(bucket_limit(i), max);
+            }
+        }
+
+        return max;
+    }
+};
+
+void rmaslr::stats::print(FILE *stream, bool json) noexcept {
+    auto stages = std::vector<merged_stage>(STAGES_COUNT, merged_stage());
+    uint64_t counters[COUNTERS_COUNT] = {};
+
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto& thread : *registry) {
+            for (size_t i = 0; i < STAGES_COUNT; i++) {
+                const auto& histogram = thread->histograms[i];
+                auto& stage = stages[i];
+
+                for (size_t j = 0; j < HISTOGRAM_BUCKETS; j++) {
+                    stage.buckets[j] += histogram.buckets[j].load(std::memory_order_relaxed);
+                }
+
+                stage.count += histogram.count.load(std::memory_order_relaxed);
+                stage.total += histogram.total.load(std::memory_order_relaxed);
+                stage.max = std::max(stage.max, histogram.max.load(std::memory_order_relaxed));
+            }
+
+            for (size_t i = 0; i < COUNTERS_COUNT; i++) {
+                counters[i] += thread->counters[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //pages of mapped files are read in by faults rather than by read calls
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    uint64_t files = counters[static_cast<size_t>(counter::files)];
+    uint64_t syscalls = counters[static_cast<size_t>(counter::syscalls)];
+
+    if (json) {
+        fprintf(stream, "{\"stats\":{\"stages\":{");
+
+        bool first = true;
+        for (size_t i = 0; i < STAGES_COUNT; i++) {
+            const auto& stage = stages[i];
+            if (!stage.count) {
+                continue;
+            }
+
+            fprintf(stream, "%s\"%s\":{\"count\":%llu,\"total_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}", first ? "" : ",", stage_names[i], (unsigned long long)stage.count, (unsigned long long)stage.total, (unsigned long long)stage.percentile(0.5), (unsigned long long)stage.percentile(0.99), (unsigned long long)stage.max);
+            first = false;
+        }
+
+        fprintf(stream, "}");
+        for (size_t i = 0; i < COUNTERS_COUNT; i++) {
+            fprintf(stream, ",\"%s\":%llu", counter_names[i], (unsigned long long)counters[i]);
+        }
+
+        fprintf(stream, ",\"minor_faults\":%ld,\"major_faults\":%ld}}\n", usage.ru_minflt, usage.ru_majflt);
+        return;
+    }
+
+    fprintf(stream, "%-13s %10s %12s %10s %10s %10s\n", "stage", "count", "total ms", "p50 us", "p99 us", "max us");
+    for (size_t i = 0; i < STAGES_COUNT; i++) {
+        const auto& stage = stages[i];
+        if (!stage.count) {
+            continue;
+        }
+
+        fprintf(stream, "%-13s %10llu %12.3f %10.2f %10.2f %10.2f\n", stage_names[i], (unsigned long long)stage.count, stage.total / 1e6, stage.percentile(0.5) / 1e3, stage.percentile(0.99) / 1e3, stage.max / 1e3);
+    }
+
+    fprintf(stream, "%llu files, %llu bytes mapped, %llu bytes read, %llu bytes written\n", (unsigned long long)files, (unsigned long long)counters[static_cast<size_t>(counter::bytes_mapped)], (unsigned long long)counters[static_cast<size_t>(counter::bytes_read)], (unsigned long long)counters[static_cast<size_t>(counter::bytes_written)]);
+    fprintf(stream, "%llu syscalls (%.1f per file), %ld minor and %ld major page faults\n", (unsigned long long)syscalls, files ? static_cast<double>(syscalls) / files : 0.0, usage.ru_minflt, usage.ru_majflt);
+}
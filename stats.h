@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace rmaslr {
+    namespace stats {
+        //stages overlap where one calls another, plist is part of platform and applications
+        enum class stage {
+            platform,     //reading SystemVersion.plist
+            springboard,  //dlopen of SpringBoardServices
+            applications, //enumerating or loading the application catalog
+            plist,        //parsing a property list
+            open,         //opening and mapping a file, and reopening it for writing
+            read,         //parsing the fat table, slice headers and load commands
+            write,        //writing flags
+            signature,    //updating an ad-hoc signature
+            journal,      //making journal entries durable
+            count
+        };
+
+        enum class counter {
+            files,
+            bytes_read,    //with pread or io_uring, headers read through a mapping are counted as page faults instead
+            bytes_mapped,
+            bytes_written,
+            syscalls,      //made directly by rmaslr, not by the libraries it calls
+            count
+        };
+
+        extern std::atomic<bool> enabled_;
+
+        inline bool enabled() noexcept {
+            return enabled_.load(std::memory_order_relaxed);
+        }
+
+        //nothing is recorded before this, recording is per-thread and never contended
+        void enable() noexcept;
+
+        void record(stage stage, uint64_t nanoseconds) noexcept;
+        void add(counter counter, uint64_t value = 1) noexcept;
+
+        inline void add_syscalls(uint64_t count) noexcept {
+            if (enabled()) {
+                add(counter::syscalls, count);
+            }
+        }
+
+        //records the time from construction to destruction in stage, when enabled
+        class timer {
+        public:
+            explicit timer(stage stage) noexcept : stage_(stage), enabled_(enabled()) {
+                if (enabled_) {
+                    start_ = std::chrono::steady_clock::now();
+                }
+            }
+
+            timer(const timer&) = delete;
+            timer& operator=(const timer&) = delete;
+
+            timer(timer&& other) noexcept : stage_(other.stage_), enabled_(other.enabled_), start_(other.start_) {
+                other.enabled_ = false;
+            }
+
+            ~timer() noexcept {
+                stop();
+            }
+
+            //records now instead of at destruction
+            void stop() noexcept {
+                if (enabled_) {
+                    record(stage_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count()));
+                    enabled_ = false;
+                }
+            }
+        private:
+            stage stage_;
+            bool enabled_;
+
+            std::chrono::steady_clock::time_point start_;
+        };
+
+        //the counters and histograms of every thread merged, as a table or (json) a single object on one line
+        void print(FILE *stream, bool json) noexcept;
+    }
+}
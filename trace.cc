@@ -0,0 +1,119 @@
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "trace.h"
+
+std::atomic<bool> rmaslr::trace::enabled_(false);
+
+struct event {
+    const char *name;
+    std::string detail;
+
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+struct thread_events {
+    uint32_t thread_index;
+    bool main_thread;
+    std::vector<event> events; //only ever touched by its thread until finish
+};
+
+//every thread's events, kept until finish so threads that already finished are still written.
+//never destroyed, finish is called from an atexit handler
+static std::mutex registry_mutex;
+static std::vector<std::unique_ptr<thread_events>> *registry = new std::vector<std::unique_ptr<thread_events>>();
+
+static FILE *trace_file = nullptr;
+static std::chrono::steady_clock::time_point trace_start;
+static std::thread::id main_thread_id;
+
+static thread_events& local_events() noexcept {
+    static thread_local thread_events *events = nullptr;
+    if (!events) {
+        events = new thread_events();
+        events->main_thread = std::this_thread::get_id() == main_thread_id;
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        events->thread_index = static_cast<uint32_t>(registry->size()) + 1;
+
+        registry->emplace_back(events);
+    }
+
+    return *events;
+}
+
+bool rmaslr::trace::start(const char *path) noexcept {
+    trace_file = fopen(path, "w");
+    if (!trace_file) {
+        return false;
+    }
+
+    trace_start = std::chrono::steady_clock::now();
+    main_thread_id = std::this_thread::get_id();
+    enabled_.store(true, std::memory_order_relaxed);
+
+    return true;
+}
+
+void rmaslr::trace::record(const char *name, const char *detail, std::chrono::steady_clock::time_point start) noexcept {
+    auto end = std::chrono::steady_clock::now();
+    local_events().events.push_back({ name, detail ? detail : "", start, end });
+}
+
+static void write_string(FILE *file, const std::string& string) noexcept {
+    fputc('"', file);
+    for (unsigned char character : string) {
+        if (character == '"' || character == '\\') {
+            fputc('\\', file);
+            fputc(character, file);
+        } else if (character < 0x20) {
+            fprintf(file, "\\u%.4x", character);
+        } else {
+            fputc(character, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+//microseconds since trace::start, chrome's unit
+static double microseconds(std::chrono::steady_clock::time_point time) noexcept {
+    return std::chrono::duration<double, std::micro>(time - trace_start).count();
+}
+
+void rmaslr::trace::finish() noexcept {
+    if (!enabled_.exchange(false)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    int pid = getpid();
+
+    fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"rmaslr\"}}", pid);
+
+    for (const auto& thread : *registry) {
+        fprintf(trace_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}", pid, thread->thread_index, thread->main_thread ? "main" : "worker", thread->thread_index);
+        for (const auto& event : thread->events) {
+            fprintf(trace_file, ",\n{\"name\":\"%s\",\"cat\":\"rmaslr\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", event.name, pid, thread->thread_index, microseconds(event.start), microseconds(event.end) - microseconds(event.start));
+            if (!event.detail.empty()) {
+                fprintf(trace_file, ",\"args\":{\"detail\":");
+                write_string(trace_file, event.detail);
+                fputc('}', trace_file);
+            }
+
+            fputc('}', trace_file);
+        }
+    }
+
+    fprintf(trace_file, "\n]}\n");
+    fclose(trace_file);
+
+    trace_file = nullptr;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+//USDT probes are only emitted where systemtap's <sys/sdt.h> is available, a probe is a single nop until something attaches to it
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define RMASLR_USDT 1
+#endif
+#endif
+
+#ifdef RMASLR_USDT
+#define RMASLR_PROBE(name, span_name, detail) DTRACE_PROBE2(rmaslr, name, span_name, detail)
+#else
+#define RMASLR_PROBE(name, span_name, detail) ((void)0)
+#endif
+
+namespace rmaslr {
+    namespace trace {
+        extern std::atomic<bool> enabled_;
+
+        inline bool enabled() noexcept {
+            return enabled_.load(std::memory_order_relaxed);
+        }
+
+        //spans are recorded from now on, and written to path by finish. false with errno set if path could not be created
+        bool start(const char *path) noexcept;
+
+        //writes every span recorded so far as chrome trace-event json (loadable in perfetto or chrome://tracing)
+        void finish() noexcept;
+
+        void record(const char *name, const char *detail, std::chrono::steady_clock::time_point start) noexcept;
+
+        //the rest of the scope, as a complete event in the trace when one is being written, and always
+        //between the usdt probes rmaslr:span__start and rmaslr:span__done (both given name and detail).
+        //name must be a string literal, detail (a path or question, may be null) must outlive the span
+        class span {
+        public:
+            explicit span(const char *name, const char *detail = nullptr) noexcept : name_(name), detail_(detail), enabled_(enabled()) {
+                RMASLR_PROBE(span__start, name_, detail_);
+                if (enabled_) {
+                    start_ = std::chrono::steady_clock::now();
+                }
+            }
+
+            span(const span&) = delete;
+            span& operator=(const span&) = delete;
+
+            span(span&& other) noexcept : name_(other.name_), detail_(other.detail_), enabled_(other.enabled_), start_(other.start_) {
+                other.name_ = nullptr;
+                other.enabled_ = false;
+            }
+
+            ~span() noexcept {
+                if (!name_) {
+                    return;
+                }
+
+                if (enabled_) {
+                    record(name_, detail_, start_);
+                }
+
+                RMASLR_PROBE(span__done, name_, detail_);
+            }
+        private:
+            const char *name_;
+            const char *detail_;
+            bool enabled_;
+
+            std::chrono::steady_clock::time_point start_;
+        };
+    }
+}
@@ -0,0 +1,303 @@
+#include "watch.h"
+
+#ifndef __linux__
+
+bool rmaslr::watch(const std::vector<std::string>&, const rmaslr::batch_options&, rmaslr::report&) noexcept {
+    fprintf(stderr, "\x1B[31mError:\x1B[0m Watching directories requires inotify, which is only available on linux\n");
+    return false;
+}
+
+#else
+
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DONT_FOLLOW)
+
+//a file is processed once it has been left alone this long, so a linker writing it in several passes is only seen once
+#define WATCH_DEBOUNCE std::chrono::milliseconds(100)
+
+//files handed to process_files at once, and files queued before inotify is no longer read
+#define WATCH_BATCH_SIZE 1024
+#define WATCH_MAX_PENDING 65536
+
+using watch_clock = std::chrono::steady_clock;
+
+static int64_t modification_time(const std::string& path) noexcept {
+    struct stat sbuf;
+    if (stat(path.c_str(), &sbuf) != 0) {
+        return -1;
+    }
+
+    return static_cast<int64_t>(sbuf.st_mtim.tv_sec) * 1000000000 + sbuf.st_mtim.tv_nsec;
+}
+
+class watcher {
+public:
+    watcher(int descriptor, const rmaslr::batch_options& options, rmaslr::report& report) noexcept : descriptor_(descriptor), options_(options), report_(report) {}
+
+    //watches directory and every directory below it, queueing the files already inside when queue_files is true
+    void add_directory(const std::string& directory, bool queue_files) noexcept {
+        auto directories = std::vector<std::string>({ directory });
+        while (!directories.empty()) {
+            std::string path = std::move(directories.back());
+            directories.pop_back();
+
+            int watch_descriptor = inotify_add_watch(descriptor_, path.c_str(), WATCH_MASK | IN_ONLYDIR);
+            if (watch_descriptor < 0) {
+                continue;
+            }
+
+            DIR *dir = opendir(path.c_str());
+            if (path.back() != '/') {
+                path.append(1, '/');
+            }
+
+            directories_[watch_descriptor] = path;
+            if (!dir) {
+                continue;
+            }
+
+            struct dirent *dir_entry = nullptr;
+            while ((dir_entry = readdir(dir))) {
+                if (strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) {
+                    continue;
+                }
+
+                auto entry_path = path + dir_entry->d_name;
+                auto type = dir_entry->d_type;
+
+                if (type == DT_UNKNOWN) {
+                    struct stat sbuf;
+                    if (lstat(entry_path.c_str(), &sbuf) != 0) {
+                        continue;
+                    }
+
+                    type = S_ISDIR(sbuf.st_mode) ? DT_DIR : S_ISREG(sbuf.st_mode) ? DT_REG : DT_UNKNOWN;
+                }
+
+                if (type == DT_DIR) {
+                    directories.push_back(std::move(entry_path));
+                } else if (type == DT_REG && queue_files) {
+                    queue(entry_path);
+                }
+            }
+
+            closedir(dir);
+        }
+    }
+
+    inline bool accepting() const noexcept {
+        return order_.size() < WATCH_MAX_PENDING;
+    }
+
+    //reads events until none are left or the queue is full
+    void read_events() noexcept {
+        alignas(struct inotify_event) char buffer[0x10000];
+        while (accepting()) {
+            ssize_t length = read(descriptor_, buffer, sizeof(buffer));
+            if (length <= 0) {
+                return;
+            }
+
+            for (ssize_t offset = 0; offset < length;) {
+                auto event = reinterpret_cast<const struct inotify_event *>(&buffer[offset]);
+                offset += sizeof(struct inotify_event) + event->len;
+
+                handle_event(event);
+            }
+        }
+    }
+
+    //milliseconds until the next queued file is due, -1 when none are queued
+    int timeout() const noexcept {
+        if (order_.empty()) {
+            return -1;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(order_.front().second - watch_clock::now()).count();
+        return static_cast<int>(std::max<int64_t>(remaining, 0));
+    }
+
+    //runs every file that is due, at most WATCH_BATCH_SIZE at a time
+    void process_due() noexcept {
+        auto now = watch_clock::now();
+        auto paths = std::vector<std::string>();
+
+        while (!order_.empty() && order_.front().second <= now && paths.size() < WATCH_BATCH_SIZE) {
+            auto entry = std::move(order_.front());
+            order_.pop_front();
+
+            //written to again since, a later entry for it is still queued
+            auto it = deadlines_.find(entry.first);
+            if (it == deadlines_.end() || it->second != entry.second) {
+                continue;
+            }
+
+            deadlines_.erase(it);
+
+            //the event of closing a file after removing its ASLR
+            auto patched = patched_.find(entry.first);
+            if (patched != patched_.end()) {
+                bool unchanged = patched->second == modification_time(entry.first);
+                patched_.erase(patched);
+
+                if (unchanged) {
+                    continue;
+                }
+            }
+
+            paths.push_back(std::move(entry.first));
+        }
+
+        if (paths.empty()) {
+            return;
+        }
+
+        //anything written that isn't a mach-o, including fat files whose slices aren't (universal static libraries), comes back skipped
+        //and unwritten, so it never raises an event of its own
+        rmaslr::process_files(paths, options_, [&](size_t index, rmaslr::file_result&& result) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& slice : result.slices) {
+                if (slice.action == rmaslr::slice_action::removed) {
+                    patched_[paths[index]] = modification_time(paths[index]);
+                    break;
+                }
+            }
+
+            report_.add(result);
+        });
+
+        report_.flush();
+    }
+private:
+    int descriptor_;
+
+    const rmaslr::batch_options& options_;
+    rmaslr::report& report_;
+
+    std::mutex mutex_;
+
+    //watch descriptor -> directory path with a trailing slash
+    std::unordered_map<int, std::string> directories_;
+
+    //files in the order their debounce ends, an entry is stale if deadlines_ holds a later deadline for its path
+    std::deque<std::pair<std::string, watch_clock::time_point>> order_;
+    std::unordered_map<std::string, watch_clock::time_point> deadlines_;
+
+    //modification time of files just patched, to recognise the event caused by writing to them
+    std::unordered_map<std::string, int64_t> patched_;
+
+    void queue(const std::string& path) noexcept {
+        auto deadline = watch_clock::now() + WATCH_DEBOUNCE;
+
+        deadlines_[path] = deadline;
+        order_.emplace_back(path, deadline);
+    }
+
+    void handle_event(const struct inotify_event *event) noexcept {
+        //the kernel dropped events, every watched directory is looked at again instead
+        if (event->mask & IN_Q_OVERFLOW) {
+            auto directories = std::vector<std::string>();
+            for (const auto& directory : directories_) {
+                directories.push_back(directory.second);
+            }
+
+            for (const auto& directory : directories) {
+                add_directory(directory, true);
+            }
+
+            return;
+        }
+
+        if (event->mask & IN_IGNORED) {
+            directories_.erase(event->wd);
+            return;
+        }
+
+        auto it = directories_.find(event->wd);
+        if (it == directories_.end() || !event->len) {
+            return;
+        }
+
+        auto path = it->second + event->name;
+        if (event->mask & IN_ISDIR) {
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                add_directory(path, true);
+            }
+
+            return;
+        }
+
+        if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+            queue(path);
+        }
+    }
+};
+
+bool rmaslr::watch(const std::vector<std::string>& directories, const rmaslr::batch_options& options, rmaslr::report& report) noexcept {
+    int descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (descriptor < 0) {
+        fprintf(stderr, "\x1B[31mError:\x1B[0m Unable to initialize inotify, errno=%d(%s)\n", errno, strerror(errno));
+        return false;
+    }
+
+    //interrupting stops the loop so the report can be finished
+    sigset_t signals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+
+    int signal_descriptor = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_descriptor < 0) {
+        fprintf(stderr, "\x1B[31mError:\x1B[0m Unable to create signalfd, errno=%d(%s)\n", errno, strerror(errno));
+        close(descriptor);
+
+        return false;
+    }
+
+    watcher watcher_(descriptor, options, report);
+    for (const auto& directory : directories) {
+        watcher_.add_directory(directory, false);
+    }
+
+    for (;;) {
+        struct pollfd descriptors[] = {
+            { signal_descriptor, POLLIN, 0 },
+            { watcher_.accepting() ? descriptor : -1, POLLIN, 0 }
+        };
+
+        if (poll(descriptors, 2, watcher_.timeout()) < 0 && errno != EINTR) {
+            break;
+        }
+
+        if (descriptors[0].revents & POLLIN) {
+            break;
+        }
+
+        if (descriptors[1].revents & POLLIN) {
+            watcher_.read_events();
+        }
+
+        watcher_.process_due();
+    }
+
+    close(signal_descriptor);
+    close(descriptor);
+
+    return true;
+}
+
+#endif
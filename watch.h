@@ -0,0 +1,10 @@
+#pragma once
+
+#include "report.h"
+
+namespace rmaslr {
+    //stays resident and runs every file written or moved into directories (or any directory created below them) through process_files.
+    //a file is only processed once it has not been written to for a short while, and at most a bounded number of files are queued:
+    //past that, events are left in the kernel until the queue drains. runs until interrupted, returns false if watching could not start
+    bool watch(const std::vector<std::string>& directories, const batch_options& options, report& report) noexcept;
+}